@@ -0,0 +1,220 @@
+#include "bayes_opt.h"
+#include "config_params.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// noise variance of the normalized G-mean of the priors and of the observations of the current group
+static const double prior_noise = 0.25;
+static const double own_noise = 1e-4;
+
+BayesOpt::BayesOpt(double c_min, double c_max, double g_min, double g_max)
+    : c_min_(c_min), c_max_(c_max), g_min_(g_min), g_max_(g_max){}
+
+
+void BayesOpt::add_prior(const bo_observation& obs){
+    v_obs_.push_back(obs);
+    v_noise_.push_back(prior_noise);
+}
+
+
+void BayesOpt::add(const bo_observation& obs){
+    v_obs_.push_back(obs);
+    v_noise_.push_back(own_noise);
+    best_gmean_ = std::max(best_gmean_, obs.gmean);
+}
+
+
+std::mutex& BayesOpt::history_mutex(){
+    static std::mutex mtx;
+    return mtx;
+}
+
+
+std::vector<bo_observation>& BayesOpt::v_history(){
+    static std::vector<bo_observation> v_hist;
+    return v_hist;
+}
+
+
+bool& BayesOpt::in_batch(){
+    static bool batch = false;
+    return batch;
+}
+
+
+std::map<int, std::vector<bo_observation>>& BayesOpt::map_batch(){
+    static std::map<int, std::vector<bo_observation>> map_obs;
+    return map_obs;
+}
+
+
+void BayesOpt::record(const bo_observation& obs, int group_id){
+    std::lock_guard<std::mutex> lock(history_mutex());
+    if(in_batch()){
+        map_batch()[group_id].push_back(obs);
+    }else{
+        v_history().push_back(obs);
+        trim_history();
+    }
+}
+
+
+void BayesOpt::begin_batch(){
+    std::lock_guard<std::mutex> lock(history_mutex());
+    in_batch() = true;
+}
+
+
+void BayesOpt::end_batch(){
+    std::lock_guard<std::mutex> lock(history_mutex());
+    in_batch() = false;
+    for(const auto& group_obs : map_batch())        // ordered by the group id
+        v_history().insert(v_history().end(), group_obs.second.begin(), group_obs.second.end());
+    map_batch().clear();
+    trim_history();
+}
+
+
+void BayesOpt::trim_history(){
+    std::vector<bo_observation>& v_hist = v_history();
+    unsigned int max_num = std::max(0, Config_params::getInstance()->get_ms_bo_priors());
+    if(v_hist.size() > max_num)
+        v_hist.erase(v_hist.begin(), v_hist.end() - max_num);
+}
+
+
+std::vector<bo_observation> BayesOpt::history(unsigned int max_num){
+    std::lock_guard<std::mutex> lock(history_mutex());
+    const std::vector<bo_observation>& v_hist = v_history();
+    unsigned int first = (v_hist.size() > max_num) ? v_hist.size() - max_num : 0;
+    return std::vector<bo_observation>(v_hist.begin() + first, v_hist.end());
+}
+
+
+double BayesOpt::kernel(const bo_observation& a, double log_c, double log_g, double length) const{
+    // the axes are scaled to the searching box, hence the length is a fraction of the box
+    double dc = (a.log_c - log_c) / (c_max_ - c_min_);
+    double dg = (a.log_g - log_g) / (g_max_ - g_min_);
+    return exp(-(dc * dc + dg * dg) / (2 * length * length));
+}
+
+
+double BayesOpt::factorize(double length, const std::vector<double>& v_y, std::vector<double>& L, std::vector<double>& v_alpha) const{
+    unsigned int n = v_obs_.size();
+    L.assign(n * n, 0);
+    for(unsigned int i=0; i < n; i++){
+        for(unsigned int j=0; j <= i; j++){
+            double sum = kernel(v_obs_[i], v_obs_[j].log_c, v_obs_[j].log_g, length);
+            if(i == j) sum += v_noise_[i];
+            for(unsigned int k=0; k < j; k++)
+                sum -= L[i * n + k] * L[j * n + k];
+            if(i == j){
+                if(sum <= 0)
+                    return -std::numeric_limits<double>::infinity();
+                L[i * n + i] = sqrt(sum);
+            }else{
+                L[i * n + j] = sum / L[j * n + j];
+            }
+        }
+    }
+    // alpha = K^-1 y by the forward and backward substitutions
+    v_alpha = v_y;
+    for(unsigned int i=0; i < n; i++){
+        for(unsigned int k=0; k < i; k++)
+            v_alpha[i] -= L[i * n + k] * v_alpha[k];
+        v_alpha[i] /= L[i * n + i];
+    }
+    double log_ml = 0;
+    for(unsigned int i=0; i < n; i++)
+        log_ml -= 0.5 * v_alpha[i] * v_alpha[i] + log(L[i * n + i]);
+    for(int i = n - 1; i >= 0; i--){
+        for(unsigned int k=i+1; k < n; k++)
+            v_alpha[i] -= L[k * n + i] * v_alpha[k];
+        v_alpha[i] /= L[i * n + i];
+    }
+    return log_ml;
+}
+
+
+double BayesOpt::next(double& log_c, double& log_g){
+    unsigned int n = v_obs_.size();
+    log_c = (c_min_ + c_max_) / 2;
+    log_g = (g_min_ + g_max_) / 2;
+    if(n == 0)
+        return std::numeric_limits<double>::infinity();
+
+    // - - - - normalize the G-means, the GP has zero mean and unit variance - - - -
+    double mean = 0, var = 0;
+    for(const bo_observation& obs : v_obs_)
+        mean += obs.gmean;
+    mean /= n;
+    for(const bo_observation& obs : v_obs_)
+        var += (obs.gmean - mean) * (obs.gmean - mean);
+    double scale = (n > 1 && var > 1e-12) ? sqrt(var / n) : 1;
+    std::vector<double> v_y(n);
+    for(unsigned int i=0; i < n; i++)
+        v_y[i] = (v_obs_[i].gmean - mean) / scale;
+
+    // - - - - the length of the kernel with the largest marginal likelihood - - - -
+    const double lengths[] = {0.05, 0.1, 0.2, 0.4};
+    std::vector<double> L, v_alpha, L_best, v_alpha_best;
+    double best_log_ml = -std::numeric_limits<double>::infinity();
+    double length = 0;
+    for(double l : lengths){
+        double log_ml = factorize(l, v_y, L, v_alpha);
+        if(log_ml > best_log_ml){
+            best_log_ml = log_ml;
+            length = l;
+            L_best.swap(L);
+            v_alpha_best.swap(v_alpha);
+        }
+    }
+    if(length == 0)         // never happens with the noise on the diagonal
+        return 0;
+
+    // - - - - expected improvement on the grid - - - -
+    double best_y = ((best_gmean_ >= 0) ? best_gmean_ : mean) - mean;
+    best_y /= scale;
+    double best_ei = -1;
+    std::vector<double> v_k(n);
+    double cell_c = (c_max_ - c_min_) / (grid_size - 1) / 2;
+    double cell_g = (g_max_ - g_min_) / (grid_size - 1) / 2;
+    auto is_evaluated = [&](double c, double g){
+        for(unsigned int i=0; i < n; i++){
+            if(v_noise_[i] == own_noise && fabs(v_obs_[i].log_c - c) < cell_c && fabs(v_obs_[i].log_g - g) < cell_g)
+                return true;
+        }
+        return false;
+    };
+    for(int ic=0; ic < grid_size; ic++){
+        double c = c_min_ + (c_max_ - c_min_) * ic / (grid_size - 1);
+        for(int ig=0; ig < grid_size; ig++){
+            double g = g_min_ + (g_max_ - g_min_) * ig / (grid_size - 1);
+            if(is_evaluated(c, g))      // the same model again
+                continue;
+            double mu = 0;
+            for(unsigned int i=0; i < n; i++){
+                v_k[i] = kernel(v_obs_[i], c, g, length);
+                mu += v_k[i] * v_alpha_best[i];
+            }
+            // variance is k(x,x) - v'v where L v = k
+            double s2 = 1;
+            for(unsigned int i=0; i < n; i++){
+                for(unsigned int k=0; k < i; k++)
+                    v_k[i] -= L_best[i * n + k] * v_k[k];
+                v_k[i] /= L_best[i * n + i];
+                s2 -= v_k[i] * v_k[i];
+            }
+            double sigma = sqrt(std::max(s2, 1e-12));
+            double z = (mu - best_y) / sigma;
+            double ei = (mu - best_y) * 0.5 * erfc(-z / sqrt(2)) + sigma * exp(-0.5 * z * z) / sqrt(2 * M_PI);
+            if(ei > best_ei){
+                best_ei = ei;
+                log_c = c;
+                log_g = g;
+            }
+        }
+    }
+    return std::max(best_ei, 0.0) * scale;
+}
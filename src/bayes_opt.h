@@ -0,0 +1,58 @@
+#ifndef BAYES_OPT_H
+#define BAYES_OPT_H
+
+#include <vector>
+#include <map>
+#include <mutex>
+
+struct bo_observation{
+    double log_c;       // log2 of C
+    double log_g;       // log2 of gamma
+    double gmean;       // on the validation data
+};
+
+/*
+ * Gaussian process over (log2 C, log2 gamma) for the Bayesian optimization of the model selection (ms_method 2)
+ * the observations of the current group are fitted with a small noise, the priors (e.g. the coarser levels and
+ * the previous folds) with a large noise, since they are measured on other data and only show the good region
+ * next() returns the point of the largest expected improvement over the best observation of the current group
+ * the results of the last ms_bo_priors trainings are kept in the history (process wide) to seed the next selections
+ * the partition groups of a level run at the same time, hence the history is frozen during their batch:
+ * they all read the history before the level and their results are appended in the group order after it
+ */
+class BayesOpt{
+public:
+    BayesOpt(double c_min, double c_max, double g_min, double g_max);
+
+    void add_prior(const bo_observation& obs);
+    void add(const bo_observation& obs);
+
+    // returns the expected improvement (G-mean) of the best point of the grid, log_c and log_g are set to it
+    double next(double& log_c, double& log_g);
+
+    // history of the selections, the last max_num observations (all the levels, groups and folds)
+    static void record(const bo_observation& obs, int group_id = 0);
+    static std::vector<bo_observation> history(unsigned int max_num);
+    // between these the history doesn't change, the observations are kept per group and appended at end_batch
+    static void begin_batch();
+    static void end_batch();
+
+private:
+    static const int grid_size = 41;                // candidates on each axis for the expected improvement
+    double c_min_, c_max_, g_min_, g_max_;
+    std::vector<bo_observation> v_obs_;
+    std::vector<double> v_noise_;
+    double best_gmean_ = -1;                        // of the current group
+
+    static std::mutex& history_mutex();
+    static std::vector<bo_observation>& v_history();
+    static bool& in_batch();
+    static std::map<int, std::vector<bo_observation>>& map_batch();   // group id -> its observations in the batch
+    static void trim_history();                     // keeps the last ms_bo_priors, the caller holds the history mutex
+
+    double kernel(const bo_observation& a, double log_c, double log_g, double length) const;
+    // the lower triangular factor of the covariance, returns the log marginal likelihood (-inf if it is not positive definite)
+    double factorize(double length, const std::vector<double>& v_y, std::vector<double>& L, std::vector<double>& v_alpha) const;
+};
+
+#endif // BAYES_OPT_H
@@ -0,0 +1,71 @@
+#include "buffer_pool.h"
+#include <cstdio>
+#include <cstdlib>
+#include <sys/mman.h>
+
+static const size_t bp_min_size = 256;
+static const size_t bp_cache_line = 64;
+static const size_t bp_huge_page = 2 << 20;
+
+
+size_t BufferPool::size_class(size_t num_bytes){
+    size_t sz = bp_min_size;
+    while(sz < num_bytes)
+        sz <<= 1;
+    return sz;
+}
+
+
+void * BufferPool::acquire(size_t num_bytes){
+    size_t sz = size_class(num_bytes);
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::vector<void *>& v_free = free_buffers_[sz];
+    void * ptr = NULL;
+    if(!v_free.empty()){
+        ptr = v_free.back();
+        v_free.pop_back();
+        ++num_reused_;
+    }else{
+        size_t alignment = (sz >= bp_huge_page) ? bp_huge_page : bp_cache_line;
+        if(posix_memalign(&ptr, alignment, sz) != 0){
+            fprintf(stderr, "[BP][Acquire] allocation of %zu bytes failed, Exit!\n", sz);
+            exit(1);
+        }
+#ifdef MADV_HUGEPAGE
+        if(sz >= bp_huge_page)
+            madvise(ptr, sz, MADV_HUGEPAGE);    // only a hint, the small pages are fine too
+#endif
+        ++num_new_;
+        total_bytes_ += sz;
+    }
+    in_use_[ptr] = sz;
+    return ptr;
+}
+
+
+void BufferPool::release(void * ptr){
+    if(ptr == NULL)
+        return;
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::unordered_map<void *, size_t>::iterator it = in_use_.find(ptr);
+    if(it == in_use_.end()){
+        fprintf(stderr, "[BP][Release] the buffer doesn't belong to the pool, Exit!\n");
+        exit(1);
+    }
+    free_buffers_[it->second].push_back(ptr);
+    in_use_.erase(it);
+}
+
+
+void BufferPool::print_stats(const char * caller) const{
+    std::lock_guard<std::mutex> lock(mtx_);
+    printf("%s buffer pool new:%ld, reused:%ld, total size:%zu bytes\n", caller, num_new_, num_reused_, total_bytes_);
+}
+
+
+BufferPool::~BufferPool(){
+    for(auto& sz_buffers : free_buffers_)
+        for(void * ptr : sz_buffers.second)
+            free(ptr);
+    // the buffers in use are not freed, a model of a Solver which is not freed may still point to them
+}
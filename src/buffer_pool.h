@@ -0,0 +1,44 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <cstddef>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+
+/*
+ * Pool of aligned buffers that are reused by the trainings (problem arrays of the Solver)
+ * the sizes are rounded up to a power of two, hence a released buffer serves the next training of a similar size
+ * the buffers of at least 2MB are aligned to 2MB and advised to use the transparent huge pages
+ * the owner (model selection / refinement) keeps the pool alive as long as the Solvers which use it
+ * the released buffers are freed when the pool is destroyed (the ones in use are left to their Solvers)
+ */
+class BufferPool{
+public:
+    BufferPool(){}
+    ~BufferPool();
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    void * acquire(size_t num_bytes);
+    void release(void * ptr);           // NULL is ignored
+
+    template<typename T> T * acquire_array(size_t num_elements){
+        return (T *) acquire(num_elements * sizeof(T));
+    }
+
+    void print_stats(const char * caller) const;
+
+private:
+    mutable std::mutex mtx_;
+    std::map<size_t, std::vector<void *> > free_buffers_;    // size class -> released buffers
+    std::unordered_map<void *, size_t> in_use_;             // buffer -> size class
+    long num_new_ = 0;
+    long num_reused_ = 0;
+    size_t total_bytes_ = 0;
+
+    static size_t size_class(size_t num_bytes);
+};
+
+#endif // BUFFER_POOL_H
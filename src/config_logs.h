@@ -97,6 +97,7 @@
 #define dbl_SV_TM                   0           // 0 Default    1 prints C, gamma
 #define dbl_SV_PDTMIB               0           // 0 Default    1 prints C, gamma
 #define dbl_SV_TM_report_time       0           // 0 Default    1 prints time of train_model
+#define dbl_SV_MP                   0           // 0 Default    1 retrains in double and prints the agreement of the mixed precision model
 #define dbl_SV_test_predict         0           // 0 Default    1 prints the details        3 prints the test data summary
 #define dbl_SV_TPIB                 0           // 0 Default    1 prints the details        //1 cause many nan in partitioning mode
 #define dbl_SV_predict_label        0           // 0 Default    3 prints the both labels
@@ -116,6 +117,7 @@
 
 #define dbl_SV_PDTPIB               0           // 0 Default    1 prints the details
 #define export_SVM_models           0           // 0 Default    1 Save the SVM models in svm_models folder
+#define export_SVM_models_format    1           // 1 Default binary (.svmbin, written in background)   0 libsvm text (.svmmodel)   2 both
 #define save_test_files             0           // 0 Default removes the test file, 	1 keeps them
 #define dbl_exp_train_data          0           // 0 Default, 1 only export the data for comparison with other solvers
 #define timer_complexity_analysis   0           // 0 Default, 1 only for reporting the detail of time for coarsening and refinement
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <fstream>          // export models information to file
 #include "pugixml.hpp"
+#include "dist_tasks.h"
 //#include <time.h>
 //#include <ctime>
 #include <chrono>
@@ -21,6 +22,8 @@ void Config_params::print_classification_training_params(){
                  "\nds_path: "              << get_ds_path()          <<
                  "\nds_name: "              << get_ds_name()          <<
                  "\ntmp_path: "             << get_tmp_path()          <<
+                 "\ntelemetry_file: "       << get_telemetry_file()    <<
+                 "\nms_cache_file: "        << get_ms_cache_file()     <<
                  std::endl;
 
     std::cout << "\ncpp_srand_seed: " <<get_cpp_srand_seed()<< std::endl;
@@ -66,6 +69,17 @@ void Config_params::print_classification_training_params(){
                  "\nms_VD_sample_size_fraction: "  << get_ms_VD_sample_size_fraction()    <<
                  "\nms_svm_id: "                   << get_ms_svm_id()                     <<
                  "\nms_bs_gm_threshold: "          << get_ms_bs_gm_threshold()            <<
+                 "\nms_warm_start: "               << get_ms_warm_start()                 <<
+                 "\nms_shared_cache_size: "        << get_ms_shared_cache_size()          <<
+                 "\nms_threads: "                  << get_ms_threads()                    <<
+                 "\nms_method: "                   << get_ms_method()                     <<
+                 "\nms_sh_candidates: "            << get_ms_sh_candidates()              <<
+                 "\nms_sh_eta: "                   << get_ms_sh_eta()                     <<
+                 "\nms_sh_eps: "                   << get_ms_sh_eps()                     <<
+                 "\nms_bo_init: "                  << get_ms_bo_init()                    <<
+                 "\nms_bo_max_evals: "             << get_ms_bo_max_evals()               <<
+                 "\nms_bo_ei_tol: "                << get_ms_bo_ei_tol()                  <<
+                 "\nms_bo_priors: "                << get_ms_bo_priors()                  <<
                  std::endl;
 //                 "\nms_validation_part: " << get_ms_validation_part()   <<
 
@@ -77,6 +91,16 @@ void Config_params::print_classification_training_params(){
                  "\ncoef0: "            << coef0                    <<
                  "\nnu: "               << nu                       <<
                  "\ncache_size: "       << cache_size               <<
+                 "\ncache_arena_size: " << cache_arena_size         <<
+                 "\nsmo_threads: "      << get_svm_smo_threads()    <<
+                 "\nsmo_parallel_min_size: " << smo_parallel_min_size <<
+                 "\nfold_threads: "     << fold_threads             <<
+                 "\nmixed_precision: "  << get_svm_mixed_precision() <<
+                 "\nfull_kernel_max_size: " << full_kernel_max_size <<
+                 "\nlinear_weights: "   << linear_weights           <<
+                 "\nearly_exit: "       << early_exit               <<
+                 "\nrff_dim: "          << get_svm_rff_dim()        <<
+                 "\nrff_check: "        << get_svm_rff_check()      <<
                  "\nC: "                << get_svm_C()              <<
                  "\neps: "              << get_svm_eps()            <<
                  "\np: "                << p                        <<
@@ -89,11 +113,14 @@ void Config_params::print_classification_training_params(){
                  "\nadd_fraction: "             << get_rf_add_fraction()                <<
                  "\nrf_add_distant_point_status(2nd): "   << get_rf_add_distant_point_status()      <<
                  "\nrf_weight_vol: "            << get_rf_weight_vol()                  <<
+                 "\nrf_patience: "              << get_rf_patience()                    <<
+                 "\nrf_gm_tol: "                << get_rf_gm_tol()                      <<
                  "\npr_start_partitioning: "    << get_pr_start_partitioning()          <<
                  std::endl;
 
     std::cout << "--- Partitioning Paramters ---" <<
                  "\npr_partition_max_size: "      << get_pr_partition_max_size()        <<
+                 "\npr_adaptive: "                << get_pr_adaptive()                  <<
                  "\npr_maj_voting_id: "           << get_pr_maj_voting_id()             <<
                  std::endl;
 //    */
@@ -106,7 +133,9 @@ void Config_params::print_classification_prediction_params(){
                  "\ntmp_path: "             << get_tmp_path()          <<
                  "\nexperiment_id: "        << get_experiment_id()     <<
                  "\nds_name: "              << get_kfold_id()          <<
-                 "\npr_maj_voting_id: "     << get_pr_maj_voting_id()  << std::endl;
+                 "\npr_maj_voting_id: "     << get_pr_maj_voting_id()  <<
+                 "\nrff_dim: "              << get_svm_rff_dim()       <<
+                 "\nrff_check: "            << get_svm_rff_check()     << std::endl;
 }
 
 void Config_params::print_convert_files_params(){
@@ -256,6 +285,8 @@ void Config_params::read_classification_training_parameters(pugi::xml_node& root
     ds_path             = root.child("ds_path").attribute("stringVal").value();
     ds_name             = root.child("ds_name").attribute("stringVal").value();
     tmp_path            = root.child("tmp_path").attribute("stringVal").value();
+    telemetry_file      = root.child("telemetry_file").attribute("stringVal").value();
+    ms_cache_file       = root.child("ms_cache_file").attribute("stringVal").value();
     pre_init_loader_matrix = root.child("pre_init_loader_matrix").attribute("intVal").as_int();
     inverse_weight      = root.child("inverse_weight").attribute("boolVal").as_bool();
     ld_weight_type      = root.child("ld_weight_type").attribute("intVal").as_int();
@@ -280,6 +311,17 @@ void Config_params::read_classification_training_parameters(pugi::xml_node& root
     ms_bs_gm_threshold  = root.child("ms_bs_gm_threshold").attribute("doubleVal").as_double();
     ms_best_selection   = root.child("ms_best_selection").attribute("intVal").as_int();
     ms_save_final_model = root.child("ms_save_final_model").attribute("intVal").as_int();
+    ms_warm_start       = root.child("ms_warm_start").attribute("intVal").as_int();
+    ms_shared_cache_size = root.child("ms_shared_cache_size").attribute("doubleVal").as_double();
+    ms_threads          = root.child("ms_threads").attribute("intVal").as_int();
+    ms_method           = root.child("ms_method").attribute("intVal").as_int();
+    ms_sh_candidates    = root.child("ms_sh_candidates").attribute("intVal").as_int();
+    ms_sh_eta           = root.child("ms_sh_eta").attribute("intVal").as_int();
+    ms_sh_eps           = root.child("ms_sh_eps").attribute("doubleVal").as_double();
+    ms_bo_init          = root.child("ms_bo_init").attribute("intVal").as_int();
+    ms_bo_max_evals     = root.child("ms_bo_max_evals").attribute("intVal").as_int();
+    ms_bo_ei_tol        = root.child("ms_bo_ei_tol").attribute("doubleVal").as_double();
+    ms_bo_priors        = root.child("ms_bo_priors").attribute("intVal").as_int();
     svm_type    = root.child("svm_svm_type").attribute("intVal").as_int();
     kernel_type = root.child("svm_kernel_type").attribute("intVal").as_int();
     degree      = root.child("svm_degree").attribute("intVal").as_int();
@@ -287,6 +329,16 @@ void Config_params::read_classification_training_parameters(pugi::xml_node& root
     coef0       = root.child("svm_coef0").attribute("doubleVal").as_double();
     nu          = root.child("svm_nu").attribute("doubleVal").as_double();
     cache_size  = root.child("svm_cache_size").attribute("doubleVal").as_double();
+    cache_arena_size = root.child("svm_cache_arena_size").attribute("doubleVal").as_double();
+    smo_threads = root.child("svm_smo_threads").attribute("intVal").as_int();
+    smo_parallel_min_size = root.child("svm_smo_parallel_min_size").attribute("intVal").as_int();
+    fold_threads = root.child("svm_fold_threads").attribute("intVal").as_int();
+    mixed_precision = root.child("svm_mixed_precision").attribute("intVal").as_int();
+    full_kernel_max_size = root.child("svm_full_kernel_max_size").attribute("intVal").as_int();
+    linear_weights = root.child("svm_linear_weights").attribute("intVal").as_int();
+    early_exit = root.child("svm_early_exit").attribute("intVal").as_int();
+    rff_dim = root.child("svm_rff_dim").attribute("intVal").as_int();
+    rff_check = root.child("svm_rff_check").attribute("intVal").as_int();
     C           = root.child("svm_C").attribute("doubleVal").as_double();
     eps         = root.child("svm_eps").attribute("doubleVal").as_double();
     p           = root.child("svm_p").attribute("doubleVal").as_double();
@@ -296,8 +348,11 @@ void Config_params::read_classification_training_parameters(pugi::xml_node& root
     rf_add_fraction                 = root.child("rf_add_fraction").attribute("floatVal").as_float();
     rf_add_distant_point_status     = root.child("rf_add_distant_point_status").attribute("boolVal").as_bool();
     rf_weight_vol                   = root.child("rf_weight_vol").attribute("intVal").as_int();
+    rf_patience                     = root.child("rf_patience").attribute("intVal").as_int();
+    rf_gm_tol                       = root.child("rf_gm_tol").attribute("doubleVal").as_double();
     pr_start_partitioning = root.child("pr_start_partitioning").attribute("intVal").as_int();
     pr_partition_max_size = root.child("pr_partition_max_size").attribute("intVal").as_int();
+    pr_adaptive           = root.child("pr_adaptive").attribute("intVal").as_int();
     pr_maj_voting_id      = root.child("pr_maj_voting_id").attribute("intVal").as_int();
 
     /// read the parameters from input arguments ()
@@ -313,6 +368,8 @@ void Config_params::read_classification_training_parameters(pugi::xml_node& root
     parser_.add_option("--ds_p")                             .dest("ds_path")  .set_default(ds_path);
     parser_.add_option("-f", "--ds_f", "--file")             .dest("ds_name")  .set_default(ds_name);
     parser_.add_option("--tmp_p")                            .dest("tmp_path")  .set_default(tmp_path);
+    parser_.add_option("--telemetry")                        .dest("telemetry_file")  .set_default(telemetry_file);
+    parser_.add_option("--ms_cache")                         .dest("ms_cache_file")  .set_default(ms_cache_file);
     parser_.add_option("--cs_pi")                            .dest("pre_init_loader_matrix")  .set_default(pre_init_loader_matrix);
 //    parser_.add_option("--iw", "--inverse_weight")           .dest("inverse_weight")  .set_default(inverse_weight);
     parser_.add_option("--cs_eta")                           .dest("coarse_Eta")  .set_default(coarse_Eta);
@@ -330,6 +387,17 @@ void Config_params::read_classification_training_parameters(pugi::xml_node& root
     parser_.add_option("-a", "--ms_s1")                      .dest("ms_first_stage")  .set_default(ms_first_stage);
     parser_.add_option("-b", "--ms_s2")                      .dest("ms_second_stage")  .set_default(ms_second_stage);
     parser_.add_option("--ms_bs")                            .dest("ms_best_selection")  .set_default(ms_best_selection);
+    parser_.add_option("--ms_ws")                            .dest("ms_warm_start")  .set_default(ms_warm_start);
+    parser_.add_option("--ms_scs")                           .dest("ms_shared_cache_size")  .set_default(ms_shared_cache_size);
+    parser_.add_option("--ms_threads")                       .dest("ms_threads")  .set_default(ms_threads);
+    parser_.add_option("--ms_method")                        .dest("ms_method")  .set_default(ms_method);
+    parser_.add_option("--ms_sh_candidates")                 .dest("ms_sh_candidates")  .set_default(ms_sh_candidates);
+    parser_.add_option("--ms_sh_eta")                        .dest("ms_sh_eta")  .set_default(ms_sh_eta);
+    parser_.add_option("--ms_sh_eps")                        .dest("ms_sh_eps")  .set_default(ms_sh_eps);
+    parser_.add_option("--ms_bo_init")                       .dest("ms_bo_init")  .set_default(ms_bo_init);
+    parser_.add_option("--ms_bo_max_evals")                  .dest("ms_bo_max_evals")  .set_default(ms_bo_max_evals);
+    parser_.add_option("--ms_bo_ei_tol")                     .dest("ms_bo_ei_tol")  .set_default(ms_bo_ei_tol);
+    parser_.add_option("--ms_bo_priors")                     .dest("ms_bo_priors")  .set_default(ms_bo_priors);
     parser_.add_option("-v")                                 .dest("ms_VD_sample_size_fraction")  .set_default(ms_VD_sample_size_fraction);
     parser_.add_option("-p", "--ms_prt")                     .dest("ms_print_untouch_reuslts")  .set_default(ms_print_untouch_reuslts);
     parser_.add_option("--ms_k")                             .dest("kernel_type")  .set_default(kernel_type);
@@ -338,11 +406,18 @@ void Config_params::read_classification_training_parameters(pugi::xml_node& root
     parser_.add_option("-e", "--ms_eps")                     .dest("eps")  .set_default(eps);
     parser_.add_option("--ms_shrinking")                     .dest("shrinking")  .set_default(shrinking);
     parser_.add_option("--ms_probability")                   .dest("probability")  .set_default(probability);
+    parser_.add_option("--smo_threads")                      .dest("smo_threads")  .set_default(smo_threads);
+    parser_.add_option("--mixed_precision")                  .dest("mixed_precision")  .set_default(mixed_precision);
+    parser_.add_option("--rff_dim")                          .dest("rff_dim")  .set_default(rff_dim);
+    parser_.add_option("--rff_check")                        .dest("rff_check")  .set_default(rff_check);
     parser_.add_option("-z", "--rf_f")                       .dest("rf_add_fraction")  .set_default(rf_add_fraction);
     parser_.add_option("--rf_2nd")                           .dest("rf_add_distant_point_status")     .set_default(rf_add_distant_point_status);
     parser_.add_option("--rf_weight_vol")                    .dest("rf_weight_vol")  .set_default(rf_weight_vol);
+    parser_.add_option("--rf_patience")                      .dest("rf_patience")  .set_default(rf_patience);
+    parser_.add_option("--rf_gm_tol")                        .dest("rf_gm_tol")    .set_default(rf_gm_tol);
     parser_.add_option("--pr_start")                         .dest("pr_start_partitioning")  .set_default(pr_start_partitioning);
     parser_.add_option("--pr_max")                           .dest("pr_partition_max_size")  .set_default(pr_partition_max_size);
+    parser_.add_option("--pr_adaptive")                      .dest("pr_adaptive")  .set_default(pr_adaptive);
     parser_.add_option("--mv_id")                            .dest("pr_maj_voting_id")     .set_default(pr_maj_voting_id);
     // - - - Tools - - -
     parser_.add_option("--sat_p")                            .dest("p_norm_data_f_name")     .set_default("");
@@ -383,6 +458,12 @@ void Config_params::read_classification_prediction_parameters(pugi::xml_node& ro
 
     probability = root.child("svm_probability").attribute("intVal").as_int();       //the solver constructor has this
     parser_.add_option("--ms_probability")                   .dest("probability")  .set_default(probability);
+    linear_weights = root.child("svm_linear_weights").attribute("intVal").as_int();
+    early_exit = root.child("svm_early_exit").attribute("intVal").as_int();
+    rff_dim = root.child("svm_rff_dim").attribute("intVal").as_int();
+    rff_check = root.child("svm_rff_check").attribute("intVal").as_int();
+    parser_.add_option("--rff_dim")                          .dest("rff_dim")  .set_default(rff_dim);
+    parser_.add_option("--rff_check")                        .dest("rff_check")  .set_default(rff_check);
     this->options_ = parser_.parse_args(argc, argv);
     std::vector<std::string> args = parser_.args();
     if(experiment_id < 0 || kfold_id < 0) {
@@ -580,6 +661,9 @@ void Config_params::debug_only_set_p_norm_data_path_file_name(std::string const
 void Config_params::debug_only_set_n_norm_data_path_file_name(std::string const path_file_name){
     n_norm_data_f_name  = path_file_name;
 }
+void Config_params::debug_only_set_ms_cache_file(std::string const f_name){
+    options_["ms_cache_file"] = f_name;
+}
 
 
 void Config_params::update_srand_seed(){
@@ -823,14 +907,15 @@ void Config_params::read_zscore_parameters(pugi::xml_node& root,int argc, char *
 }
 
 void Config_params::set_current_iter_file_names(int curr_exp, int curr_iter){
+    // each MPI rank writes its own files (see DistTasks)
     set_test_ds_f_name(get_tmp_path() +"kfold_test_data_exp_"+ std::to_string(curr_exp)+"_fold_"+
-                        std::to_string((curr_iter))+ "_exp_" + get_exp_info());
+                        std::to_string((curr_iter))+ "_exp_" + get_exp_info() + DistTasks::file_suffix());
 
     set_p_e_k_train_data_f_name(get_tmp_path() +"kfold_p_train_data_exp_"+ std::to_string(curr_exp)+
-                                "_fold_"+ std::to_string((curr_iter))+ "_exp_" + get_exp_info());
+                                "_fold_"+ std::to_string((curr_iter))+ "_exp_" + get_exp_info() + DistTasks::file_suffix());
 
     set_n_e_k_train_data_f_name(get_tmp_path() +"kfold_n_train_data_exp_"+std::to_string(curr_exp)+
-                                "_fold_"+ std::to_string((curr_iter))+ "_exp_" + get_exp_info());
+                                "_fold_"+ std::to_string((curr_iter))+ "_exp_" + get_exp_info() + DistTasks::file_suffix());
 }
 
 
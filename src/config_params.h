@@ -63,6 +63,8 @@ private:
     std::string ds_path;
     std::string ds_name;
     std::string tmp_path;
+    std::string telemetry_file;     // CSV of the training statistics (empty disables)
+    std::string ms_cache_file;      // results of the model selection trainings for the next runs (empty disables)
     int         pre_init_loader_matrix;
     bool        inverse_weight;
     int         ld_weight_type;
@@ -90,6 +92,17 @@ private:
     int     ms_print_untouch_reuslts;
     double  ms_bs_gm_threshold;
     int     ms_save_final_model;
+    int     ms_warm_start;          // seed the SMO with alphas from the previous stage/level
+    double  ms_shared_cache_size;   // MB, kernel rows shared between the candidates (0 disables)
+    int     ms_threads;             // folds and candidates of the model selection trained at the same time (1 is serial)
+    int     ms_method;              // 0: two stage uniform design, 1: successive halving, 2: Bayesian optimization
+    int     ms_sh_candidates;       // candidates of the 1st rung of the successive halving (UD pattern of 3 to 30 points)
+    int     ms_sh_eta;              // each rung keeps 1/eta of its candidates and the next rung has eta times more points
+    double  ms_sh_eps;              // stopping tolerance of the rungs on the subsamples (the last rung uses svm_eps)
+    int     ms_bo_init;             // UD points of the Bayesian optimization before the first expected improvement
+    int     ms_bo_max_evals;        // trainings of the Bayesian optimization after the UD points
+    double  ms_bo_ei_tol;           // the Bayesian optimization stops if the expected improvement of G-mean is less
+    int     ms_bo_priors;           // last observations of the previous selections (coarser levels, folds) as priors
     //======= SVM ========
     int     svm_type;
     int     kernel_type;
@@ -98,6 +111,16 @@ private:
     double  coef0;
     double  nu;
     double  cache_size;
+    double  cache_arena_size;       // MB, one budget for the kernel caches of all trainings (0 disables)
+    int     smo_threads;            // threads of the parallel SMO (1 is serial)
+    int     smo_parallel_min_size;  // smaller active sets stay serial
+    int     fold_threads;           // parallel folds of the libsvm internal cross validation (probability estimates)
+    int     mixed_precision;        // single precision kernels for training
+    int     full_kernel_max_size;   // smaller problems compute the full kernel matrix instead of the LRU cache
+    int     linear_weights;         // collapse the linear models to a weight vector for prediction
+    int     early_exit;             // RBF prediction stops once the remaining SVs can't change the label
+    int     rff_dim;                // random Fourier features of the approximate RBF prediction (0 disables)
+    int     rff_check;              // sampled points of the agreement report of the random features (0 disables)
     double  C;
     double  eps;
     double  p;
@@ -108,11 +131,14 @@ private:
     float   rf_add_fraction;
     bool    rf_add_distant_point_status;
     int     rf_weight_vol;
+    int     rf_patience;            // refined levels without a better validation G-mean before the finer levels are skipped (0 disables)
+    double  rf_gm_tol;              // smaller gains of the validation G-mean don't count as an improvement
     std::vector<std::pair<int,int>> master_models_info;
     std::vector<int> levels_models_info;
     //========== Partitioning ==========
     int     pr_start_partitioning;
     int     pr_partition_max_size;
+    int     pr_adaptive;            // timed trainings of the cost model which sizes the partitions of each level (0 disables)
     int     pr_maj_voting_id;
 
 //    std::vector<iter_summary> all_summary;
@@ -162,6 +188,7 @@ public:
     void set_ds_name(std::string const new_ds_name);
     void debug_only_set_p_norm_data_path_file_name(std::string const path_file_name);
     void debug_only_set_n_norm_data_path_file_name(std::string const path_file_name);
+    void debug_only_set_ms_cache_file(std::string const f_name);        // ResultCache::init loads the new file
 
     void init_to_default();
     void read_params(std::string XML_FILE_PATH,int argc, char * argv[], program_parts caller_func=main);
@@ -173,6 +200,8 @@ public:
     const std::string &get_ds_path()    const { return options_["ds_path"];}
     const std::string &get_ds_name()    const { return options_["ds_name"];}
     std::string get_tmp_path()   const ;
+    const std::string &get_telemetry_file() const { return options_["telemetry_file"];}
+    const std::string &get_ms_cache_file()  const { return options_["ms_cache_file"];}
     const std::string &get_exp_info()   const { return options_["exp_info"];}
 
     const std::string &get_p_indices_f_name()           const {return p_indices_f_name;}
@@ -258,6 +287,17 @@ public:
 
     double  get_ms_bs_gm_threshold()    const { return ms_bs_gm_threshold; }
     int     get_ms_best_selection()     const { return stoi(options_["ms_best_selection"]); }
+    bool    get_ms_warm_start()         const { return (bool) stoi(options_["ms_warm_start"]); }
+    double  get_ms_shared_cache_size()  const { return stod(options_["ms_shared_cache_size"]); }
+    int     get_ms_threads()            const { return stoi(options_["ms_threads"]); }
+    int     get_ms_method()             const { return stoi(options_["ms_method"]); }
+    int     get_ms_sh_candidates()      const { return stoi(options_["ms_sh_candidates"]); }
+    int     get_ms_sh_eta()             const { return stoi(options_["ms_sh_eta"]); }
+    double  get_ms_sh_eps()             const { return stod(options_["ms_sh_eps"]); }
+    int     get_ms_bo_init()            const { return stoi(options_["ms_bo_init"]); }
+    int     get_ms_bo_max_evals()       const { return stoi(options_["ms_bo_max_evals"]); }
+    double  get_ms_bo_ei_tol()          const { return stod(options_["ms_bo_ei_tol"]); }
+    int     get_ms_bo_priors()          const { return stoi(options_["ms_bo_priors"]); }
 
     // SVM
     int     get_svm_svm_type()      const { return svm_type; }
@@ -267,6 +307,16 @@ public:
     double  get_svm_coef0()         const { return coef0; }
     double  get_svm_nu()            const { return nu; }
     double  get_svm_cache_size()    const { return cache_size; }
+    double  get_svm_cache_arena_size()  const { return cache_arena_size; }
+    int     get_svm_smo_threads()       const { return stoi(options_["smo_threads"]); }
+    int     get_svm_smo_parallel_min_size() const { return smo_parallel_min_size; }
+    int     get_svm_fold_threads()      const { return fold_threads; }
+    bool    get_svm_mixed_precision()   const { return (bool) stoi(options_["mixed_precision"]); }
+    int     get_svm_full_kernel_max_size()  const { return full_kernel_max_size; }
+    bool    get_svm_linear_weights()    const { return (bool) linear_weights; }
+    bool    get_svm_early_exit()        const { return (bool) early_exit; }
+    int     get_svm_rff_dim()           const { return stoi(options_["rff_dim"]); }
+    int     get_svm_rff_check()         const { return stoi(options_["rff_check"]); }
     double  get_svm_p()             const { return p; }
     int     get_svm_nr_weight()     const { return nr_weight; }
     double  get_svm_C()             const { return  stod(options_["C"]); }
@@ -278,6 +328,8 @@ public:
     bool    get_rf_add_distant_point_status()   const { return (bool) stoi(options_["rf_add_distant_point_status"]); }
     float   get_rf_add_fraction()               const { return  stof(options_["rf_add_fraction"]); }
     int     get_rf_weight_vol()                 const { return  stoi(options_["rf_weight_vol"]); }
+    int     get_rf_patience()                   const { return  stoi(options_["rf_patience"]); }
+    double  get_rf_gm_tol()                     const { return  stod(options_["rf_gm_tol"]); }
     void    set_master_models_info();
     void    set_levels_models_info();
 //    void    check_models_metadata();        //for debug
@@ -289,6 +341,7 @@ public:
     int     get_pr_maj_voting_id() const         { return  stoi(options_["pr_maj_voting_id"]); }
     int     get_pr_start_partitioning()         const { return  stoi(options_["pr_start_partitioning"]); }
     int     get_pr_partition_max_size()         const { return  stoi(options_["pr_partition_max_size"]); }
+    int     get_pr_adaptive()                   const { return  stoi(options_["pr_adaptive"]); }
 
     // - - - - - Classification prediction  - - - - -
     int    get_experiment_id()      const { return stoi(options_["experiment_id"]);}
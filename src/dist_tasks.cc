@@ -0,0 +1,119 @@
+#include "dist_tasks.h"
+#include <petscsys.h>
+
+int DistTasks::rank_ = 0;
+int DistTasks::size_ = 1;
+bool DistTasks::mpi_initialized_ = false;
+
+// the values of a summary in the gathered array
+enum { SF_ITER, SF_C, SF_GAMMA, SF_NSV_P, SF_NSV_N, SF_PERF_MASK, SF_PERF,
+       SF_TELEMETRY = SF_PERF + NPV + 1, SF_NUM = SF_TELEMETRY + 11 };
+
+
+void DistTasks::init(int *argc, char ***argv){
+    int initialized, provided;
+    MPI_Initialized(&initialized);
+    if(!initialized){
+        // the task pool and OpenMP run threads, only the main thread calls MPI
+        MPI_Init_thread(argc, argv, MPI_THREAD_FUNNELED, &provided);
+        mpi_initialized_ = true;
+    }else{
+        MPI_Query_thread(&provided);
+    }
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank_);
+    MPI_Comm_size(MPI_COMM_WORLD, &size_);
+    if(size_ > 1 && provided < MPI_THREAD_FUNNELED){
+        fprintf(stderr, "[DT] the MPI library provides the thread level %d, MPI_THREAD_FUNNELED (%d) is needed, Exit!\n",
+                provided, MPI_THREAD_FUNNELED);
+        exit(1);
+    }
+    if(size_ > 1){
+        PETSC_COMM_WORLD = MPI_COMM_SELF;           // the data and the solvers are local to each rank
+        printf("[DT] rank %d of %d, the model selection trainings are distributed\n", rank_, size_);
+    }
+}
+
+
+void DistTasks::finalize(){
+    if(mpi_initialized_)
+        MPI_Finalize();
+}
+
+
+void DistTasks::gather(std::vector<summary>& v_summary, int first, int num){
+    if(size_ == 1 || num == 0)
+        return;
+    // each task is set by one rank and it is zero in the others, hence the sum is the value of the owner
+    std::vector<double> v_values(num * SF_NUM, 0);
+    for(int i=0; i < num; i++){
+        if(!owns(first + i))
+            continue;
+        const summary& in = v_summary[first + i];
+        double * values = &v_values[i * SF_NUM];
+        values[SF_ITER] = in.iter;
+        values[SF_C] = in.C;
+        values[SF_GAMMA] = in.gamma;
+        values[SF_NSV_P] = in.num_SV_p;
+        values[SF_NSV_N] = in.num_SV_n;
+        long perf_mask = 0;
+        for(std::map<measures,double>::const_iterator it = in.perf.begin(); it != in.perf.end(); ++it){
+            perf_mask |= 1L << it->first;
+            values[SF_PERF + it->first] = it->second;
+        }
+        values[SF_PERF_MASK] = perf_mask;
+        const train_telemetry& tt = in.telemetry;
+        double * tele = values + SF_TELEMETRY;
+        tele[0] = tt.num_trainings;     tele[1] = tt.iterations;        tele[2] = tt.kernel_evals;
+        tele[3] = tt.cache_hits;        tele[4] = tt.cache_misses;      tele[5] = tt.shrink_rounds;
+        tele[6] = tt.reconstructions;   tele[7] = tt.max_iter_reached;  tele[8] = tt.build_time;
+        tele[9] = tt.solve_time;        tele[10] = tt.predict_time;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, v_values.data(), num * SF_NUM, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    for(int i=0; i < num; i++){
+        if(owns(first + i))
+            continue;
+        summary& out = v_summary[first + i];
+        const double * values = &v_values[i * SF_NUM];
+        out.iter = (int) values[SF_ITER];
+        out.C = values[SF_C];
+        out.gamma = values[SF_GAMMA];
+        out.num_SV_p = (int) values[SF_NSV_P];
+        out.num_SV_n = (int) values[SF_NSV_N];
+        long perf_mask = (long) values[SF_PERF_MASK];
+        out.perf.clear();
+        for(int m = 0; m <= NPV; m++){
+            if(perf_mask & (1L << m))
+                out.perf[(measures) m] = values[SF_PERF + m];
+        }
+        const double * tele = values + SF_TELEMETRY;
+        train_telemetry& tt = out.telemetry;
+        tt.num_trainings = (int) tele[0];       tt.iterations = (long) tele[1];     tt.kernel_evals = (long) tele[2];
+        tt.cache_hits = (long) tele[3];         tt.cache_misses = (long) tele[4];   tt.shrink_rounds = (long) tele[5];
+        tt.reconstructions = (long) tele[6];    tt.max_iter_reached = (int) tele[7]; tt.build_time = tele[8];
+        tt.solve_time = tele[9];                tt.predict_time = tele[10];
+    }
+}
+
+
+void DistTasks::broadcast(int& value){
+    if(size_ > 1)
+        MPI_Bcast(&value, 1, MPI_INT, 0, MPI_COMM_WORLD);
+}
+
+
+void DistTasks::broadcast(std::vector<double>& v_values, int root){
+    if(size_ == 1)
+        return;
+    int num = v_values.size();
+    MPI_Bcast(&num, 1, MPI_INT, root, MPI_COMM_WORLD);
+    v_values.resize(num);
+    if(num > 0)
+        MPI_Bcast(v_values.data(), num, MPI_DOUBLE, root, MPI_COMM_WORLD);
+}
+
+
+void DistTasks::barrier(){
+    if(size_ > 1)
+        MPI_Barrier(MPI_COMM_WORLD);
+}
@@ -0,0 +1,48 @@
+#ifndef DIST_TASKS_H
+#define DIST_TASKS_H
+
+#include "ds_global.h"
+#include <string>
+#include <vector>
+
+/*
+ * distribution of the model selection trainings over the MPI ranks (e.g. mpirun -n 4 ./mlsvm_classifier)
+ * every rank runs the whole multilevel solver on its own copy of the data (init makes PETSC_COMM_WORLD the
+ * MPI_COMM_SELF of each rank), only the candidates of the model selections are split between the ranks:
+ * the rank r trains the candidates r, r+N, r+2N, ... and gather() gives all the summaries to all the ranks
+ * the seeds are the same on all the ranks, hence they select the same models and stay in step,
+ * the owner of the selected model broadcasts it (Solver::get_model_values) and the other ranks build it on their
+ * copy of the problem (its model is needed for the finer level), it is trained again only if it came from the cache,
+ * the warm start of the 2nd stage is broadcast from the owner of the 1st stage winner
+ * only the main thread calls MPI (MPI_THREAD_FUNNELED), the partition groups are serial with multiple ranks
+ * with a single rank (no mpirun) nothing changes
+ */
+class DistTasks{
+public:
+    static void init(int *argc, char ***argv);      // before PetscInitialize
+    static void finalize();                         // after PetscFinalize
+
+    static int rank()                   { return rank_; }
+    static int size()                   { return size_; }
+    static bool distributed()           { return size_ > 1; }
+    static bool is_root()               { return rank_ == 0; }      // writes the shared files (e.g. telemetry)
+    static bool owns(int task_id)       { return task_id % size_ == rank_; }
+    static int owner(int task_id)       { return task_id % size_; }
+    static std::string file_suffix()    { return distributed() ? "_rank" + std::to_string(rank_) : ""; }
+
+    // v_summary[first, first + num) of each rank are set only for the tasks it owns, all of them are set after this
+    static void gather(std::vector<summary>& v_summary, int first, int num);
+    // the value of the first rank, e.g. a decision which depends on the timings of each rank
+    static void broadcast(int& value);
+    // the vector of the root rank (any size, e.g. the alphas of a model it trained) in all the ranks
+    static void broadcast(std::vector<double>& v_values, int root);
+    // returns after all the ranks call it
+    static void barrier();
+
+private:
+    static int rank_;
+    static int size_;
+    static bool mpi_initialized_;                   // MPI is initialized here, hence it is finalized here
+};
+
+#endif // DIST_TASKS_H
@@ -32,11 +32,42 @@ enum measures {TP, TN, FP, FN, Acc, Sens, Spec, Gmean, F1, PPV, NPV};
 struct solution{
     std::vector<int> p_index;
     std::vector<int> n_index;
+    std::vector<double> p_alpha;        // alpha of each SV in p_index (empty if it is not available)
+    std::vector<double> n_alpha;        // alpha of each SV in n_index
     double C, gamma;
 };
 
 
 
+// statistics of the trainings behind a summary (a single training, or the sum of a group / level)
+struct train_telemetry{
+    int num_trainings = 0;
+    long iterations = 0;            // SMO iterations
+    long kernel_evals = 0;          // computed kernel values
+    long cache_hits = 0;            // requested kernel columns which were in the cache
+    long cache_misses = 0;
+    long shrink_rounds = 0;
+    long reconstructions = 0;       // gradient reconstructions after the shrinking
+    int max_iter_reached = 0;       // trainings which stopped at the iteration limit
+    double build_time = 0;          // wall seconds to build the problem, solve and predict the validation data
+    double solve_time = 0;
+    double predict_time = 0;
+
+    void add(const train_telemetry& other){
+        num_trainings += other.num_trainings;
+        iterations += other.iterations;
+        kernel_evals += other.kernel_evals;
+        cache_hits += other.cache_hits;
+        cache_misses += other.cache_misses;
+        shrink_rounds += other.shrink_rounds;
+        reconstructions += other.reconstructions;
+        max_iter_reached += other.max_iter_reached;
+        build_time += other.build_time;
+        solve_time += other.solve_time;
+        predict_time += other.predict_time;
+    }
+};
+
 struct summary{
     int iter;
 //    double gmean;
@@ -51,6 +82,7 @@ struct summary{
         return (this->perf.at(Gmean) > new_.perf.at(Gmean));
     }
     int selected_level = -1;
+    train_telemetry telemetry;
 };
 
 struct ref_results{
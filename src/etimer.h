@@ -2,7 +2,7 @@
 #define ETIMER_H
 
 #include <ctime>
-//#include <chrono>
+#include <chrono>
 #include <iostream>
 #include "config_logs.h"
 
@@ -10,13 +10,16 @@ class ETimer{
 private:
 //    std::chrono::high_resolution_clock::time_point t1,t2;
     std::clock_t start_cpu_time;
+    std::chrono::steady_clock::time_point start_wall_time;
 public:
 //    ETimer(){t1 = std::chrono::high_resolution_clock::now(); }
 
-    ETimer(){start_cpu_time = std::clock(); }
+    ETimer(){start_cpu_time = std::clock(); start_wall_time = std::chrono::steady_clock::now(); }
 
     void stop_timer(const std::string desc);
     void stop_timer(const std::string desc1, const std::string desc2);
+    // wall seconds, the CPU time of the process counts the other threads (concurrent groups, parallel SMO) too
+    double get_elapsed() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_wall_time).count(); }
 };
 
 #endif // ETIMER_H
@@ -894,7 +894,7 @@ void k_fold::prepare_traindata_for_flann(){
 void k_fold::cross_validation_simple(Mat& m_data_p, Mat& m_data_n, Vec& v_vol_p, Vec& v_vol_n,
                                      int current_iteration, int total_iterations,
                                      Mat& m_train_data_p, Mat& m_train_data_n, Mat& m_test_data,
-                                     Vec& v_train_vol_p, Vec& v_train_vol_n){
+                                     Vec& v_train_vol_p, Vec& v_train_vol_n, std::vector<int> * v_train_ids){
 #if dbl_KF_CVS >= 3
     PetscPrintf(PETSC_COMM_WORLD, "[KF][CVS] start!\n");
 #endif
@@ -1097,6 +1097,15 @@ void k_fold::cross_validation_simple(Mat& m_data_p, Mat& m_data_n, Vec& v_vol_p,
     PetscPrintf(PETSC_COMM_WORLD, "[KF][CVS] ISs are created \n");
 #endif
 
+    if(v_train_ids != NULL){
+        v_train_ids->clear();
+        v_train_ids->reserve(min_train_size + maj_train_size);
+        for(int i=0; i< min_train_size; i++)
+            v_train_ids->push_back(ind_min_train[i]);
+        for(int i=0; i< maj_train_size; i++)
+            v_train_ids->push_back(num_point_p + ind_maj_train[i]);
+    }
+
     PetscFree(ind_min_train);      //release memory for arrays
     PetscFree(ind_maj_train);
     PetscFree(ind_min_test);
@@ -112,11 +112,13 @@ public:
      * Take the rest as training for that class
      * Combine both test parts with labels as one test matrix
      * Note: iteration should start from ZERO
+     * v_train_ids (optional) gets the rows of the training points, positive points first and
+     *  the negative ones shifted by the number of positive points (used to share the kernel between folds)
      */
     void cross_validation_simple(Mat& m_data_p, Mat& m_data_n, Vec& v_vol_p, Vec& v_vol_n,
                                  int current_iteration, int total_iterations,
                                  Mat& m_train_data_p, Mat& m_train_data_n, Mat& m_test_data,
-                                 Vec& v_train_vol_p, Vec& v_train_vol_n);
+                                 Vec& v_train_vol_p, Vec& v_train_vol_n, std::vector<int> * v_train_ids = NULL);
 
 
     /*
@@ -172,6 +172,23 @@ solution MainRecursion::main(Mat& p_data, Mat& m_P_p_f, Mat& p_WA, Vec& p_vol,
         }
 
         ///------------------------- Refinement ----------------------------
+        if(Refinement::plateau_reached(v_ref_results)){     // the finer levels are skipped, the best model is from the refined levels
+            printf("[MR] refinement at level:%d is skipped, the validation G-mean has not improved for %d levels\n",
+                   level, Config_params::getInstance()->get_rf_patience());
+            MatDestroy(&p_data);
+            MatDestroy(&n_data);
+            MatDestroy(&p_data_c);
+            MatDestroy(&n_data_c);
+            MatDestroy(&p_WA_c);
+            MatDestroy(&n_WA_c);
+            MatDestroy(&p_WA);
+            MatDestroy(&n_WA);
+            MatDestroy(&m_P_p);
+            MatDestroy(&m_P_n);
+            VecDestroy(&p_vol);
+            VecDestroy(&n_vol);
+            return sol_coarser;
+        }
         ETimer t_refine;
 //        printf("[MR][main] coarse solution from level:%d \n",level+1); //because it comes from coarser level
 //                                                     $                          $
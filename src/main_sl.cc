@@ -6,6 +6,7 @@
 //#include "coarsening.h"         //coarse the WA matrix
 #include "model_selection.h"
 #include "config_params.h"
+#include "result_cache.h"
 #include "ut_mr.h"
 
 #include "common_funcs.h"       //only for debug
@@ -25,6 +26,7 @@ int main(int argc, char **argv)
     Config_params::getInstance()->init_to_default();
     Config_params::getInstance()->read_params("./params.xml", argc, argv);
     Config_params::getInstance()->print_params();
+    ResultCache::getInstance()->init();
 
     int num_repeat_exp_ = Config_params::getInstance()->getInstance()->get_main_num_repeat_exp();
     int num_kf_iter_ = Config_params::getInstance()->getInstance()->get_main_num_kf_iter();
@@ -7,6 +7,10 @@
 #include "model_selection.h"
 #include "config_params.h"
 #include "common_funcs.h"
+#include "model_binary.h"
+#include "dist_tasks.h"
+#include "prediction_set.h"
+#include "result_cache.h"
 //#include "ut_mr.h"
 
 Config_params* Config_params::instance = NULL;
@@ -14,8 +18,15 @@ Config_params* Config_params::instance = NULL;
 int main(int argc, char **argv)
 {
 //    PetscInitialize(&argc, &argv, NULL, NULL);
+    DistTasks::init(&argc, &argv);      // mpirun -n N distributes the model selection trainings
     PetscInitialize(NULL, NULL, NULL, NULL);
     Config_params::getInstance()->read_params("./params.xml", argc, argv);  // read parameters
+    svm_cache_arena_set_budget(Config_params::getInstance()->get_svm_cache_arena_size());
+    svm_set_smo_parallel(Config_params::getInstance()->get_svm_smo_threads(),
+                         Config_params::getInstance()->get_svm_smo_parallel_min_size());
+    svm_set_full_kernel(Config_params::getInstance()->get_svm_full_kernel_max_size());
+    svm_set_fold_parallel(Config_params::getInstance()->get_svm_fold_threads());
+    ResultCache::getInstance()->init();     // all the ranks load the same results before any training
     switch(Config_params::getInstance()->get_main_function()){
     ///*********************************************************************
     ///*                              SVM                                  *
@@ -74,6 +85,15 @@ int main(int argc, char **argv)
                                         Config_params::getInstance()->get_cpp_srand_seed());
 
                 t_sample.stop_timer("[MC] validation data is sampled from the finest training data");
+                // the validation and the test data are converted once for all the predictions of the V-cycle
+                ETimer t_prediction_sets;
+                std::string test_f_name = Config_params::getInstance()->get_test_ds_f_name();
+                Loader test_loader;
+                Mat m_TD = test_loader.load_norm_data_sep(test_f_name);
+                PredictionSet::set_current(std::make_shared<const PredictionSet>(m_VD_p, m_VD_n),
+                                           std::make_shared<const PredictionSet>(m_TD), test_f_name);
+                MatDestroy(&m_TD);
+                t_prediction_sets.stop_timer("[MC] validation and test data are converted for the predictions");
             //====================== Multilevel Solver ===============================
                 ETimer t_solver;
                 Mat m_P_minority, m_P_majority;
@@ -93,6 +113,7 @@ int main(int argc, char **argv)
                 VecDestroy(&v_p_vol);
                 VecDestroy(&v_n_vol);
 
+                PredictionSet::clear_current();
                 MatDestroy(&m_VD_p);    // release the validation data
                 MatDestroy(&m_VD_n);
             #if timer_complexity_analysis == 1
@@ -133,6 +154,7 @@ int main(int argc, char **argv)
 
     #if export_SVM_models == 1
         Config_params::getInstance()->export_models_metadata();
+        ModelBinary::wait_for_writer();
     #endif //export_SVM_models      //in case of exporting the data, the models are not trained and the output is useless
     #endif //dbl_exp_train_data
 
@@ -147,5 +169,6 @@ int main(int argc, char **argv)
 
     }
     PetscFinalize();
+    DistTasks::finalize();
     return 0;
 }
@@ -0,0 +1,331 @@
+#include "model_binary.h"
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char   model_binary_magic[8] = {'M','L','S','V','M','B','I','N'};
+static const int    model_binary_version = 2;
+
+
+/* ==========================================================================================
+ *                                    BACKGROUND WRITER
+ * ==========================================================================================
+ * a single thread writes the serialized models in the order they are queued
+ * the thread starts with the first model and joins at the end of the program
+ */
+class Model_writer{
+public:
+    static Model_writer& instance(){
+        static Model_writer writer;
+        return writer;
+    }
+
+    void push(const std::string& fname, std::vector<char>& v_buffer){
+        std::unique_lock<std::mutex> lock(mtx_);
+        if(!worker_.joinable())
+            worker_ = std::thread(&Model_writer::run, this);
+        queue_.push_back(std::make_pair(fname, std::vector<char>()));
+        queue_.back().second.swap(v_buffer);
+        ++pending_;
+        cv_.notify_all();
+    }
+
+    void wait(){
+        std::unique_lock<std::mutex> lock(mtx_);
+        cv_.wait(lock, [this]{ return pending_ == 0; });
+    }
+
+    ~Model_writer(){
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            stop_ = true;
+            cv_.notify_all();
+        }
+        if(worker_.joinable())
+            worker_.join();
+    }
+
+private:
+    Model_writer(){}
+
+    void run(){
+        while(true){
+            std::pair<std::string, std::vector<char> > job;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cv_.wait(lock, [this]{ return stop_ || !queue_.empty(); });
+                if(queue_.empty())          // stop and nothing is left
+                    return;
+                job.first = queue_.front().first;
+                job.second.swap(queue_.front().second);
+                queue_.pop_front();
+            }
+            ModelBinary::save_buffer(job.first, job.second);
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                --pending_;
+                cv_.notify_all();
+            }
+        }
+    }
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::thread worker_;
+    std::deque<std::pair<std::string, std::vector<char> > > queue_;
+    int pending_ = 0;
+    bool stop_ = false;
+};
+
+
+/* ==========================================================================================
+ *                                        SAVE
+ * ==========================================================================================*/
+// append a section and return its offset, the sections start at 8 bytes boundaries
+static long append_section(std::vector<char>& v_buffer, const void * data, size_t num_bytes){
+    size_t offset = (v_buffer.size() + 7) & ~((size_t) 7);
+    v_buffer.resize(offset + num_bytes);
+    if(num_bytes > 0)
+        memcpy(&v_buffer[offset], data, num_bytes);
+    return (long) offset;
+}
+
+void ModelBinary::serialize(const svm_model * model, const std::vector<double>& v_center, std::vector<char>& v_buffer){
+    model_binary_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, model_binary_magic, sizeof(header.magic));
+    header.version      = model_binary_version;
+    header.node_size    = sizeof(svm_node);
+    header.svm_type     = model->param.svm_type;
+    header.kernel_type  = model->param.kernel_type;
+    header.degree       = model->param.degree;
+    header.gamma        = model->param.gamma;
+    header.coef0        = model->param.coef0;
+    header.nr_class     = model->nr_class;
+    header.l            = model->l;
+    header.center_dim   = v_center.size();
+
+    // - - - - - SVs as one block of nodes, their squared norms - - - -
+    std::vector<svm_node> v_nodes;
+    std::vector<long> v_sv_start(model->l);
+    std::vector<double> v_sv_norm(model->l);
+    for(int i=0; i < model->l; i++){
+        v_sv_start[i] = v_nodes.size();
+        double norm = 0;
+        const svm_node * p = model->SV[i];
+        while(p->index != -1){
+            v_nodes.push_back(*p);
+            norm += p->value * p->value;
+            ++p;
+        }
+        v_nodes.push_back(*p);          // terminator
+        v_sv_norm[i] = norm;
+    }
+    header.num_nodes = v_nodes.size();
+
+    int nr_class = model->nr_class;
+    int num_pairs = nr_class * (nr_class - 1) / 2;
+    v_buffer.clear();
+    v_buffer.resize(sizeof(header));        // the header is written at the end
+    header.off_nodes    = append_section(v_buffer, v_nodes.data(), v_nodes.size() * sizeof(svm_node));
+    header.off_sv_start = append_section(v_buffer, v_sv_start.data(), v_sv_start.size() * sizeof(long));
+    header.off_sv_coef  = (long) ((v_buffer.size() + 7) & ~((size_t) 7));
+    for(int k=0; k < nr_class - 1; k++)     // sv_coef[k] are stored back to back
+        append_section(v_buffer, model->sv_coef[k], model->l * sizeof(double));
+    header.off_rho      = append_section(v_buffer, model->rho, num_pairs * sizeof(double));
+    if(model->label)
+        header.off_label = append_section(v_buffer, model->label, nr_class * sizeof(int));
+    if(model->nSV)
+        header.off_nSV  = append_section(v_buffer, model->nSV, nr_class * sizeof(int));
+    if(model->probA)
+        header.off_probA = append_section(v_buffer, model->probA, num_pairs * sizeof(double));
+    if(model->probB)
+        header.off_probB = append_section(v_buffer, model->probB, num_pairs * sizeof(double));
+    if(model->sv_indices)
+        header.off_sv_indices = append_section(v_buffer, model->sv_indices, model->l * sizeof(int));
+    header.off_sv_norm  = append_section(v_buffer, v_sv_norm.data(), v_sv_norm.size() * sizeof(double));
+    if(!v_center.empty())
+        header.off_center = append_section(v_buffer, v_center.data(), v_center.size() * sizeof(double));
+    if(model->w){
+        header.w_dim    = model->w_dim;
+        header.off_w    = append_section(v_buffer, model->w, (model->w_dim + 1) * sizeof(double));
+    }
+    header.file_size = v_buffer.size();
+    memcpy(&v_buffer[0], &header, sizeof(header));
+}
+
+// write to a temporary file and rename it, a reader never sees a partial model
+bool ModelBinary::save_buffer(const std::string& fname, const std::vector<char>& v_buffer){
+    std::string tmp_fname = fname + ".tmp";
+    FILE * fp = fopen(tmp_fname.c_str(), "wb");
+    if(fp == NULL){
+        fprintf(stderr, "[MB][Save] can't open %s for writing\n", tmp_fname.c_str());
+        return false;
+    }
+    size_t num_written = fwrite(v_buffer.data(), 1, v_buffer.size(), fp);
+    if(fclose(fp) != 0 || num_written != v_buffer.size()){
+        fprintf(stderr, "[MB][Save] writing %s failed\n", tmp_fname.c_str());
+        remove(tmp_fname.c_str());
+        return false;
+    }
+    if(rename(tmp_fname.c_str(), fname.c_str()) != 0){
+        fprintf(stderr, "[MB][Save] renaming %s failed\n", tmp_fname.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ModelBinary::save(const std::string& fname, const svm_model * model, const std::vector<double>& v_center){
+    std::vector<char> v_buffer;
+    serialize(model, v_center, v_buffer);
+    return save_buffer(fname, v_buffer);
+}
+
+void ModelBinary::save_async(const std::string& fname, const svm_model * model, const std::vector<double>& v_center){
+    std::vector<char> v_buffer;
+    serialize(model, v_center, v_buffer);       // the copy makes the model free to be released
+    Model_writer::instance().push(fname, v_buffer);
+}
+
+void ModelBinary::wait_for_writer(){
+    Model_writer::instance().wait();
+}
+
+
+/* ==========================================================================================
+ *                                        LOAD
+ * ==========================================================================================*/
+// the section [offset, offset + num_elements * element_size) is inside the file and aligned (0 is a missing section)
+static bool section_in_file(long offset, long num_elements, size_t element_size, size_t file_size, bool required){
+    if(offset == 0)
+        return !required || num_elements == 0;
+    if(offset < (long) sizeof(model_binary_header) || offset % 8 != 0 || num_elements < 0 || (size_t) offset > file_size)
+        return false;
+    return (size_t) num_elements <= (file_size - offset) / element_size;
+}
+
+// the counts of the header are sane and all the sections (and the SVs in the nodes) are inside the file
+static bool sections_valid(const model_binary_header * header, size_t file_size){
+    if(header->nr_class < 2 || header->l < 0 || header->num_nodes < header->l || header->center_dim < 0 || header->w_dim < 0)
+        return false;
+    long num_pairs = (long) header->nr_class * (header->nr_class - 1) / 2;
+    if(!section_in_file(header->off_nodes, header->num_nodes, sizeof(svm_node), file_size, true) ||
+            !section_in_file(header->off_sv_start, header->l, sizeof(long), file_size, true) ||
+            !section_in_file(header->off_sv_coef, (header->nr_class - 1) * header->l, sizeof(double), file_size, true) ||
+            !section_in_file(header->off_rho, num_pairs, sizeof(double), file_size, true) ||
+            !section_in_file(header->off_label, header->nr_class, sizeof(int), file_size, false) ||
+            !section_in_file(header->off_nSV, header->nr_class, sizeof(int), file_size, false) ||
+            !section_in_file(header->off_probA, num_pairs, sizeof(double), file_size, false) ||
+            !section_in_file(header->off_probB, num_pairs, sizeof(double), file_size, false) ||
+            !section_in_file(header->off_sv_indices, header->l, sizeof(int), file_size, false) ||
+            !section_in_file(header->off_sv_norm, header->l, sizeof(double), file_size, true) ||
+            !section_in_file(header->off_center, header->center_dim, sizeof(double), file_size, header->center_dim > 0) ||
+            !section_in_file(header->off_w, header->w_dim + 1, sizeof(double), file_size, header->w_dim > 0))
+        return false;
+    // each SV starts inside the nodes and the last node is a terminator, hence no SV is read past the nodes
+    const char * base = (const char *) header;
+    const svm_node * nodes = (const svm_node *) (base + header->off_nodes);
+    const long * sv_start = (const long *) (base + header->off_sv_start);
+    if(header->num_nodes > 0 && nodes[header->num_nodes - 1].index != -1)
+        return false;
+    for(long i=0; i < header->l; i++)
+        if(sv_start[i] < 0 || sv_start[i] >= header->num_nodes)
+            return false;
+    return true;
+}
+
+bool ModelBinary::load(const std::string& fname){
+    unload();
+    int fd = open(fname.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(model_binary_header)){
+        close(fd);
+        return false;
+    }
+    // private writable mapping (copy on write), the model arrays are not const in svm_model
+    void * map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);                  // the mapping keeps the file
+    if(map == MAP_FAILED)
+        return false;
+    map_ = map;
+    map_size_ = st.st_size;
+
+    const char * base = (const char *) map_;
+    const model_binary_header * header = (const model_binary_header *) base;
+    if(memcmp(header->magic, model_binary_magic, sizeof(header->magic)) != 0 ||
+            header->version != model_binary_version || header->node_size != (int) sizeof(svm_node) ||
+            header->file_size != (long) map_size_){
+        fprintf(stderr, "[MB][Load] %s is not a valid binary model (version %d)\n", fname.c_str(), model_binary_version);
+        unload();
+        return false;
+    }
+
+    if(!sections_valid(header, map_size_)){
+        fprintf(stderr, "[MB][Load] %s is truncated or corrupted (a section is out of the file)\n", fname.c_str());
+        unload();
+        return false;
+    }
+
+    // - - - - - only the arrays of pointers are built, the data stays in the mapped file - - - -
+    svm_node * nodes = (svm_node *) (base + header->off_nodes);
+    const long * sv_start = (const long *) (base + header->off_sv_start);
+    v_SV_.resize(header->l);
+    for(long i=0; i < header->l; i++)
+        v_SV_[i] = nodes + sv_start[i];
+    v_sv_coef_.resize(header->nr_class - 1);
+    for(int k=0; k < header->nr_class - 1; k++)
+        v_sv_coef_[k] = (double *) (base + header->off_sv_coef) + k * header->l;
+
+    memset(&model_, 0, sizeof(model_));
+    model_.param.svm_type    = header->svm_type;
+    model_.param.kernel_type = header->kernel_type;
+    model_.param.degree      = header->degree;
+    model_.param.gamma       = header->gamma;
+    model_.param.coef0       = header->coef0;
+    model_.nr_class     = header->nr_class;
+    model_.l            = header->l;
+    model_.SV           = v_SV_.data();
+    model_.sv_coef      = v_sv_coef_.data();
+    model_.rho          = (double *) (base + header->off_rho);
+    model_.label        = header->off_label      ? (int *) (base + header->off_label) : NULL;
+    model_.nSV          = header->off_nSV        ? (int *) (base + header->off_nSV) : NULL;
+    model_.probA        = header->off_probA      ? (double *) (base + header->off_probA) : NULL;
+    model_.probB        = header->off_probB      ? (double *) (base + header->off_probB) : NULL;
+    model_.sv_indices   = header->off_sv_indices ? (int *) (base + header->off_sv_indices) : NULL;
+    model_.free_sv      = 0;
+    model_.w            = header->off_w          ? (double *) (base + header->off_w) : NULL;
+    model_.w_dim        = header->w_dim;
+    sv_norm_    = (const double *) (base + header->off_sv_norm);
+    center_dim_ = header->center_dim;
+    center_     = header->off_center ? (const double *) (base + header->off_center) : NULL;
+    return true;
+}
+
+void ModelBinary::unload(){
+    free(model_.ee_order);      // built after the load (svm_build_early_exit), the rest is in the mapped file
+    free(model_.ee_tail);
+    model_.ee_order = NULL;
+    model_.ee_tail = NULL;
+    if(map_ != NULL)
+        munmap(map_, map_size_);
+    map_ = NULL;
+    map_size_ = 0;
+    v_SV_.clear();
+    v_sv_coef_.clear();
+    sv_norm_ = NULL;
+    center_ = NULL;
+    center_dim_ = 0;
+}
+
+ModelBinary::~ModelBinary(){
+    unload();
+}
@@ -0,0 +1,92 @@
+#ifndef MODEL_BINARY_H
+#define MODEL_BINARY_H
+
+#include "solver.h"
+#include <string>
+#include <vector>
+
+/*
+ * Binary container for the trained svm models (*.svmbin)
+ * The file is used directly from memory (mmap), no parsing is needed and only the arrays of pointers are allocated
+ * layout, all the sections are 8 bytes aligned and the offsets are from the beginning of the file:
+ *  header | SV nodes (svm_node, each SV ends with index -1) | start of each SV in the nodes (int64) |
+ *  sv_coef | rho | label | nSV | probA | probB | sv_indices | squared norm of SVs | partition center (dense) |
+ *  linear weights (dense, w[0] is unused)
+ * the format is native endian, the header checks the size of svm_node and the version
+ */
+struct model_binary_header{
+    char    magic[8];               // "MLSVMBIN"
+    int     version;
+    int     node_size;              // sizeof(svm_node)
+    int     svm_type;
+    int     kernel_type;
+    int     degree;
+    int     nr_class;
+    double  gamma;
+    double  coef0;
+    long    l;                      // number of SVs
+    long    num_nodes;              // all the nodes including the terminators
+    long    center_dim;             // 0 if there is no center
+    long    file_size;
+    // offsets of the sections, 0 means the section doesn't exist
+    long    off_nodes;
+    long    off_sv_start;
+    long    off_sv_coef;
+    long    off_rho;
+    long    off_label;
+    long    off_nSV;
+    long    off_probA;
+    long    off_probB;
+    long    off_sv_indices;
+    long    off_sv_norm;
+    long    off_center;
+    long    w_dim;                  // 0 if the linear weights are not stored
+    long    off_w;
+};
+
+
+class ModelBinary{
+public:
+    ModelBinary() : model_() {}
+    ~ModelBinary();
+    ModelBinary(const ModelBinary&) = delete;
+    ModelBinary& operator=(const ModelBinary&) = delete;
+
+    /*
+     * serialize the model (and the center of its partition group if there is any) and write it to fname
+     * in the background writer thread, the model can be freed as soon as this returns
+     */
+    static void save_async(const std::string& fname, const svm_model * model,
+                           const std::vector<double>& v_center = std::vector<double>());
+    static bool save(const std::string& fname, const svm_model * model,
+                     const std::vector<double>& v_center = std::vector<double>());
+    // block until all the queued models are written
+    static void wait_for_writer();
+    // write a serialized model (used by the writer thread)
+    static bool save_buffer(const std::string& fname, const std::vector<char>& v_buffer);
+
+    /*
+     * map the file and prepare the model, returns false if the file doesn't exist or is not valid
+     * the model is valid as long as this object is alive (don't free it with svm_free_and_destroy_model)
+     */
+    bool load(const std::string& fname);
+    svm_model * get_model() { return &model_; }
+    const double * get_sv_norms() const { return sv_norm_; }
+    const double * get_center() const { return center_; }
+    long get_center_dim() const { return center_dim_; }
+
+private:
+    void * map_ = NULL;
+    size_t map_size_ = 0;
+    svm_model model_;
+    std::vector<svm_node *> v_SV_;
+    std::vector<double *> v_sv_coef_;
+    const double * sv_norm_ = NULL;
+    const double * center_ = NULL;
+    long center_dim_ = 0;
+
+    static void serialize(const svm_model * model, const std::vector<double>& v_center, std::vector<char>& v_buffer);
+    void unload();
+};
+
+#endif // MODEL_BINARY_H
@@ -1,12 +1,24 @@
 #include "model_selection.h"
+#include "model_binary.h"
+#include "rff_approx.h"
+#include "training_problem.h"
+#include "telemetry_log.h"
+#include "task_pool.h"
+#include "bayes_opt.h"
+#include "result_cache.h"
+#include "dist_tasks.h"
+#include "prediction_set.h"
 #include "algorithm"
 #include "k_fold.h"
 #include "config_logs.h"
 #include <cmath>
+#include <random>
 #include "etimer.h"
 #include "common_funcs.h"
 #include "loader.h"     //only for testing the SNGM experiment Sep 21, 2016
 
+static std::mutex rand_mutex;       // srand/rand are global, the folds and the partition groups run at the same time
+
 struct BetterGmean
 {
     bool operator () (const summary& a, const summary& b) const
@@ -210,7 +222,7 @@ void ModelSelection::set_range(){
  * @Outputs :
  * Vector of ud_point  : the UD sampling points for current stage
  */
-std::vector<ud_point> ModelSelection::ud_param_generator(int stage, bool inh_param, double param_C, double param_G){
+std::vector<ud_point> ModelSelection::ud_param_generator(int stage, bool inh_param, double param_C, double param_G, int num_points){
 
     int UDTable[31][30][2] = {
         {},
@@ -248,7 +260,9 @@ std::vector<ud_point> ModelSelection::ud_param_generator(int stage, bool inh_par
 
     float lg_base = 2;
     int pattern;
-    if(stage == 1){
+    if(num_points > 0){
+        pattern = num_points;
+    }else if(stage == 1){
         pattern = Config_params::getInstance()->get_ms_first_stage();
     }else{
         pattern = Config_params::getInstance()->get_ms_second_stage();
@@ -301,6 +315,7 @@ std::vector<ud_point> ModelSelection::ud_param_generator(int stage, bool inh_par
     float real_g_min = pow(lg_base, range_g.min );
     long long random_seed = std::stoll(Config_params::getInstance()->get_cpp_srand_seed());
 
+    std::lock_guard<std::mutex> rand_lock(rand_mutex);
     for(int i=0; i < pattern;i++){
         srand(random_seed + i);
         if (params[i].C > real_c_max ){           //keep it inside the scope (set the outside value to max on that side)
@@ -349,7 +364,8 @@ int ModelSelection::select_best_model(std::vector<summary> v_summary, int level,
 //    std::sort(v_summary.begin(),v_summary.end(),std::greater<summary>());
 //    std::sort(v_summary.begin(),v_summary.end(),BetterGmean());   // the main method for a year before Sep 21, 2016 - 09:00
 //    std::sort(v_summary.begin(),v_summary.end(),BetterSN_Gmean());  // experiment 092116_0940
-    std::sort(v_summary.begin(),v_summary.end(),Better_Gmean_SN());  // experiment 092816_1600
+    // the candidates are in the order of their ids (not the order they finish), the similar ones keep this order
+    std::stable_sort(v_summary.begin(),v_summary.end(),Better_Gmean_SN());  // experiment 092816_1600
 
 //    std::sort(v_summary.begin(),v_summary.end(),sortByGmean);
 //    std::sort(v_summary.begin(),v_summary.end(),BetterAcc());
@@ -374,24 +390,79 @@ int ModelSelection::select_best_model(std::vector<summary> v_summary, int level,
 
 
 
+/*
+ * kernel cache for the candidates of the model selection over num_points ids
+ * returns NULL if the shared cache is disabled (ms_shared_cache_size = 0)
+ * the candidates which run at the same time (ms_threads > 1) share it, see svm_kernel_cache
+ */
+svm_kernel_cache * ModelSelection::create_kernel_cache(PetscInt num_points){
+    double cache_size = Config_params::getInstance()->get_ms_shared_cache_size();
+    if(cache_size <= 0)
+        return NULL;
+#if dbl_MS_UD >= 1
+    std::cout << "[MS][KC] shared kernel cache for " << num_points << " points, size:" << cache_size << " MB" << std::endl;
+#endif
+    return svm_kernel_cache_create(num_points, cache_size);
+}
+
+
+/*
+ * candidates of the 2nd stage which are trained, the one at the center is the best of the 1st stage (skipped)
+ * the returned ids are in the order of ud_params_st_2
+ */
+static std::vector<unsigned int> second_stage_ids(const std::vector<ud_point>& ud_params_st_2, unsigned int num_iter_st2,
+                                                  const ud_point& best_st1){
+    std::vector<unsigned int> v_ids;
+    for(unsigned int i = 0; i < num_iter_st2 ;i++){
+        if(ud_params_st_2[i].C == best_st1.C && ud_params_st_2[i].G == best_st1.G)
+            continue;
+        v_ids.push_back(i);
+    }
+    return v_ids;
+}
+
+
+void ModelSelection::report_rff_agreement(const svm_model * model, const PredictionSet& vd_set, const char * tag){
+    int rff_dim = Config_params::getInstance()->get_svm_rff_dim();
+    int rff_check = Config_params::getInstance()->get_svm_rff_check();
+    if(rff_dim < 1 || rff_check < 1 || model->param.kernel_type != RBF || model->nr_class != 2)
+        return;
+    // the directions of the common features don't depend on the number of features, the same as the prediction tool
+    RffApproximation rff_approx(rff_dim, RffApproximation::num_features(model, vd_set));
+    int approx_id = rff_approx.add_model(model);
+    printf("%s %d random features, agreement with the exact model on %d validation points:%g\n", tag, rff_dim,
+           std::min(rff_check, vd_set.size()), rff_approx.agreement(model, approx_id, vd_set, rff_check));
+}
+
+
 void ModelSelection::uniform_design(Mat& m_data_p, Vec& v_vol_p, Mat& m_data_n, Vec& v_vol_n, bool inh_params,
                                     double param_C, double param_G, int level, solution & udc_sol){
     ETimer t_whole_UD;
-    // - - - - - k-cross-fold data - - - - -
-    k_fold kf;
-    Mat m_train_data_p, m_train_data_n, m_test_data;
-    Vec v_train_vol_p, v_train_vol_n;
     //0,5 means the first fold out of 5 fold is test and the rest are training
     int total_num_fold = Config_params::getInstance()->getInstance()->get_main_num_kf_iter();
     unsigned int num_iter_st1 = Config_params::getInstance()->get_ms_first_stage();
     unsigned int num_iter_st2 = Config_params::getInstance()->get_ms_second_stage();
-    std::vector<summary> v_summary_folds;
-    v_summary_folds.reserve(total_num_fold);
-
-    for(int fold_id=0; fold_id < total_num_fold; ++fold_id){    // run the 2 stages on all k fold
-        // cross fold the data and volumes for the fold_id
-        kf.cross_validation_simple(m_data_p, m_data_n, v_vol_p, v_vol_n, fold_id, total_num_fold,
-                                   m_train_data_p, m_train_data_n, m_test_data, v_train_vol_p, v_train_vol_n);
+    std::vector<summary> v_summary_folds(total_num_fold);
+    // the training parts of the folds overlap, the kernel rows are shared between folds using the ids of the whole data
+    PetscInt num_point_p, num_point_n;
+    MatGetSize(m_data_p, &num_point_p, NULL);
+    MatGetSize(m_data_n, &num_point_n, NULL);
+    svm_kernel_cache * kernel_cache = create_kernel_cache(num_point_p + num_point_n);
+
+    // the folds are independent until the best of all folds is selected, they run on the same pool as their candidates
+    TaskPool::getInstance()->run(total_num_fold, [&](int fold_id){    // run the 2 stages on all k fold
+        // - - - - - k-cross-fold data - - - - -
+        k_fold kf;
+        Mat m_train_data_p, m_train_data_n, m_test_data;
+        Vec v_train_vol_p, v_train_vol_n;
+        std::vector<int> v_train_ids;
+        // cross fold the data and volumes for the fold_id (PETSc, the other folds keep training meanwhile)
+        {
+            std::lock_guard<std::mutex> petsc_lock(TaskPool::petsc_mutex());
+            kf.cross_validation_simple(m_data_p, m_data_n, v_vol_p, v_vol_n, fold_id, total_num_fold,
+                                       m_train_data_p, m_train_data_n, m_test_data, v_train_vol_p, v_train_vol_n,
+                                       &v_train_ids);
+        }
 
         /* DEBUG: export the matrices for further test and comparison
         CommonFuncs cf;
@@ -407,23 +478,24 @@ void ModelSelection::uniform_design(Mat& m_data_p, Vec& v_vol_p, Mat& m_data_n,
         unsigned int solver_id=0;
         std::vector<summary> v_summary;
 
-        summary current_summary;     //map that contains all the measures
         int stage = 1;
         printf("[MS][UD] ------ stage:%d, level:%d, fold:%d ------ \n", stage, level, fold_id);
 
         std::vector<ud_point> ud_params_st_1;
         ud_params_st_1 = ud_param_generator(stage, inh_params, param_C, param_G);
-        for(unsigned int i =0; i < num_iter_st1;++i){
+        v_summary.resize(num_iter_st1);
+        TaskPool::getInstance()->run(num_iter_st1, [&](int i){
             Solver sv;
-            svm_model * curr_svm_model;
-            curr_svm_model = sv.train_model(m_train_data_p, v_train_vol_p, m_train_data_n, v_train_vol_n, 1,
-                                        ud_params_st_1[i].C, ud_params_st_1[i].G);
-//            v_solver.push_back(sv);
-            sv.test_predict(m_test_data, current_summary, solver_id);   //predict the validation data not the test data
+            sv.set_buffer_pool(buffer_pool_);
+            sv.set_kernel_cache(kernel_cache, v_train_ids);
+            sv.train_model(m_train_data_p, v_train_vol_p, m_train_data_n, v_train_vol_n, 1,
+                           ud_params_st_1[i].C, ud_params_st_1[i].G);
+            sv.test_predict(m_test_data, v_summary[i], solver_id + i);   //predict the validation data not the test data
             sv.free_solver("[MS][UD] ");   //free the solver
-            v_summary.push_back(current_summary);
+        });
+        for(unsigned int i =0; i < num_iter_st1;++i){
     #if dbl_MS_UD >= 1
-            Config_params::getInstance()->print_summary(current_summary,"[MS][UD]", level, i, stage,fold_id);
+            Config_params::getInstance()->print_summary(v_summary[i],"[MS][UD]", level, i, stage,fold_id);
     #endif
             ++solver_id;
         }
@@ -437,31 +509,38 @@ void ModelSelection::uniform_design(Mat& m_data_p, Vec& v_vol_p, Mat& m_data_n,
         std::vector<ud_point> ud_params_st_2;
         printf("[MS][UD] 2nd stage model selection center C:%g, G:%g\n",ud_params_st_1[best_1st_stage].C , ud_params_st_1[best_1st_stage].G);
         ud_params_st_2 = ud_param_generator(stage,true, ud_params_st_1[best_1st_stage].C , ud_params_st_1[best_1st_stage].G);
-        for(unsigned int i = 0; i < num_iter_st2 ;i++){
-            //skip the center of second stage(duplicate)
-            if(ud_params_st_2[i].C == ud_params_st_1[best_1st_stage].C && ud_params_st_2[i].G == ud_params_st_1[best_1st_stage].G)
-                continue;
+        std::vector<unsigned int> v_st2_ids = second_stage_ids(ud_params_st_2, num_iter_st2, ud_params_st_1[best_1st_stage]);
+        v_summary.resize(solver_id + v_st2_ids.size());
+        TaskPool::getInstance()->run(v_st2_ids.size(), [&](int j){
+            unsigned int i = v_st2_ids[j];
             Solver sv;
-            svm_model * curr_svm_model;
-            curr_svm_model = sv.train_model(m_train_data_p, v_train_vol_p, m_train_data_n, v_train_vol_n, 1,
-                                        ud_params_st_2[i].C, ud_params_st_2[i].G);
-            sv.test_predict(m_test_data, current_summary, solver_id);
-//            v_solver.push_back(sv);
+            sv.set_buffer_pool(buffer_pool_);
+            sv.set_kernel_cache(kernel_cache, v_train_ids);
+            sv.train_model(m_train_data_p, v_train_vol_p, m_train_data_n, v_train_vol_n, 1,
+                           ud_params_st_2[i].C, ud_params_st_2[i].G);
+            sv.test_predict(m_test_data, v_summary[solver_id + j], solver_id + j);
             sv.free_solver("[MS][UD] ");   //free the solver
-            v_summary.push_back(current_summary);
+        });
+        for(unsigned int j = 0; j < v_st2_ids.size(); j++){
     #if dbl_MS_UD >= 1
-            Config_params::getInstance()->print_summary(current_summary,"[MS][UD]", level, i, stage,fold_id);
+            Config_params::getInstance()->print_summary(v_summary[solver_id],"[MS][UD]", level, v_st2_ids[j], stage,fold_id);
     #endif
             ++solver_id;
         }
         int best_of_all =  select_best_model(v_summary,level,2);
     //    printf("[MS][UD] best of all iter :%d\n", best_of_all);
-        v_summary_folds.push_back( summary_factory_update_iter(v_summary[best_of_all], fold_id)  );
+        v_summary_folds[fold_id] = summary_factory_update_iter(v_summary[best_of_all], fold_id);
     #if dbl_MS_UD >= 1
         Config_params::getInstance()->print_summary(v_summary[best_of_all],"[MS][UD] Validation Data", level, -1, stage,fold_id);
     #endif
-
-    } // end of for loop for fold_id
+        {
+            std::lock_guard<std::mutex> petsc_lock(TaskPool::petsc_mutex());
+            MatDestroy(&m_train_data_p);
+            MatDestroy(&m_train_data_n);
+            MatDestroy(&m_test_data);
+        }
+    }); // end of the folds
+    svm_kernel_cache_destroy(&kernel_cache);
 
 
     /* - - - - - start experiment all the best values to find a better selection technique - - - - - */
@@ -493,8 +572,6 @@ void ModelSelection::uniform_design(Mat& m_data_p, Vec& v_vol_p, Mat& m_data_n,
     svm_model * whole_training_data_model;
     whole_training_data_model = sv_whole_training_data.train_model(m_data_p, v_vol_p, m_data_n, v_vol_n, 1,
                                         v_summary_folds[best_of_all_kfold].C,v_summary_folds[best_of_all_kfold].gamma);
-    PetscInt num_point_p;
-    MatGetSize(m_data_p, &num_point_p, NULL);
     sv_whole_training_data.prepare_solution_single_model(whole_training_data_model, num_point_p, udc_sol);
 
     summary final_summary;
@@ -510,6 +587,144 @@ void ModelSelection::uniform_design(Mat& m_data_p, Vec& v_vol_p, Mat& m_data_n,
 
 
 
+std::vector<sh_rung> ModelSelection::sh_schedule(int num_candidates, int eta){
+    std::vector<sh_rung> v_rungs;
+    for(int n = num_candidates; n > eta; n = (n + eta - 1) / eta)
+        v_rungs.push_back({n, (n + eta - 1) / eta, 0});
+    double fraction = 1;
+    for(auto it = v_rungs.rbegin(); it != v_rungs.rend(); ++it){       // the last rung is on 1/eta of the points
+        fraction /= eta;
+        it->fraction = fraction;
+    }
+    return v_rungs;
+}
+
+
+int ModelSelection::sh_subsample_size(int num_points, double fraction){
+    const int min_class_size = 20;          // smaller subsamples of a class don't rank the candidates
+    return std::min(num_points, std::max(min_class_size, (int) ceil(fraction * num_points)));
+}
+
+
+std::vector<ud_point> ModelSelection::successive_halving(const std::shared_ptr<const TrainingProblem>& full_problem, bool inh_params,
+                                                         double param_C, double param_G, const PredictionSet& vd_set,
+                                                         int level, int group_id, train_telemetry& group_telemetry){
+    int eta = std::max(2, Config_params::getInstance()->get_ms_sh_eta());
+    int num_candidates = std::min(30, std::max(3, Config_params::getInstance()->get_ms_sh_candidates()));
+    double sh_eps = Config_params::getInstance()->get_ms_sh_eps();
+    std::vector<ud_point> v_candidates = ud_param_generator(1, inh_params, param_C, param_G, num_candidates);
+
+    std::vector<sh_rung> v_rungs = sh_schedule(num_candidates, eta);
+
+    // - - - - the subsamples are nested, a rung takes the first points of the same permutation of each class - - - -
+    PetscInt num_p = full_problem->get_num_p();
+    PetscInt num_n = full_problem->get_num_n();
+    std::vector<int> v_perm_p(num_p), v_perm_n(num_n);
+    for(PetscInt i=0; i < num_p; i++) v_perm_p[i] = i;
+    for(PetscInt i=0; i < num_n; i++) v_perm_n[i] = i;
+    std::mt19937 gen(std::stoll(Config_params::getInstance()->get_cpp_srand_seed()));
+    std::shuffle(v_perm_p.begin(), v_perm_p.end(), gen);
+    std::shuffle(v_perm_n.begin(), v_perm_n.end(), gen);
+
+    std::vector<int> v_alive(num_candidates);
+    for(int i=0; i < num_candidates; i++) v_alive[i] = i;
+    for(unsigned int rung=0; rung < v_rungs.size(); ++rung){
+        int sub_p = sh_subsample_size(num_p, v_rungs[rung].fraction);
+        int sub_n = sh_subsample_size(num_n, v_rungs[rung].fraction);
+        std::vector<int> v_rows_p(v_perm_p.begin(), v_perm_p.begin() + sub_p);
+        std::vector<int> v_rows_n(v_perm_n.begin(), v_perm_n.begin() + sub_n);
+        std::sort(v_rows_p.begin(), v_rows_p.end());        // the rows stay in the order of the full problem
+        std::sort(v_rows_n.begin(), v_rows_n.end());
+        std::shared_ptr<const TrainingProblem> sub_problem = std::make_shared<const TrainingProblem>(*full_problem, v_rows_p, v_rows_n);
+
+        std::vector<summary> v_rung_summary(v_alive.size());
+        TaskPool::getInstance()->run(v_alive.size(), [&](int j){
+            if(!DistTasks::owns(j))
+                return;
+            Solver sv;
+            sv.set_training_problem(sub_problem);
+            sv.set_eps(sh_eps);
+            sv.train_model_shared_problem(v_candidates[v_alive[j]].C, v_candidates[v_alive[j]].G);
+            sv.predict_validation_data(vd_set, v_rung_summary[j], v_alive[j]);
+            sv.free_solver("[MS][SH] ");
+        });
+        DistTasks::gather(v_rung_summary, 0, v_rung_summary.size());
+        for(unsigned int j=0; j < v_rung_summary.size(); j++){
+            group_telemetry.add(v_rung_summary[j].telemetry);
+            TelemetryLog::getInstance()->write_candidate(level, group_id, v_rung_summary[j]);
+#if dbl_MS_UDSepVal >= 1
+            Config_params::getInstance()->print_summary(v_rung_summary[j],"[MS][SH]", level, v_alive[j], rung);
+#endif
+        }
+
+        // - - - - promote the best 1/eta with the same rule as the final selection - - - -
+        std::stable_sort(v_rung_summary.begin(), v_rung_summary.end(), Better_Gmean_SN());
+        unsigned int num_promoted = v_rungs[rung].num_promoted;
+        v_alive.clear();
+        for(unsigned int j=0; j < num_promoted; j++)
+            v_alive.push_back(v_rung_summary[j].iter);
+        std::sort(v_alive.begin(), v_alive.end());          // keep the order of the candidates
+        printf("[MS][SH] level:%d, rung:%d, %lu candidates on P:%d, N:%d points, %u promoted\n",
+               level, rung, v_rung_summary.size(), sub_p, sub_n, num_promoted);
+    }
+
+    std::vector<ud_point> v_survivors;
+    for(int id : v_alive)
+        v_survivors.push_back(v_candidates[id]);
+    return v_survivors;
+}
+
+
+
+
+int ModelSelection::bo_init_points(){
+    return std::min(30, std::max(3, Config_params::getInstance()->get_ms_bo_init()));
+}
+
+
+void ModelSelection::bayes_opt_stage(std::vector<summary>& v_summary, const std::function<void(const ud_point&)>& train_candidate,
+                                     int level, int group_id, train_telemetry& group_telemetry){
+    BayesOpt bo(range_c.min, range_c.max, range_g.min, range_g.max);
+    // the priors are read before the candidates of this group are added to the history,
+    // the groups of a level read the same history (see BayesOpt::begin_batch)
+    std::vector<bo_observation> v_priors = BayesOpt::history(std::max(0, Config_params::getInstance()->get_ms_bo_priors()));
+    for(const bo_observation& obs : v_priors)
+        bo.add_prior(obs);
+    for(const summary& cand_summary : v_summary){
+        bo_observation obs = {log2(cand_summary.C), log2(cand_summary.gamma), cand_summary.perf.at(Gmean)};
+        bo.add(obs);
+        BayesOpt::record(obs, group_id);
+    }
+
+    int max_evals = Config_params::getInstance()->get_ms_bo_max_evals();
+    double ei_tol = Config_params::getInstance()->get_ms_bo_ei_tol();
+    int num_evals = 0;
+    double ei = 0;
+    for(; num_evals < max_evals; ++num_evals){
+        ud_point point;
+        ei = bo.next(point.C, point.G);
+        if(ei < ei_tol)
+            break;
+        point.C = pow(2, point.C);
+        point.G = pow(2, point.G);
+        train_candidate(point);         // appends the candidate to v_summary
+        const summary& cand_summary = v_summary.back();
+        group_telemetry.add(cand_summary.telemetry);
+        TelemetryLog::getInstance()->write_candidate(level, group_id, cand_summary);
+#if dbl_MS_UDSepVal >= 1
+        Config_params::getInstance()->print_summary(cand_summary,"[MS][BO]", level, v_summary.size() - 1, 2);
+#endif
+        bo_observation obs = {log2(cand_summary.C), log2(cand_summary.gamma), cand_summary.perf.at(Gmean)};
+        bo.add(obs);
+        BayesOpt::record(obs, group_id);
+    }
+    printf("[MS][BO] level:%d, group:%d, %lu priors, %d trainings after the UD points, last expected improvement:%g\n",
+           level, group_id, v_priors.size(), num_evals, ei);
+}
+
+
+
+
 void ModelSelection::add_debug_parameters(std::vector<ud_point>& v_initialized_params){
     ud_point extra_parameters;
     extra_parameters.C= Config_params::getInstance()->get_svm_C();
@@ -521,7 +736,8 @@ void ModelSelection::add_debug_parameters(std::vector<ud_point>& v_initialized_p
 
 void ModelSelection::uniform_design_separate_validation(Mat& m_train_data_p, Vec& v_train_vol_p, Mat& m_train_data_n, Vec& v_train_vol_n,
                                                         bool inh_params, double param_C, double param_G, Mat& m_VD_p, Mat& m_VD_n, int level,
-                                                        solution & udc_sol, std::vector<ref_results>& v_ref_results){
+                                                        solution & udc_sol, std::vector<ref_results>& v_ref_results,
+                                                        const std::vector<double>& v_init_alpha){
     // - - - -  Load validation data which is the training part of whole data in the beginning of the coarsening - - - -
     ETimer t_whole_UD;
     Loader ld;
@@ -534,7 +750,27 @@ void ModelSelection::uniform_design_separate_validation(Mat& m_train_data_p, Vec
     v_solver.reserve(num_iter_st1 + num_iter_st2);
     unsigned int solver_id=0;
     std::vector<summary> v_summary;
-    summary current_summary;     //map that contains all the measures
+    // all the candidates train on the same points, the ids are the rows of the training problem
+    PetscInt num_row_p, num_row_n;
+    MatGetSize(m_train_data_p, &num_row_p, NULL);
+    MatGetSize(m_train_data_n, &num_row_n, NULL);
+    svm_kernel_cache * kernel_cache = create_kernel_cache(num_row_p + num_row_n);
+    train_telemetry group_telemetry;        // sum of all the candidates
+
+    // the validation data is converted once for all the candidates (see PredictionSet)
+    std::shared_ptr<const PredictionSet> vd_set = PredictionSet::validation(m_VD_p, m_VD_n);
+    // - - - - the results of the earlier runs on the same data (if the result cache is enabled) - - - -
+    uint64_t data_fp = 0;
+    if(ResultCache::getInstance()->enabled()){
+        std::lock_guard<std::mutex> lock(TaskPool::petsc_mutex());
+        data_fp = ResultCache::fingerprint(m_train_data_p, v_train_vol_p, m_train_data_n, v_train_vol_n, *vd_set);
+    }
+    auto find_cached = [&](const ud_point& point, unsigned int slot){
+        if(!ResultCache::getInstance()->find(data_fp, point.C, point.G, v_summary[slot]))
+            return false;
+        v_summary[slot].iter = slot;
+        return true;
+    };
 
     ETimer t_stage1;
     int stage = 1;
@@ -542,20 +778,48 @@ void ModelSelection::uniform_design_separate_validation(Mat& m_train_data_p, Vec
     printf("[MS][UDSepVal] ------ stage:%d, level:%d------ \n", stage, level);
 #endif
     std::vector<ud_point> ud_params_st_1;
-    ud_params_st_1 = ud_param_generator(stage, inh_params, param_C, param_G);
-    add_debug_parameters(ud_params_st_1);
-    for(unsigned int i =0; i < num_iter_st1;++i){
-        Solver sv;
-        svm_model * curr_svm_model;
-        curr_svm_model = sv.train_model(m_train_data_p, v_train_vol_p, m_train_data_n, v_train_vol_n, 1,
-                                    ud_params_st_1[i].C, ud_params_st_1[i].G);
-        v_solver.push_back(sv);
+    bool use_sh = Config_params::getInstance()->get_ms_method() == 1;
+    bool use_bo = Config_params::getInstance()->get_ms_method() == 2;
+    if(use_sh){     // the survivors of the successive halving replace the UD stages
+        std::vector<PetscInt> v_p_index(num_row_p), v_n_index(num_row_n);
+        for(PetscInt i=0; i < num_row_p; i++) v_p_index[i] = i;
+        for(PetscInt i=0; i < num_row_n; i++) v_n_index[i] = i;
+        std::shared_ptr<const TrainingProblem> full_problem = std::make_shared<const TrainingProblem>(
+                    m_train_data_p, v_train_vol_p, m_train_data_n, v_train_vol_n, v_p_index, v_n_index, num_row_p, num_row_n, buffer_pool_);
+        ud_params_st_1 = successive_halving(full_problem, inh_params, param_C, param_G, *vd_set,
+                                            level, -1, group_telemetry);
+        num_iter_st1 = ud_params_st_1.size();
+    }else if(use_bo){   // a few UD points, the Gaussian process picks the rest
+        ud_params_st_1 = ud_param_generator(stage, inh_params, param_C, param_G, bo_init_points());
+        add_debug_parameters(ud_params_st_1);
+        num_iter_st1 = ud_params_st_1.size();
+    }else{
+        ud_params_st_1 = ud_param_generator(stage, inh_params, param_C, param_G);
+        add_debug_parameters(ud_params_st_1);
+    }
+    v_solver.resize(num_iter_st1);
+    v_summary.resize(num_iter_st1);
+    auto train_st1 = [&](unsigned int i){
+        Solver& sv = v_solver[i];
+        sv.set_buffer_pool(buffer_pool_);
+        sv.set_warm_start(v_init_alpha);        // projected alphas from the coarser level (if there is any)
+        sv.set_kernel_cache(kernel_cache, std::vector<int>());
+        sv.train_model(m_train_data_p, v_train_vol_p, m_train_data_n, v_train_vol_n, 1,
+                       ud_params_st_1[i].C, ud_params_st_1[i].G);
         //predict the validation data not the test data
-        sv.predict_validation_data(m_VD_p, m_VD_n, current_summary, solver_id);
-//            sv.free_solver("[MS][UDSepVal] ");   //free the solver
-        v_summary.push_back(current_summary);
+        sv.predict_validation_data(*vd_set, v_summary[i], i);
+    };
+    TaskPool::getInstance()->run(num_iter_st1, [&](int i){
+        if(DistTasks::owns(i) && !find_cached(ud_params_st_1[i], i))
+            train_st1(i);
+    });
+    DistTasks::gather(v_summary, 0, num_iter_st1);
+    for(unsigned int i =0; i < num_iter_st1;++i){
+        group_telemetry.add(v_summary[i].telemetry);
+        TelemetryLog::getInstance()->write_candidate(level, -1, v_summary[i]);
+        ResultCache::getInstance()->add(data_fp, v_summary[i]);
 #if dbl_MS_UDSepVal >= 1
-        Config_params::getInstance()->print_summary(current_summary,"[MS][UDSepVal]", level, i, stage);
+        Config_params::getInstance()->print_summary(v_summary[i],"[MS][UDSepVal]", level, i, stage);
 #endif
         ++solver_id;
     }
@@ -573,32 +837,79 @@ void ModelSelection::uniform_design_separate_validation(Mat& m_train_data_p, Vec
     printf("[MS][UDSepVal] 2nd stage model selection center C:%g, G:%g\n",ud_params_st_1[best_1st_stage].C , ud_params_st_1[best_1st_stage].G);
 #endif
     std::vector<ud_point> ud_params_st_2;
-
-    ud_params_st_2 = ud_param_generator(stage,true, ud_params_st_1[best_1st_stage].C , ud_params_st_1[best_1st_stage].G);
-    for(unsigned int i = 0; i < num_iter_st2 ;i++){
-        //skip the center of second stage(duplicate)
-        if(ud_params_st_2[i].C == ud_params_st_1[best_1st_stage].C && ud_params_st_2[i].G == ud_params_st_1[best_1st_stage].G)
-            continue;
-        Solver sv;
-        svm_model * curr_svm_model;
-        curr_svm_model = sv.train_model(m_train_data_p, v_train_vol_p, m_train_data_n, v_train_vol_n, 1,
-                                    ud_params_st_2[i].C, ud_params_st_2[i].G);
-        sv.predict_validation_data(m_VD_p, m_VD_n, current_summary, solver_id);
-        v_solver.push_back(sv);
-//            sv.free_solver("[MS][UDSepVal] ");   //free the solver
-        v_summary.push_back(current_summary);
+    std::vector<double> v_best_st1_alpha;
+    std::vector<unsigned int> v_st2_ids;        // empty for the successive halving and the Bayesian optimization
+    if(!use_sh && v_solver[best_1st_stage].get_model() != NULL){     // no model if it came from the result cache
+        // the 2nd stage candidates are around the best of 1st stage, hence its alphas are a good starting point
+        v_solver[best_1st_stage].get_alphas(v_best_st1_alpha);
+    }
+    if(!use_sh)     // the rank which trained it sends its alphas, all the ranks need the same warm start
+        DistTasks::broadcast(v_best_st1_alpha, DistTasks::owner(best_1st_stage));
+    if(!use_sh && !use_bo){
+        ud_params_st_2 = ud_param_generator(stage,true, ud_params_st_1[best_1st_stage].C , ud_params_st_1[best_1st_stage].G);
+        v_st2_ids = second_stage_ids(ud_params_st_2, num_iter_st2, ud_params_st_1[best_1st_stage]);
+    }
+    auto train_st2 = [&](const ud_point& point, unsigned int slot){
+        Solver& sv = v_solver[slot];
+        sv.set_buffer_pool(buffer_pool_);
+        sv.set_warm_start(v_best_st1_alpha);
+        sv.set_kernel_cache(kernel_cache, std::vector<int>());
+        sv.train_model(m_train_data_p, v_train_vol_p, m_train_data_n, v_train_vol_n, 1, point.C, point.G);
+        sv.predict_validation_data(*vd_set, v_summary[slot], slot);
+    };
+    v_solver.resize(solver_id + v_st2_ids.size());
+    v_summary.resize(solver_id + v_st2_ids.size());
+    TaskPool::getInstance()->run(v_st2_ids.size(), [&](int j){
+        if(DistTasks::owns(solver_id + j) && !find_cached(ud_params_st_2[v_st2_ids[j]], solver_id + j))
+            train_st2(ud_params_st_2[v_st2_ids[j]], solver_id + j);
+    });
+    DistTasks::gather(v_summary, solver_id, v_st2_ids.size());
+    for(unsigned int j = 0; j < v_st2_ids.size(); j++){
+        group_telemetry.add(v_summary[solver_id].telemetry);
+        TelemetryLog::getInstance()->write_candidate(level, -1, v_summary[solver_id]);
+        ResultCache::getInstance()->add(data_fp, v_summary[solver_id]);
 #if dbl_MS_UDSepVal >= 1
-        Config_params::getInstance()->print_summary(current_summary,"[MS][UDSepVal]", level, i, stage);
+        Config_params::getInstance()->print_summary(v_summary[solver_id],"[MS][UDSepVal]", level, v_st2_ids[j], stage);
 #endif
         ++solver_id;
     }
+    if(use_bo){
+        bayes_opt_stage(v_summary, [&](const ud_point& point){
+            v_solver.resize(solver_id + 1);
+            v_summary.resize(solver_id + 1);
+            if(DistTasks::owns(solver_id) && !find_cached(point, solver_id))
+                train_st2(point, solver_id);
+            DistTasks::gather(v_summary, solver_id, 1);
+            ResultCache::getInstance()->add(data_fp, v_summary[solver_id]);
+            ++solver_id;
+        }, level, -1, group_telemetry);
+    }
     int best_of_all =  select_best_model(v_summary,level,2);
+    // the owner sends its model to the other ranks, it is empty if the result came from the result cache
+    std::vector<double> v_best_model;
+    if(DistTasks::distributed() && v_solver[best_of_all].get_model() != NULL)
+        v_solver[best_of_all].get_model_values(v_best_model);
+    DistTasks::broadcast(v_best_model, DistTasks::owner(best_of_all));
+    if(v_solver[best_of_all].get_model() == NULL){      // the solution needs its model, it is trained only if no rank has it
+        summary kept_summary = v_summary[best_of_all];
+        v_solver[best_of_all].set_model_values(v_best_model);
+        if((unsigned int) best_of_all < num_iter_st1){
+            train_st1(best_of_all);
+        }else{
+            ud_point best_point = {v_summary[best_of_all].C, v_summary[best_of_all].gamma};
+            train_st2(best_point, best_of_all);
+        }
+        group_telemetry.add(v_summary[best_of_all].telemetry);
+        v_summary[best_of_all] = kept_summary;
+    }
+    TelemetryLog::getInstance()->write_group(level, -1, v_summary[best_of_all], group_telemetry);
 
 #if dbl_MS_UDSepVal >= 1
     printf("[MS][UDSepVal] best of both stage of UD is: (iter :%d)\n", best_of_all);
     Config_params::getInstance()->print_summary(v_summary[best_of_all],"[MS][UDSepVal] Validation Data", level, -1, stage);
 #endif
     t_stage2.stop_timer("[MS][UDSepVal] stage 2 at level", std::to_string(level) );
+    svm_kernel_cache_destroy(&kernel_cache);        // no more training
 
     // - - - - load the test data from file - - - -
     Mat m_TD;
@@ -622,6 +933,7 @@ void ModelSelection::uniform_design_separate_validation(Mat& m_train_data_p, Vec
 
     svm_model * best_model = best_solver.get_model() ;
     best_solver.prepare_solution_single_model(best_model , num_point_p, udc_sol);
+    report_rff_agreement(best_model, *vd_set, "[MS][UDSepVal]");
     summary final_summary;
     best_solver.evaluate_testdata(level, final_summary);
     ref_results refinement_results ;
@@ -709,23 +1021,23 @@ void ModelSelection::uniform_design_index_base(Mat& p_data, Vec& v_vol_p, Mat& n
 
     int stage = 1;
     std::vector<ud_point> ud_params_st_1;
-    summary current_summary;
     std::vector<summary> v_summary;
     ud_params_st_1 = ud_param_generator(1, inh_params, last_c, last_gamma);
+    // - - - - the problem is the same for all the candidates, only C and gamma change - - - -
+    std::shared_ptr<const TrainingProblem> training_problem = std::make_shared<const TrainingProblem>(
+                p_data, v_vol_p, n_data, v_vol_n, v_p_index, v_n_index, iter_train_p_end, iter_train_n_end, buffer_pool_);
     // - - - - 1st stage - - - -
-    for(unsigned int i =0; i < num_iter_st1;i++){
-        Solver sv;
-        svm_model * curr_svm_model;
-        curr_svm_model = sv.train_model_index_base(p_data, v_vol_p, n_data, v_vol_n, v_p_index, v_n_index,
-                                        iter_train_p_end, iter_train_n_end,true, ud_params_st_1[i].C, ud_params_st_1[i].G);
-        v_solver.push_back(sv);
-//        sv.test_predict_index_base(p_data, n_data, v_p_index, v_n_index, iter_train_p_end, iter_train_n_end, current_summary,solver_id);
-
-        v_summary.push_back(current_summary);
-
-//        sv.free_solver("[MS][UDIB] stage 1");
-        ++solver_id;
-    }
+    v_solver.resize(num_iter_st1);
+    v_summary.resize(num_iter_st1);
+    TaskPool::getInstance()->run(num_iter_st1, [&](int i){
+        Solver& sv = v_solver[i];
+        sv.set_buffer_pool(buffer_pool_);
+        sv.set_training_problem(training_problem);
+        sv.train_model_index_base(p_data, v_vol_p, n_data, v_vol_n, v_p_index, v_n_index,
+                                  iter_train_p_end, iter_train_n_end,true, ud_params_st_1[i].C, ud_params_st_1[i].G);
+//        sv.test_predict_index_base(p_data, n_data, v_p_index, v_n_index, iter_train_p_end, iter_train_n_end, v_summary[i], i);
+    });
+    solver_id += num_iter_st1;
     int best_1st_stage = select_best_model(v_summary,level,1);
 
 
@@ -734,20 +1046,20 @@ void ModelSelection::uniform_design_index_base(Mat& p_data, Vec& v_vol_p, Mat& n
     std::vector<ud_point> ud_params_st_2;
     ud_params_st_2 = ud_param_generator(2,true, ud_params_st_1[best_1st_stage].C , ud_params_st_1[best_1st_stage].G);
 
-    for(unsigned int i =0; i < num_iter_st2; i++){
-        //skip the center of second stage(duplicate)
-        if(ud_params_st_2[i].C == ud_params_st_1[best_1st_stage].C && ud_params_st_2[i].G == ud_params_st_1[best_1st_stage].G)
-            continue;
-
-        Solver sv;
-        svm_model * curr_svm_model;
-        curr_svm_model = sv.train_model_index_base(p_data, v_vol_p, n_data, v_vol_n, v_p_index, v_n_index,
-                                        iter_train_p_end, iter_train_n_end,true, ud_params_st_2[i].C, ud_params_st_2[i].G);
-        sv.test_predict_index_base(p_data, n_data, v_p_index, v_n_index, iter_train_p_end, iter_train_n_end, current_summary,solver_id);
-        v_solver.push_back(sv);
-        v_summary.push_back(current_summary);
-        ++solver_id;
-    }
+    std::vector<unsigned int> v_st2_ids = second_stage_ids(ud_params_st_2, num_iter_st2, ud_params_st_1[best_1st_stage]);
+    v_solver.resize(solver_id + v_st2_ids.size());
+    v_summary.resize(solver_id + v_st2_ids.size());
+    TaskPool::getInstance()->run(v_st2_ids.size(), [&](int j){
+        unsigned int i = v_st2_ids[j];
+        Solver& sv = v_solver[solver_id + j];
+        sv.set_buffer_pool(buffer_pool_);
+        sv.set_training_problem(training_problem);
+        sv.train_model_index_base(p_data, v_vol_p, n_data, v_vol_n, v_p_index, v_n_index,
+                                  iter_train_p_end, iter_train_n_end,true, ud_params_st_2[i].C, ud_params_st_2[i].G);
+        sv.test_predict_index_base(p_data, n_data, v_p_index, v_n_index, iter_train_p_end, iter_train_n_end,
+                                   v_summary[solver_id + j], solver_id + j);
+    });
+    solver_id += v_st2_ids.size();
 
     int best_of_all =  select_best_model(v_summary,level,2);
     t_sv_ps.stop_timer("[MS][UDIB] model training");
@@ -791,15 +1103,19 @@ void ModelSelection::uniform_design_index_base(Mat& p_data, Vec& v_vol_p, Mat& n
 void ModelSelection::uniform_design_index_base_separate_validation(Mat& p_data, Vec& v_vol_p, Mat& n_data, Vec& v_vol_n,
                         bool inh_params, double last_c, double last_gamma,int level,
                         std::vector<PetscInt>& v_p_index, std::vector<PetscInt>& v_n_index,
-                        std::unordered_set<PetscInt>& uset_SV_index_p, std::unordered_set<PetscInt>& uset_SV_index_n,
+                        std::unordered_map<PetscInt,double>& umap_SV_alpha_p, std::unordered_map<PetscInt,double>& umap_SV_alpha_n,
                         Mat& m_VD_p, Mat& m_VD_n, Mat& m_VD_both, Mat& m_all_predict_VD, Mat& m_testdata,
-                        int classifier_id, Mat& m_all_predict_TD){
+                        int classifier_id, Mat& m_all_predict_TD,
+                        const std::vector<double>& v_init_alpha_p, const std::vector<double>& v_init_alpha_n){
 
     ETimer t_sv_ps;
-    srand(std::stoll(Config_params::getInstance()->get_cpp_srand_seed()));
-    std::random_shuffle( v_p_index.begin(), v_p_index.end() ); //shuffle all nodes
-    srand(std::stoll(Config_params::getInstance()->get_cpp_srand_seed()));
-    std::random_shuffle( v_n_index.begin(), v_n_index.end() ); //shuffle all nodes
+    {
+        std::lock_guard<std::mutex> rand_lock(rand_mutex);      // same shuffle as a serial run
+        srand(std::stoll(Config_params::getInstance()->get_cpp_srand_seed()));
+        std::random_shuffle( v_p_index.begin(), v_p_index.end() ); //shuffle all nodes
+        srand(std::stoll(Config_params::getInstance()->get_cpp_srand_seed()));
+        std::random_shuffle( v_n_index.begin(), v_n_index.end() ); //shuffle all nodes
+    }
 
 //    double train_fraction = 1 - (1 / Config_params::getInstance()->get_main_num_kf_iter());
 
@@ -818,23 +1134,92 @@ void ModelSelection::uniform_design_index_base_separate_validation(Mat& p_data,
 
     int stage = 1;
     std::vector<ud_point> ud_params_st_1;
-    summary current_summary;
     std::vector<summary> v_summary;
     ud_params_st_1 = ud_param_generator(1, inh_params, last_c, last_gamma);
+
+    // - - - - map the projected alphas to the order of the training problem (after shuffle) - - - -
+    std::vector<double> v_init_alpha;
+    if(!v_init_alpha_p.empty() && !v_init_alpha_n.empty()){
+        v_init_alpha.reserve(iter_train_p_end + iter_train_n_end);
+        for(PetscInt i=0; i < iter_train_p_end; i++)
+            v_init_alpha.push_back(v_init_alpha_p[v_p_index[i]]);
+        for(PetscInt i=0; i < iter_train_n_end; i++)
+            v_init_alpha.push_back(v_init_alpha_n[v_n_index[i]]);
+    }
+    // - - - - ids of the training points in the kernel cache (rows of p_data, then rows of n_data) - - - -
+    PetscInt num_row_p, num_row_n;
+    {
+        std::lock_guard<std::mutex> lock(TaskPool::petsc_mutex());     // the partition groups may run at the same time
+        MatGetSize(p_data, &num_row_p, NULL);
+        MatGetSize(n_data, &num_row_n, NULL);
+    }
+    svm_kernel_cache * kernel_cache = kernel_cache_;    // shared with the other groups if the caller set it
+    if(kernel_cache == NULL)
+        kernel_cache = create_kernel_cache(num_row_p + num_row_n);
+    std::vector<int> v_point_ids;
+    if(kernel_cache != NULL){
+        v_point_ids.reserve(iter_train_p_end + iter_train_n_end);
+        for(PetscInt i=0; i < iter_train_p_end; i++)
+            v_point_ids.push_back(v_p_index[i]);
+        for(PetscInt i=0; i < iter_train_n_end; i++)
+            v_point_ids.push_back(num_row_p + v_n_index[i]);
+    }
+    // - - - - the problem is the same for all the candidates, only C and gamma change - - - -
+    ETimer t_build_problem;
+    std::shared_ptr<const TrainingProblem> training_problem = std::make_shared<const TrainingProblem>(
+                p_data, v_vol_p, n_data, v_vol_n, v_p_index, v_n_index, iter_train_p_end, iter_train_n_end, buffer_pool_);
+    train_telemetry group_telemetry;        // sum of all the candidates and the shared problem
+    group_telemetry.build_time = t_build_problem.get_elapsed();
+    // the validation data is converted once for all the candidates (see PredictionSet)
+    std::shared_ptr<const PredictionSet> vd_set = PredictionSet::validation(m_VD_p, m_VD_n);
+    // - - - - the results of the earlier runs on the same data (if the result cache is enabled) - - - -
+    uint64_t data_fp = 0;
+    if(ResultCache::getInstance()->enabled()){     // only the rows of this group, the validation data is hashed once
+        std::lock_guard<std::mutex> lock(TaskPool::petsc_mutex());
+        data_fp = ResultCache::fingerprint(p_data, v_vol_p, v_p_index, iter_train_p_end,
+                                           n_data, v_vol_n, v_n_index, iter_train_n_end, *vd_set);
+    }
+    auto find_cached = [&](const ud_point& point, unsigned int slot){
+        if(!ResultCache::getInstance()->find(data_fp, point.C, point.G, v_summary[slot]))
+            return false;
+        v_summary[slot].iter = slot;
+        return true;
+    };
+    bool use_sh = Config_params::getInstance()->get_ms_method() == 1;
+    bool use_bo = Config_params::getInstance()->get_ms_method() == 2;
+    if(use_bo){     // a few UD points, the Gaussian process picks the rest
+        ud_params_st_1 = ud_param_generator(1, inh_params, last_c, last_gamma, bo_init_points());
+        num_iter_st1 = ud_params_st_1.size();
+    }
+    if(use_sh){     // the survivors of the successive halving replace the UD stages
+        ud_params_st_1 = successive_halving(training_problem, inh_params, last_c, last_gamma, *vd_set,
+                                            level, classifier_id, group_telemetry);
+        num_iter_st1 = ud_params_st_1.size();
+    }
     // - - - - 1st stage - - - -
+    v_solver.resize(num_iter_st1);
+    v_summary.resize(num_iter_st1);
+    auto train_st1 = [&](unsigned int i){
+        Solver& sv = v_solver[i];
+        sv.set_buffer_pool(buffer_pool_);
+        sv.set_training_problem(training_problem);
+        sv.set_warm_start(v_init_alpha);
+        sv.set_kernel_cache(kernel_cache, v_point_ids);
+        sv.train_model_index_base(p_data, v_vol_p, n_data, v_vol_n, v_p_index, v_n_index,
+                                  iter_train_p_end, iter_train_n_end,true, ud_params_st_1[i].C, ud_params_st_1[i].G);
+//        sv.test_predict_index_base(p_data, n_data, v_p_index, v_n_index, iter_train_p_end, iter_train_n_end, v_summary[i], i);
+        sv.predict_validation_data(*vd_set, v_summary[i], i);     // The normal predict method for full matrix is useful rather than index base methods
+    };
+    TaskPool::getInstance()->run(num_iter_st1, [&](int i){
+        if(DistTasks::owns(i) && !find_cached(ud_params_st_1[i], i))
+            train_st1(i);
+    });
+    DistTasks::gather(v_summary, 0, num_iter_st1);
     for(unsigned int i =0; i < num_iter_st1;i++){
-        Solver sv;
-        svm_model * curr_svm_model;
-        curr_svm_model = sv.train_model_index_base(p_data, v_vol_p, n_data, v_vol_n, v_p_index, v_n_index,
-                                        iter_train_p_end, iter_train_n_end,true, ud_params_st_1[i].C, ud_params_st_1[i].G);
-        v_solver.push_back(sv);
-//        sv.test_predict_index_base(p_data, n_data, v_p_index, v_n_index, iter_train_p_end, iter_train_n_end, current_summary,solver_id);
-//        std::cout << "[MS][UDIBSepVal] after push_back solver" << std::endl;
-        sv.predict_validation_data(m_VD_p, m_VD_n, current_summary, solver_id);     // The normal predict method for full matrix is useful rather than index base methods
-//        std::cout << "[MS][UDIBSepVal] after predicting the validation data" << std::endl;
-        v_summary.push_back(current_summary);
+        group_telemetry.add(v_summary[i].telemetry);
+        TelemetryLog::getInstance()->write_candidate(level, classifier_id, v_summary[i]);
+        ResultCache::getInstance()->add(data_fp, v_summary[i]);
         ++solver_id;
-//        exit(1);
     }
     int best_1st_stage = select_best_model(v_summary,level,1);
 
@@ -842,38 +1227,89 @@ void ModelSelection::uniform_design_index_base_separate_validation(Mat& p_data,
     // - - - - 2nd stage - - - -
     stage = 2 ;
     std::vector<ud_point> ud_params_st_2;
-    ud_params_st_2 = ud_param_generator(2,true, ud_params_st_1[best_1st_stage].C , ud_params_st_1[best_1st_stage].G);
-
-    for(unsigned int i =0; i < num_iter_st2; i++){
-        //skip the center of second stage(duplicate)
-        if(ud_params_st_2[i].C == ud_params_st_1[best_1st_stage].C && ud_params_st_2[i].G == ud_params_st_1[best_1st_stage].G)
-            continue;
-
-        Solver sv;
-        svm_model * curr_svm_model;
-        curr_svm_model = sv.train_model_index_base(p_data, v_vol_p, n_data, v_vol_n, v_p_index, v_n_index,
-                                        iter_train_p_end, iter_train_n_end,true, ud_params_st_2[i].C, ud_params_st_2[i].G);
-//        sv.test_predict_index_base(p_data, n_data, v_p_index, v_n_index, iter_train_p_end, iter_train_n_end, current_summary,solver_id);
-        sv.predict_validation_data(m_VD_p, m_VD_n, current_summary, solver_id);     // The normal predict method for full matrix is useful rather than index base methods
-        v_solver.push_back(sv);
-        v_summary.push_back(current_summary);
+    std::vector<double> v_best_st1_alpha;
+    std::vector<unsigned int> v_st2_ids;        // empty for the successive halving and the Bayesian optimization
+    if(!use_sh && v_solver[best_1st_stage].get_model() != NULL)      // no model if it came from the result cache
+        v_solver[best_1st_stage].get_alphas(v_best_st1_alpha);
+    if(!use_sh)     // the rank which trained it sends its alphas, all the ranks need the same warm start
+        DistTasks::broadcast(v_best_st1_alpha, DistTasks::owner(best_1st_stage));
+    if(!use_sh && !use_bo){
+        ud_params_st_2 = ud_param_generator(2,true, ud_params_st_1[best_1st_stage].C , ud_params_st_1[best_1st_stage].G);
+        v_st2_ids = second_stage_ids(ud_params_st_2, num_iter_st2, ud_params_st_1[best_1st_stage]);
+    }
+    auto train_st2 = [&](const ud_point& point, unsigned int slot){
+        Solver& sv = v_solver[slot];
+        sv.set_buffer_pool(buffer_pool_);
+        sv.set_training_problem(training_problem);
+        sv.set_warm_start(v_best_st1_alpha);
+        sv.set_kernel_cache(kernel_cache, v_point_ids);
+        sv.train_model_index_base(p_data, v_vol_p, n_data, v_vol_n, v_p_index, v_n_index,
+                                  iter_train_p_end, iter_train_n_end,true, point.C, point.G);
+        sv.predict_validation_data(*vd_set, v_summary[slot], slot);
+    };
+    v_solver.resize(solver_id + v_st2_ids.size());
+    v_summary.resize(solver_id + v_st2_ids.size());
+    TaskPool::getInstance()->run(v_st2_ids.size(), [&](int j){
+        if(DistTasks::owns(solver_id + j) && !find_cached(ud_params_st_2[v_st2_ids[j]], solver_id + j))
+            train_st2(ud_params_st_2[v_st2_ids[j]], solver_id + j);
+    });
+    DistTasks::gather(v_summary, solver_id, v_st2_ids.size());
+    for(unsigned int j = 0; j < v_st2_ids.size(); j++){
+        group_telemetry.add(v_summary[solver_id].telemetry);
+        TelemetryLog::getInstance()->write_candidate(level, classifier_id, v_summary[solver_id]);
+        ResultCache::getInstance()->add(data_fp, v_summary[solver_id]);
         ++solver_id;
     }
+    if(use_bo){
+        bayes_opt_stage(v_summary, [&](const ud_point& point){
+            v_solver.resize(solver_id + 1);
+            v_summary.resize(solver_id + 1);
+            if(DistTasks::owns(solver_id) && !find_cached(point, solver_id))
+                train_st2(point, solver_id);
+            DistTasks::gather(v_summary, solver_id, 1);
+            ResultCache::getInstance()->add(data_fp, v_summary[solver_id]);
+            ++solver_id;
+        }, level, classifier_id, group_telemetry);
+    }
 
     int best_of_all =  select_best_model(v_summary,level,2);
+    // the owner sends its model to the other ranks, it is empty if the result came from the result cache
+    std::vector<double> v_best_model;
+    if(DistTasks::distributed() && v_solver[best_of_all].get_model() != NULL)
+        v_solver[best_of_all].get_model_values(v_best_model);
+    DistTasks::broadcast(v_best_model, DistTasks::owner(best_of_all));
+    if(v_solver[best_of_all].get_model() == NULL){      // the solution needs its model, it is trained only if no rank has it
+        summary kept_summary = v_summary[best_of_all];
+        v_solver[best_of_all].set_model_values(v_best_model);
+        if((unsigned int) best_of_all < num_iter_st1){
+            train_st1(best_of_all);
+        }else{
+            ud_point best_point = {v_summary[best_of_all].C, v_summary[best_of_all].gamma};
+            train_st2(best_point, best_of_all);
+        }
+        group_telemetry.add(v_summary[best_of_all].telemetry);
+        v_summary[best_of_all] = kept_summary;
+    }
+    TelemetryLog::getInstance()->write_group(level, classifier_id, v_summary[best_of_all], group_telemetry);
+    best_summary_ = v_summary[best_of_all];
     t_sv_ps.stop_timer("[MS][UDIBSepVal] model training");
+    if(kernel_cache != kernel_cache_)       // only destroy the local cache
+        svm_kernel_cache_destroy(&kernel_cache);
 
     // - - - - - - - - prepare the solution for refinement - - - - - - - - -
     Solver best_sv = v_solver[best_of_all];
     svm_model * best_model = best_sv.get_model() ;
     if(level > 1 ){     // at the finest level, we need to save the model (SV, C, gamma) for unseen points
         // ----- create the index of SVs in data points for each class seperately ----
+        // the alphas are kept to warm start the finer level, a point in multiple groups keeps the largest alpha
         PetscInt i;
         for (i=0; i < best_model->nSV[0];i++){
-            uset_SV_index_p.insert(v_p_index[best_model->sv_indices[i] - 1]);
+            double & sv_alpha = umap_SV_alpha_p[v_p_index[best_model->sv_indices[i] - 1]];
+            sv_alpha = std::max(sv_alpha, fabs(best_model->sv_coef[0][i]));
         }
         for (int i=0; i < best_model->nSV[1];i++){
-            uset_SV_index_n.insert(v_n_index[ best_model->sv_indices[best_model->nSV[0] + i] - 1 - iter_train_p_end]);
+            double & sv_alpha = umap_SV_alpha_n[v_n_index[ best_model->sv_indices[best_model->nSV[0] + i] - 1 - iter_train_p_end]];
+            sv_alpha = std::max(sv_alpha, fabs(best_model->sv_coef[0][best_model->nSV[0] + i]));
         }
     }else{
         if(Config_params::getInstance()->get_ms_save_final_model()){
@@ -886,9 +1322,14 @@ void ModelSelection::uniform_design_index_base_separate_validation(Mat& p_data,
 
     //@@ calculating the validation data for all the partition groups are missed, I need to save the results for picking the best level //#TODO 021317-1750
 //    best_sv.predict_VD_in_output_matrix(m_VD_p, m_VD_n, classifier_id, m_all_predict_VD);  //added 021517-1328
-    best_sv.predict_test_data_in_matrix_output(m_VD_both, classifier_id, m_all_predict_VD);  //added 021517-1456
+    if(linear_stack_ != NULL && best_model->w != NULL){
+        linear_stack_->add(classifier_id, best_model);      // predicted with the other groups by the caller
+    }else{
+        best_sv.predict_VD_in_output_matrix(*vd_set, classifier_id, m_all_predict_VD);  // the same rows as m_VD_both
 
-    best_sv.predict_test_data_in_matrix_output(m_testdata, classifier_id, m_all_predict_TD);
+        std::shared_ptr<const PredictionSet> td_set = PredictionSet::test(Config_params::getInstance()->get_test_ds_f_name(), m_testdata);
+        best_sv.predict_test_data_in_matrix_output(*td_set, classifier_id, m_all_predict_TD);
+    }
 
 #if export_SVM_models == 1       //export the model (we save a model at a time)
     //save the models in a local folder
@@ -899,12 +1340,18 @@ void ModelSelection::uniform_design_index_base_separate_validation(Mat& p_data,
             "_exp_" + std::to_string(Config_params::getInstance()->get_main_current_exp_id()) +
             "_kf_" + std::to_string(Config_params::getInstance()->get_main_current_kf_id()) +
             "_level_" + std::to_string(Config_params::getInstance()->get_main_current_level_id()) +
-            "_gid_" + std::to_string(classifier_id) + ".svmmodel";
-    svm_save_model(output_file.c_str(), best_model);
+            "_gid_" + std::to_string(classifier_id);
+#if export_SVM_models_format != 1
+    svm_save_model((output_file + ".svmmodel").c_str(), best_model);
+#endif
+#if export_SVM_models_format >= 1
+    ModelBinary::save_async(output_file + ".svmbin", best_model, v_group_center_);     // the center is used to pick the models in prediction
+#endif
     printf("[MS][UDIBSepVal] model %s is saved\n", output_file.c_str());
-
 #endif
 
+    report_rff_agreement(best_model, *vd_set, "[MS][UDIBSepVal]");
+
 
     for(auto it=v_solver.begin(); it!= v_solver.end(); ++it){
         it->free_solver("[MS][UDIBSepVal] ");   //free all solvers
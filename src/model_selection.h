@@ -2,6 +2,13 @@
 #define MODEL_SELECTION_H
 
 #include "solver.h"
+#include "stacked_linear.h"
+#include "buffer_pool.h"
+#include "training_problem.h"
+#include "prediction_set.h"
+#include <unordered_map>
+#include <memory>
+#include <functional>
 
 struct ms_range{
     double min;
@@ -11,6 +18,11 @@ struct ud_point{
     double C;
     double G;
 };
+struct sh_rung{                 // a rung of the successive halving on a subsample
+    int num_candidates;
+    int num_promoted;           // the best 1/eta (rounded up) move to the next rung
+    double fraction;            // of the points of each class
+};
 
 
 
@@ -23,12 +35,49 @@ public:
 
     void main(Mat& p_data, Vec& v_vol_p, Mat& n_data, Vec& v_vol_n, int level, svm_model& best_trained_model);
 
+    /*
+     * share the kernel rows of the index base model selection with the other calls (e.g. other partition groups)
+     * the ids of the cache are the rows of p_data followed by the rows of n_data
+     * the caller owns the cache, NULL means each call uses its own cache
+     */
+    void set_kernel_cache(svm_kernel_cache * kernel_cache){
+        kernel_cache_ = kernel_cache;
+    }
+
+    // the center of the partition group which is saved with the exported model (dense, all the features)
+    void set_group_center(const std::vector<double>& v_center){
+        v_group_center_ = v_center;
+    }
+
+    /*
+     * the index base model selection adds its best model to the stack (if it has the linear weights)
+     * instead of predicting the VD and TD, the caller predicts all the stacked models at once
+     */
+    void set_linear_stack(StackedLinearModels * linear_stack){
+        linear_stack_ = linear_stack;
+    }
+
+    // the problem arrays of all the trainings are reused through the pool (owned by the caller, NULL disables)
+    void set_buffer_pool(BufferPool * buffer_pool){
+        buffer_pool_ = buffer_pool;
+    }
+
+    // the model selected by the last uniform_design_index_base_separate_validation (C, gamma and validation measures)
+    const summary& get_best_summary() const{
+        return best_summary_;
+    }
+
     void uniform_design(Mat& p_data, Vec& v_vol_p, Mat& n_data, Vec& v_vol_n, bool inh_params,
                         double param_C, double param_G, int level, solution & udc_sol);
 
+    /*
+     * v_init_alpha is optional and contains the projected alphas from the coarser level for the training points
+     * (positive points first), they are used to warm start the 1st stage
+     */
     void uniform_design_separate_validation(Mat& m_train_data_p, Vec& v_train_vol_p, Mat& m_train_data_n, Vec& v_train_vol_n,
                                             bool inh_params, double param_C, double param_G, Mat& m_VD_p, Mat& m_VD_n, int level,
-                                            solution & udc_sol, std::vector<ref_results>& v_ref_results);
+                                            solution & udc_sol, std::vector<ref_results>& v_ref_results,
+                                            const std::vector<double>& v_init_alpha = std::vector<double>());
 
 
     void uniform_design_index_base(Mat& p_data, Vec& v_vol_p, Mat& n_data, Vec& v_vol_n, bool inh_params, double last_c,
@@ -42,34 +91,72 @@ public:
      * inh_params is either 0, 1 : 0 means not to inherit the C, gamma parameters and 1 is vice versa
      * v_p_index is the vector of indices for the points in p_data (v_vol_p) which were Support Vector or their neighbors in coarser level
      * v_n_index is the same as v_p_index for negative class (majority class)
-     * uset_SV_index_p is the set of indices for all the points which are selected as SV as this level, it stores all other SVs
-     * which are selected in other calls to this method
-     * uset_SV_index_n is the same as above for negative class
+     * umap_SV_alpha_p maps the indices for all the points which are selected as SV as this level to their alphas,
+     * it stores all other SVs which are selected in other calls to this method
+     * umap_SV_alpha_n is the same as above for negative class
      * the m_VD_p and m_VD_n are validation data which comes from whole training data in the beginning of the v-cycle
      * the m_testdata is the real testdata from the beginning of the v-cycle
      * the classifier_id is the group id which is a set of partitions from both classes
      * m_all_predict stores the predicted lables for classifier i at row i
+     * v_init_alpha_p, v_init_alpha_n are the projected alphas from the coarser level for all the rows of p_data, n_data
+     * (empty vectors mean a cold start)
      */
     void uniform_design_index_base_separate_validation(Mat& p_data, Vec& v_vol_p, Mat& n_data, Vec& v_vol_n,
                             bool inh_params, double last_c, double last_gamma,int level,
                             std::vector<PetscInt>& v_p_index, std::vector<PetscInt>& v_n_index,
-                            std::unordered_set<PetscInt>& uset_SV_index_p, std::unordered_set<PetscInt>& uset_SV_index_n,
-                            Mat& m_VD_p, Mat& m_VD_n, Mat& m_VD_both, Mat& m_all_predict_VD, Mat& m_testdata, int classifier_id, Mat& m_all_predict_TD);
+                            std::unordered_map<PetscInt,double>& umap_SV_alpha_p, std::unordered_map<PetscInt,double>& umap_SV_alpha_n,
+                            Mat& m_VD_p, Mat& m_VD_n, Mat& m_VD_both, Mat& m_all_predict_VD, Mat& m_testdata, int classifier_id, Mat& m_all_predict_TD,
+                            const std::vector<double>& v_init_alpha_p, const std::vector<double>& v_init_alpha_n);
 private :
 
     ms_range range_c;     // range of C
     ms_range range_g;     // range of gamma
     ud_point point_center;      // center point
+    svm_kernel_cache * kernel_cache_ = NULL;    // shared by the caller, see set_kernel_cache
+    std::vector<double> v_group_center_;        // see set_group_center
+    StackedLinearModels * linear_stack_ = NULL; // see set_linear_stack
+    BufferPool * buffer_pool_ = NULL;           // see set_buffer_pool
+    summary best_summary_;                      // see get_best_summary
 
 //    bool sortByGmean(const summary &lhs, const summary &rhs);
     summary summary_factory_update_iter(const summary& in_summary, const int iter);
 
 protected:
     void set_range();
-    std::vector<ud_point> ud_param_generator(int stage, bool inh_param, double param_C, double param_G);
+    // num_points is the size of the UD pattern (3 to 30), 0 uses ms_first_stage or ms_second_stage of the stage
+    std::vector<ud_point> ud_param_generator(int stage, bool inh_param, double param_C, double param_G, int num_points = 0);
     int select_best_model(std::vector<summary> map_summary, int level, int stage);
 
     void add_debug_parameters(std::vector<ud_point>& v_initialized_params);
+
+    /*
+     * sequential trainings of the Bayesian optimization (ms_method 2) after the UD points of the 1st stage
+     * the Gaussian process is seeded by the history of the previous selections (coarser levels, other groups and folds)
+     * and the candidates in v_summary, train_candidate trains a point and appends its result to v_summary
+     */
+    void bayes_opt_stage(std::vector<summary>& v_summary, const std::function<void(const ud_point&)>& train_candidate,
+                         int level, int group_id, train_telemetry& group_telemetry);
+    int bo_init_points();
+
+    /*
+     * rungs of the successive halving (ms_method 1) on the nested subsamples of full_problem
+     * the candidates are the UD pattern of ms_sh_candidates points around (param_C, param_G),
+     * each rung is ranked by the validation data and keeps the best 1/ms_sh_eta for the next rung,
+     * returns the survivors which the caller trains on all the points (last rung)
+     */
+    std::vector<ud_point> successive_halving(const std::shared_ptr<const TrainingProblem>& full_problem, bool inh_params,
+                                             double param_C, double param_G, const PredictionSet& vd_set,
+                                             int level, int group_id, train_telemetry& group_telemetry);
+    // the rungs on the subsamples, the last one leaves at most eta survivors (e.g. 27, eta 3: 27 on 1/9 and 9 on 1/3)
+    static std::vector<sh_rung> sh_schedule(int num_candidates, int eta);
+    // the points of a class in a rung, at least 20 (or all the points of the class)
+    static int sh_subsample_size(int num_points, double fraction);
+    svm_kernel_cache * create_kernel_cache(PetscInt num_points);
+    /*
+     * the agreement of the random features (svm_rff_dim) with the exact model on a sample of svm_rff_check
+     * validation points, the prediction tool compiles the same approximation (same seed), 0 skips the report
+     */
+    void report_rff_agreement(const svm_model * model, const PredictionSet& vd_set, const char * tag);
 };
 #endif // MODEL_SELECTION_H
 
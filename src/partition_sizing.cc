@@ -0,0 +1,200 @@
+#include "partition_sizing.h"
+#include "config_params.h"
+#include "task_pool.h"
+#include "dist_tasks.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+// solves the k x k system in place (partial pivoting), false if it is singular
+static bool solve_linear(std::vector<double>& A, std::vector<double>& b, int k){
+    for(int col=0; col < k; col++){
+        int pivot = col;
+        for(int row=col+1; row < k; row++)
+            if(fabs(A[row * k + col]) > fabs(A[pivot * k + col]))
+                pivot = row;
+        if(fabs(A[pivot * k + col]) < 1e-300)
+            return false;
+        if(pivot != col){
+            for(int j=0; j < k; j++)
+                std::swap(A[col * k + j], A[pivot * k + j]);
+            std::swap(b[col], b[pivot]);
+        }
+        for(int row=col+1; row < k; row++){
+            double factor = A[row * k + col] / A[col * k + col];
+            for(int j=col; j < k; j++)
+                A[row * k + j] -= factor * A[col * k + j];
+            b[row] -= factor * b[col];
+        }
+    }
+    for(int row=k-1; row >= 0; row--){
+        for(int j=row+1; j < k; j++)
+            b[row] -= A[row * k + j] * b[j];
+        b[row] /= A[row * k + row];
+    }
+    return true;
+}
+
+
+void PartitionSizing::probe(Mat& m_data_p, Vec& v_vol_p, Mat& m_data_n, Vec& v_vol_n, double param_C, double param_G, int level){
+    int num_probes = Config_params::getInstance()->get_pr_adaptive();
+    PetscInt num_p, num_n;
+    MatGetSize(m_data_p, &num_p, NULL);
+    MatGetSize(m_data_n, &num_n, NULL);
+    MatInfo info_p, info_n;
+    MatGetInfo(m_data_p, MAT_LOCAL, &info_p);
+    MatGetInfo(m_data_n, MAT_LOCAL, &info_n);
+    avg_nnz_ = (info_p.nz_used + info_n.nz_used) / (num_p + num_n);
+
+    // the subsets are nested, each probe takes the first points of the same permutation of each class
+    std::vector<PetscInt> v_perm_p(num_p), v_perm_n(num_n);
+    std::iota(v_perm_p.begin(), v_perm_p.end(), 0);
+    std::iota(v_perm_n.begin(), v_perm_n.end(), 0);
+    std::mt19937 gen(std::stoll(Config_params::getInstance()->get_cpp_srand_seed()));
+    std::shuffle(v_perm_p.begin(), v_perm_p.end(), gen);
+    std::shuffle(v_perm_n.begin(), v_perm_n.end(), gen);
+
+    // only the root trains the probes, the other ranks fit its timings (the same model gives the same size on all the ranks)
+    double size = 2 * std::max(100, Config_params::getInstance()->get_pr_partition_max_size() / 4);
+    for(int k=0; DistTasks::is_root() && k < num_probes; k++, size *= 2){
+        PetscInt sub_p = std::min(num_p, (PetscInt) (size / 2));
+        PetscInt sub_n = std::min(num_n, (PetscInt) size - sub_p);
+        if(!v_probes_.empty() && sub_p + sub_n <= v_probes_.back().size)
+            break;                  // the level is smaller than this probe
+        std::vector<PetscInt> v_p_index(v_perm_p.begin(), v_perm_p.begin() + sub_p);
+        std::vector<PetscInt> v_n_index(v_perm_n.begin(), v_perm_n.begin() + sub_n);
+        std::sort(v_p_index.begin(), v_p_index.end());
+        std::sort(v_n_index.begin(), v_n_index.end());
+        PetscInt ncols, sum_nnz = 0;
+        for(PetscInt i : v_p_index){
+            MatGetRow(m_data_p, i, &ncols, NULL, NULL);
+            sum_nnz += ncols;
+            MatRestoreRow(m_data_p, i, &ncols, NULL, NULL);
+        }
+        for(PetscInt i : v_n_index){
+            MatGetRow(m_data_n, i, &ncols, NULL, NULL);
+            sum_nnz += ncols;
+            MatRestoreRow(m_data_n, i, &ncols, NULL, NULL);
+        }
+
+        std::chrono::steady_clock::time_point t_start = std::chrono::steady_clock::now();     // wall time (the SMO may be parallel)
+        Solver sv;
+        sv.train_model_index_base(m_data_p, v_vol_p, m_data_n, v_vol_n, v_p_index, v_n_index, sub_p, sub_n,
+                                  true, param_C, param_G);
+        probe_t new_probe;
+        new_probe.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+        sv.free_solver("[RF][AP] ");
+        new_probe.size = sub_p + sub_n;
+        new_probe.nnz = (double) sum_nnz / new_probe.size;
+        v_probes_.push_back(new_probe);
+        printf("[RF][AP] level:%d probe points:%d (P:%d, N:%d), nnz per point:%g, time:%g\n",
+               level, sub_p + sub_n, sub_p, sub_n, new_probe.nnz, new_probe.time);
+    }
+    if(DistTasks::distributed()){
+        std::vector<double> v_timings;
+        for(const probe_t& pr : v_probes_){
+            v_timings.push_back(pr.size);
+            v_timings.push_back(pr.nnz);
+            v_timings.push_back(pr.time);
+        }
+        DistTasks::broadcast(v_timings, 0);
+        v_probes_.clear();
+        for(unsigned int i=0; i + 2 < v_timings.size(); i += 3)
+            v_probes_.push_back({v_timings[i], v_timings[i + 1], v_timings[i + 2]});
+    }
+    fit();
+}
+
+
+void PartitionSizing::fit(){
+    // nonnegative least squares by trying all the subsets of the terms, the residuals are relative to the times
+    double best_residual = -1;
+    for(int mask=1; mask < 8; mask++){
+        std::vector<int> v_terms;
+        for(int j=0; j < 3; j++)
+            if(mask & (1 << j))
+                v_terms.push_back(j);
+        int k = v_terms.size();
+        if(v_probes_.size() < (unsigned int) k)
+            continue;
+        std::vector<double> A(k * k, 0), b(k, 0);
+        std::vector<std::vector<double>> vv_rows;
+        for(const probe_t& pr : v_probes_){
+            double features[3] = {1, pr.size * pr.nnz, pr.size * pr.size * pr.nnz};
+            std::vector<double> v_row(k);
+            for(int j=0; j < k; j++)
+                v_row[j] = features[v_terms[j]] / pr.time;
+            for(int r=0; r < k; r++){
+                for(int c=0; c < k; c++)
+                    A[r * k + c] += v_row[r] * v_row[c];
+                b[r] += v_row[r];               // the target is time / time
+            }
+            vv_rows.push_back(v_row);
+        }
+        if(!solve_linear(A, b, k) || *std::min_element(b.begin(), b.end()) < 0)
+            continue;
+        double residual = 0;
+        for(const std::vector<double>& v_row : vv_rows){
+            double error = std::inner_product(v_row.begin(), v_row.end(), b.begin(), -1.0);
+            residual += error * error;
+        }
+        if(best_residual < 0 || residual < best_residual){
+            best_residual = residual;
+            std::fill(coef_, coef_ + 3, 0);
+            for(int j=0; j < k; j++)
+                coef_[v_terms[j]] = b[j];
+            fitted_ = true;
+        }
+    }
+}
+
+
+double PartitionSizing::predict_time(double size) const{
+    return coef_[0] + coef_[1] * size * avg_nnz_ + coef_[2] * size * size * avg_nnz_;
+}
+
+
+double PartitionSizing::predict_wall(PetscInt num_p, PetscInt num_n, int max_size, int& num_groups) const{
+    int parts_p = ceil((double) num_p / max_size);          // same as Refinement::main
+    int parts_n = ceil((double) num_n / max_size);
+    num_groups = (parts_p < 2 || parts_n < 2) ? std::max(parts_p, parts_n) : parts_p + parts_n;     // see find_groups
+    double group_size = (double) num_p / parts_p + (double) num_n / parts_n;
+    // the candidates of a group (about ms_first_stage) share the workers, the groups of a level are trained at the same time
+    // except under MPI, where the ranks train the groups one after another (see Refinement::main)
+    int num_workers = TaskPool::getInstance()->get_width() * DistTasks::size();
+    int num_candidates = Config_params::getInstance()->get_ms_first_stage();
+    if(DistTasks::distributed())
+        return num_groups * ceil((double) num_candidates / num_workers) * predict_time(group_size);
+    return ceil((double) num_groups * num_candidates / num_workers) * predict_time(group_size);
+}
+
+
+int PartitionSizing::best_partition_max_size(PetscInt num_p, PetscInt num_n, int static_size, int level) const{
+    int best_size = static_size;
+    if(fitted_){
+        int num_groups;
+        double best_wall = predict_wall(num_p, num_n, static_size, num_groups);
+        for(double size = std::max(100, static_size / 4); size <= 4.0 * static_size; size *= 1.1){
+            double wall = predict_wall(num_p, num_n, (int) size, num_groups);
+            if(wall < best_wall){
+                best_wall = wall;
+                best_size = (int) size;
+            }
+        }
+    }
+    if(!fitted_){
+        printf("[RF][AP] level:%d the cost model is not fitted (%lu probes), partition max size:%d\n",
+               level, v_probes_.size(), best_size);
+        return best_size;
+    }
+    int best_groups, static_groups;
+    double best_wall = predict_wall(num_p, num_n, best_size, best_groups);
+    double static_wall = predict_wall(num_p, num_n, static_size, static_groups);
+    printf("[RF][AP] level:%d cost model t(n) = %g + %g n d + %g n^2 d, d:%g, workers:%d\n",
+           level, coef_[0], coef_[1], coef_[2], avg_nnz_, TaskPool::getInstance()->get_width() * DistTasks::size());
+    printf("[RF][AP] level:%d partition max size:%d (%d groups, predicted %g s), static:%d (%d groups, predicted %g s)\n",
+           level, best_size, best_groups, best_wall, static_size, static_groups, static_wall);
+    return best_size;
+}
@@ -0,0 +1,40 @@
+#ifndef PARTITION_SIZING_H
+#define PARTITION_SIZING_H
+
+#include "solver.h"
+#include <vector>
+
+/*
+ * adaptive pr_partition_max_size of a refinement level (pr_adaptive parameter, 0 keeps pr_partition_max_size)
+ * a few trainings on random subsets of the level's points (half of each class, like a group of two partitions)
+ * are timed by the root rank (the other ranks receive its timings, hence they select the same size)
+ * and t(n) = c0 + c1 n d + c2 n^2 d is fitted (n points, d nonzeros per point, all c >= 0), where c0 is
+ * the overhead of a training, c1 the linear part (e.g. building the problem) and c2 the kernel evaluations of SMO
+ * the size which minimizes the predicted wall time of all the groups of the level for the current workers is selected
+ * the size is searched within [pr_partition_max_size / 4 (at least 100), pr_partition_max_size * 4] to keep the groups comparable
+ */
+class PartitionSizing{
+public:
+    // time the trainings with the parameters of the coarser level (C, gamma)
+    void probe(Mat& m_data_p, Vec& v_vol_p, Mat& m_data_n, Vec& v_vol_n, double param_C, double param_G, int level);
+
+    // the partition max size with the smallest predicted wall time, static_size if the model can't be fitted
+    int best_partition_max_size(PetscInt num_p, PetscInt num_n, int static_size, int level) const;
+
+protected:                          // UT_Partitioning fits synthetic timings
+    struct probe_t{
+        double size;        // points
+        double nnz;         // nonzeros per point
+        double time;        // seconds (wall)
+    };
+    std::vector<probe_t> v_probes_;
+    double coef_[3] = {0, 0, 0};
+    double avg_nnz_ = 0;            // of the level
+    bool fitted_ = false;
+
+    void fit();
+    double predict_time(double size) const;
+    double predict_wall(PetscInt num_p, PetscInt num_n, int max_size, int& num_groups) const;
+};
+
+#endif // PARTITION_SIZING_H
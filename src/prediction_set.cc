@@ -0,0 +1,107 @@
+#include "prediction_set.h"
+#include "task_pool.h"
+#include "result_cache.h"
+
+std::shared_ptr<const PredictionSet> PredictionSet::current_vd_;
+std::shared_ptr<const PredictionSet> PredictionSet::current_td_;
+std::string PredictionSet::current_td_f_name_;
+
+
+PredictionSet::PredictionSet(Mat& m_data){
+    append(m_data, true, 0);
+}
+
+
+PredictionSet::PredictionSet(Mat& m_VD_p, Mat& m_VD_n){
+    append(m_VD_p, false, +1);
+    append(m_VD_n, false, -1);
+    m_src_p_ = m_VD_p;
+    m_src_n_ = m_VD_n;
+}
+
+
+void PredictionSet::append(Mat& m_data, bool has_label, double label){
+    PetscInt num_row, num_nz, ncols;
+    const PetscInt * cols;
+    const PetscScalar * vals;
+    MatInfo info;
+    MatGetSize(m_data, &num_row, NULL);
+    MatGetInfo(m_data, MAT_LOCAL, &info);
+    num_nz = (PetscInt) info.nz_used;
+    v_nodes_.reserve(v_nodes_.size() + num_nz + num_row);     // a terminator per row
+    v_row_start_.reserve(v_row_start_.size() + num_row);
+    v_labels_.reserve(v_labels_.size() + num_row);
+    for(PetscInt i=0; i < num_row; i++){
+        MatGetRow(m_data, i, &ncols, &cols, &vals);
+        v_row_start_.push_back(v_nodes_.size());
+        svm_node node;
+        if(has_label){
+            v_labels_.push_back(vals[0]);       // the label is in the 1st column, the indices are already shifted by 1
+            for(PetscInt k=1; k < ncols; k++){
+                node.index = cols[k];
+                node.value = vals[k];
+                v_nodes_.push_back(node);
+            }
+        }else{
+            v_labels_.push_back(label);
+            for(PetscInt k=0; k < ncols; k++){
+                node.index = cols[k] + 1;       // libsvm indices start at 1
+                node.value = vals[k];
+                v_nodes_.push_back(node);
+            }
+        }
+        node.index = -1;                        // end of the row
+        node.value = 0;
+        v_nodes_.push_back(node);
+        MatRestoreRow(m_data, i, &ncols, &cols, &vals);
+        if(v_labels_.back() == 1)
+            num_p_++;
+    }
+}
+
+
+uint64_t PredictionSet::fingerprint() const{
+    std::call_once(fingerprint_once_, [this](){
+        uint64_t hash = 14695981039346656037ULL;   // FNV offset basis
+        int num_rows = size();
+        hash = ResultCache::hash_bytes(&num_rows, sizeof(num_rows), hash);
+        hash = ResultCache::hash_bytes(v_labels_.data(), v_labels_.size() * sizeof(double), hash);
+        for(const svm_node& node : v_nodes_){       // field by field, the padding of svm_node is not initialized
+            hash = ResultCache::hash_bytes(&node.index, sizeof(node.index), hash);
+            hash = ResultCache::hash_bytes(&node.value, sizeof(node.value), hash);
+        }
+        fingerprint_ = hash;
+    });
+    return fingerprint_;
+}
+
+
+void PredictionSet::set_current(const std::shared_ptr<const PredictionSet>& vd_set,
+                                const std::shared_ptr<const PredictionSet>& td_set, const std::string& td_f_name){
+    current_vd_ = vd_set;
+    current_td_ = td_set;
+    current_td_f_name_ = td_f_name;
+}
+
+
+void PredictionSet::clear_current(){
+    current_vd_.reset();
+    current_td_.reset();
+    current_td_f_name_.clear();
+}
+
+
+std::shared_ptr<const PredictionSet> PredictionSet::validation(Mat& m_VD_p, Mat& m_VD_n){
+    if(current_vd_ && current_vd_->m_src_p_ == m_VD_p && current_vd_->m_src_n_ == m_VD_n)
+        return current_vd_;
+    std::lock_guard<std::mutex> petsc_lock(TaskPool::petsc_mutex());
+    return std::make_shared<const PredictionSet>(m_VD_p, m_VD_n);
+}
+
+
+std::shared_ptr<const PredictionSet> PredictionSet::test(const std::string& f_name, Mat& m_TD){
+    if(current_td_ && current_td_f_name_ == f_name)
+        return current_td_;
+    std::lock_guard<std::mutex> petsc_lock(TaskPool::petsc_mutex());
+    return std::make_shared<const PredictionSet>(m_TD);
+}
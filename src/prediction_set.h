@@ -0,0 +1,59 @@
+#ifndef PREDICTION_SET_H
+#define PREDICTION_SET_H
+
+#include "solver.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * rows of the validation or the test data in the libsvm format, converted once for all the predictions
+ * (all the candidates of the model selections at all the levels) instead of MatGetRow for each model
+ * the nodes of all the rows are in one array, each row ends with (-1,0), the label of each row is kept
+ * the set is read only after it is built, hence the solvers of the task pool use it without the PETSc lock
+ * the sets of the current V-cycle are built in mlsvm_classifier, the other callers (e.g. main_sl) get a new set
+ */
+class PredictionSet{
+public:
+    // labeled data (e.g. test data), the label is in the 1st column and the features start at index 1
+    PredictionSet(Mat& m_data);
+    // validation data (no label column), the positive rows (+1) and then the negative rows (-1) same as m_VD_both
+    PredictionSet(Mat& m_VD_p, Mat& m_VD_n);
+
+    int size() const                            { return (int) v_labels_.size(); }
+    int num_p() const                           { return num_p_; }
+    const svm_node * row(int i) const           { return &v_nodes_[v_row_start_[i]]; }
+    double label(int i) const                   { return v_labels_[i]; }
+    // hash of the rows and the labels (see ResultCache), computed at the first call (once per V-cycle for the current set)
+    uint64_t fingerprint() const;
+
+    // the sets of the current V-cycle, they are cleared before the validation matrices are destroyed
+    static void set_current(const std::shared_ptr<const PredictionSet>& vd_set,
+                            const std::shared_ptr<const PredictionSet>& td_set, const std::string& td_f_name);
+    static void clear_current();
+    // the current set if it is built from these matrices, otherwise a new set (the conversion holds the PETSc lock, see TaskPool)
+    static std::shared_ptr<const PredictionSet> validation(Mat& m_VD_p, Mat& m_VD_n);
+    // the current test set if it is loaded from the same file, otherwise m_TD is converted (same as above)
+    static std::shared_ptr<const PredictionSet> test(const std::string& f_name, Mat& m_TD);
+
+private:
+    std::vector<svm_node> v_nodes_;
+    std::vector<size_t> v_row_start_;
+    std::vector<double> v_labels_;
+    int num_p_ = 0;                             // rows with the +1 label
+    Mat m_src_p_ = NULL;                        // the source matrices of the validation data
+    Mat m_src_n_ = NULL;
+    mutable std::once_flag fingerprint_once_;
+    mutable uint64_t fingerprint_ = 0;
+
+    static std::shared_ptr<const PredictionSet> current_vd_;
+    static std::shared_ptr<const PredictionSet> current_td_;
+    static std::string current_td_f_name_;
+
+    // has_label: the label is in the 1st column, otherwise all the rows get the label and the indices are shifted by 1
+    void append(Mat& m_data, bool has_label, double label);
+};
+
+#endif // PREDICTION_SET_H
@@ -1,11 +1,16 @@
 #include "refinement.h"
 #include "partitioning.h"
+#include "partition_sizing.h"
 #include <cmath>        // round (ceil)
 #include "etimer.h"
 #include "loader.h"
 #include "common_funcs.h"
 #include "solver.h"
 #include "k_fold.h"
+#include "telemetry_log.h"
+#include "bayes_opt.h"
+#include "task_pool.h"
+#include "dist_tasks.h"
 
 
 #include <thread>
@@ -23,6 +28,19 @@ struct selected_agg
 };
 
 
+// average fraction of the SVs which the early exit prediction evaluated since the last report
+static void report_early_exit(const char * caller, int level){
+    if(!Config_params::getInstance()->get_svm_early_exit())
+        return;
+    long num_predictions, num_evaluated, num_total;
+    svm_get_early_exit_stats(&num_predictions, &num_evaluated, &num_total);
+    if(num_predictions > 0)
+        printf("%s early exit evaluated %g of the SVs on average (%ld points) at level %d\n",
+               caller, (double) num_evaluated / num_total, num_predictions, level);
+    svm_reset_early_exit_stats();
+}
+
+
 solution Refinement::main(Mat& m_data_p, Mat& m_P_p, Vec& v_vol_p, Mat&m_WA_p,
                           Mat& m_data_n, Mat& m_P_n, Vec& v_vol_n, Mat&m_WA_n, Mat& m_VD_p, Mat& m_VD_n,
                           solution& sol_coarser,int level, std::vector<ref_results>& v_ref_results){
@@ -50,8 +68,12 @@ solution Refinement::main(Mat& m_data_p, Mat& m_P_p, Vec& v_vol_p, Mat&m_WA_p,
     Mat m_new_neigh_p, m_new_neigh_n;
     IS IS_neigh_p, IS_neigh_n;
     /// - - - - - - - get new points for finer level - - - - - - -
-    find_SV_neighbors(m_data_p,m_P_p,sol_coarser.p_index, m_WA_p, m_new_neigh_p,"Minority",IS_neigh_p);
-    find_SV_neighbors(m_data_n,m_P_n,sol_coarser.n_index, m_WA_n, m_new_neigh_n,"Majority",IS_neigh_n);
+    // the alphas of the coarser SVs are projected to the new points to warm start the solver
+    std::vector<double> v_neigh_alpha_p, v_neigh_alpha_n;
+    find_SV_neighbors(m_data_p,m_P_p,sol_coarser.p_index, m_WA_p, m_new_neigh_p,"Minority",IS_neigh_p,
+                      sol_coarser.p_alpha, v_neigh_alpha_p);
+    find_SV_neighbors(m_data_n,m_P_n,sol_coarser.n_index, m_WA_n, m_new_neigh_n,"Majority",IS_neigh_n,
+                      sol_coarser.n_alpha, v_neigh_alpha_n);
 
 
     // - - - - get the size of neighbors - - - -
@@ -123,10 +145,20 @@ solution Refinement::main(Mat& m_data_p, Mat& m_P_p, Vec& v_vol_p, Mat&m_WA_p,
         std::vector<Mat> v_mat_avg_centers(num_iter_refinement);
         std::vector<Mat> v_mat_all_predict_validation(num_iter_refinement);
         std::vector<Mat> v_mat_all_predict_TD(num_iter_refinement);
-        std::unordered_set<PetscInt> uset_SV_index_p;
-        std::unordered_set<PetscInt> uset_SV_index_n;
-        uset_SV_index_p.reserve(2*num_neigh_row_p_);
-        uset_SV_index_p.reserve(2*num_neigh_row_n_);
+        std::unordered_map<PetscInt,double> umap_SV_alpha_p;       // SV index and its alpha
+        std::unordered_map<PetscInt,double> umap_SV_alpha_n;
+        umap_SV_alpha_p.reserve(2*num_neigh_row_p_);
+        umap_SV_alpha_n.reserve(2*num_neigh_row_n_);
+        // hundreds of groups train problems of similar sizes, their buffers are reused
+        BufferPool buffer_pool;
+
+        // - - - - the partition size is picked from the timed trainings at this level (if it is adaptive) - - - -
+        int partition_max_size = Config_params::getInstance()->get_pr_partition_max_size();
+        if(Config_params::getInstance()->get_pr_adaptive() > 0){
+            PartitionSizing sizing;
+            sizing.probe(m_new_neigh_p, v_neigh_Vol_p, m_new_neigh_n, v_neigh_Vol_n, sol_coarser.C, sol_coarser.gamma, level);
+            partition_max_size = sizing.best_partition_max_size(num_neigh_row_p_, num_neigh_row_n_, partition_max_size, level);
+        }
 
         // - - - - multiple iterations with different partitioning - - - -
         Partitioning pt;
@@ -134,7 +166,6 @@ solution Refinement::main(Mat& m_data_p, Mat& m_P_p, Vec& v_vol_p, Mat&m_WA_p,
             printf("[RF][main] + + + + Partitioning, level:%d, iter:%d + + + + \n",level,iter);
 
             // - - - - - - - - - - calc number of partitions - - - - - - - - - -  #1
-            int partition_max_size = Config_params::getInstance()->get_pr_partition_max_size();
             PetscInt num_vertex_p, num_vertex_n;
             MatGetSize(m_neigh_WA_p, &num_vertex_p,NULL);
             MatGetSize(m_neigh_WA_n, &num_vertex_n,NULL);
@@ -212,26 +243,16 @@ solution Refinement::main(Mat& m_data_p, Mat& m_P_p, Vec& v_vol_p, Mat&m_WA_p,
 
 
             ETimer t_all_parts_training;
-            for(int i = 0; i < v_groups.size() ; i++ ){
-                std::vector<PetscInt> v_p_index;
-                std::vector<PetscInt> v_n_index;
-                pt.create_group_index(i, v_groups, m_parts_p, m_parts_n, v_p_index, v_n_index);
-                // - - - - - - Train & predict Model - - - - - - -
-                //Without model selection
-//                Solver sv_part;
-//                sv_part.partial_solver(m_new_neigh_p, v_neigh_Vol_p, m_new_neigh_n, v_neigh_Vol_n, sol_coarser.C, sol_coarser.gamma, level,
-//                                    v_p_index,v_n_index, uset_SV_index_p, uset_SV_index_n, m_VD_p, m_VD_n,m_VD_both, v_mat_all_predict_validation[iter],
-//                                    m_TD, i, v_mat_all_predict_TD[iter]);
-
-                //with model selection
-                ModelSelection ms_partition;
-                ms_partition.uniform_design_index_base_separate_validation(m_new_neigh_p, v_neigh_Vol_p, m_new_neigh_n, v_neigh_Vol_n,
-                                true, sol_coarser.C, sol_coarser.gamma, level, v_p_index, v_n_index, uset_SV_index_p, uset_SV_index_n,
-                                m_VD_p, m_VD_n, m_VD_both, v_mat_all_predict_validation[iter], m_TD, i, v_mat_all_predict_TD[iter]);
-
-
-
-            }
+            // - - - - the indices of the groups are read before the groups are trained at the same time - - - -
+            int num_groups = v_groups.size();
+            std::vector<std::vector<PetscInt>> vv_p_index(num_groups), vv_n_index(num_groups);
+            for(int i = 0; i < num_groups ; i++ )
+                pt.create_group_index(i, v_groups, m_parts_p, m_parts_n, vv_p_index[i], vv_n_index[i]);
+            std::vector<summary> v_group_summary;
+            train_groups(m_new_neigh_p, v_neigh_Vol_p, m_new_neigh_n, v_neigh_Vol_n, sol_coarser.C, sol_coarser.gamma, level,
+                         vv_p_index, vv_n_index, v_mat_avg_centers[iter], buffer_pool,
+                         m_VD_p, m_VD_n, m_VD_both, v_mat_all_predict_validation[iter], m_TD, v_mat_all_predict_TD[iter],
+                         v_neigh_alpha_p, v_neigh_alpha_n, umap_SV_alpha_p, umap_SV_alpha_n, v_group_summary);
 
             Config_params::getInstance()->update_levels_models_info(level, v_groups.size());        // @072617
             t_all_parts_training.stop_timer("[RF][main] training for all partitions");
@@ -247,6 +268,9 @@ solution Refinement::main(Mat& m_data_p, Mat& m_P_p, Vec& v_vol_p, Mat&m_WA_p,
             MatAssemblyEnd(v_mat_all_predict_TD[iter], MAT_FINAL_ASSEMBLY);
 
         }// end of       for(int iter=0; iter < 2; iter++){  in line 81
+#if dbl_RF_main >= 1
+        buffer_pool.print_stats("[RF][main]");
+#endif
 
 
 
@@ -255,6 +279,8 @@ solution Refinement::main(Mat& m_data_p, Mat& m_P_p, Vec& v_vol_p, Mat&m_WA_p,
 
         // - - - - - - calculate and report the performance quality of all the trained model on the test data at the current level - - - - -
         pt.calc_performance_measure(m_TD, v_mat_avg_centers, v_mat_all_predict_TD,summary_TD);
+        TelemetryLog::getInstance()->end_level(level, curr_level_validation_summary);
+        report_early_exit("[RF][main]", level);
 
         // - - - - - - Add validation information for this level to the vector of whole results for all levels on validation data - - - - -
         ref_results current_level_refinement_results;
@@ -276,18 +302,20 @@ solution Refinement::main(Mat& m_data_p, Mat& m_P_p, Vec& v_vol_p, Mat&m_WA_p,
         if(level > 1 ){
             std::cout << "[RF][main] prepareing the solution except for the finest level" << std::endl;
 //            std::cout << "[RF][main] before prepare solution minority" << std::endl;
-            for(auto it = uset_SV_index_p.begin(); it!=uset_SV_index_p.end(); it++){
-                    sol_refine.p_index.push_back(*it);
+            for(auto it = umap_SV_alpha_p.begin(); it!=umap_SV_alpha_p.end(); it++){
+                    sol_refine.p_index.push_back(it->first);
+                    sol_refine.p_alpha.push_back(it->second);
                 }
 //            std::cout << "[RF][main] before prepare solution majority" << std::endl;
-            for(auto it = uset_SV_index_n.begin(); it!=uset_SV_index_n.end(); it++){
-                    sol_refine.n_index.push_back(*it);
+            for(auto it = umap_SV_alpha_n.begin(); it!=umap_SV_alpha_n.end(); it++){
+                    sol_refine.n_index.push_back(it->first);
+                    sol_refine.n_alpha.push_back(it->second);
                 }
             std::cout << "[RF][main] after prepare solution majority" << std::endl;
             sol_refine.C = sol_coarser.C;
             sol_refine.gamma = sol_coarser.gamma;
         #if dbl_RF_main_with_partition >=3
-            std::cout << "[RF][main] nSV+:"<< uset_SV_index_p.size() << " nSV-:"<< uset_SV_index_n.size() << std::endl;
+            std::cout << "[RF][main] nSV+:"<< umap_SV_alpha_p.size() << " nSV-:"<< umap_SV_alpha_n.size() << std::endl;
         #endif
 
 
@@ -315,9 +343,19 @@ solution Refinement::main(Mat& m_data_p, Mat& m_P_p, Vec& v_vol_p, Mat&m_WA_p,
         if(Config_params::getInstance()->get_ms_status() &&
             (num_neigh_row_p_ + num_neigh_row_n_) < Config_params::getInstance()->get_ms_limit()    ){
             // ------- call Model Selection (SVM) -------
+            std::vector<double> v_neigh_alpha;          // the training problem has the positive points first
+            if(!v_neigh_alpha_p.empty() && !v_neigh_alpha_n.empty()){
+                v_neigh_alpha = v_neigh_alpha_p;
+                v_neigh_alpha.insert(v_neigh_alpha.end(), v_neigh_alpha_n.begin(), v_neigh_alpha_n.end());
+            }
             ModelSelection ms_refine;
+            BufferPool buffer_pool;
+            ms_refine.set_buffer_pool(&buffer_pool);
             ms_refine.uniform_design_separate_validation(m_new_neigh_p, v_vol_p, m_new_neigh_n, v_vol_n, true,
-                                                         sol_coarser.C, sol_coarser.gamma, m_VD_p, m_VD_n, level, sol_refine, v_ref_results);
+                                                         sol_coarser.C, sol_coarser.gamma, m_VD_p, m_VD_n, level, sol_refine, v_ref_results,
+                                                         v_neigh_alpha);
+            TelemetryLog::getInstance()->end_level(level, v_ref_results.back().validation_data_summary);
+            report_early_exit("[RF][main]", level);
 #if dbl_RF_main_no_partition >=1
             std::cout << "[RF]{no partitioning} ms_active uniform design is finished!\n";
 #endif
@@ -356,6 +394,103 @@ solution Refinement::main(Mat& m_data_p, Mat& m_P_p, Vec& v_vol_p, Mat&m_WA_p,
 
 
 
+void Refinement::train_groups(Mat& m_data_p, Vec& v_vol_p, Mat& m_data_n, Vec& v_vol_n, double param_C, double param_G, int level,
+                              std::vector<std::vector<PetscInt>>& vv_p_index, std::vector<std::vector<PetscInt>>& vv_n_index,
+                              Mat& m_avg_centers, BufferPool& buffer_pool,
+                              Mat& m_VD_p, Mat& m_VD_n, Mat& m_VD_both, Mat& m_predict_VD, Mat& m_TD, Mat& m_predict_TD,
+                              const std::vector<double>& v_init_alpha_p, const std::vector<double>& v_init_alpha_n,
+                              std::unordered_map<PetscInt,double>& umap_SV_alpha_p, std::unordered_map<PetscInt,double>& umap_SV_alpha_n,
+                              std::vector<summary>& v_group_summary){
+    int num_groups = vv_p_index.size();
+    PetscInt num_row_p, num_row_n;
+    MatGetSize(m_data_p, &num_row_p, NULL);
+    MatGetSize(m_data_n, &num_row_n, NULL);
+    // the linear models of the groups are predicted together after the training
+    StackedLinearModels linear_stack;
+    bool use_linear_stack = Config_params::getInstance()->get_svm_kernel_type() == 0 &&
+                            Config_params::getInstance()->get_svm_linear_weights();
+
+    // the groups share the partitions of the smaller class and inherit the same parameters, hence they share kernel rows
+    // the rows hold only the points of the groups (the ids of ModelSelection are the rows of p_data, then of n_data)
+    svm_kernel_cache * kernel_cache = NULL;
+    if(Config_params::getInstance()->get_ms_shared_cache_size() > 0){
+        std::vector<char> v_used(num_row_p + num_row_n, 0);
+        for(int i = 0; i < num_groups ; i++ ){
+            for(PetscInt idx : vv_p_index[i])
+                v_used[idx] = 1;
+            for(PetscInt idx : vv_n_index[i])
+                v_used[num_row_p + idx] = 1;
+        }
+        std::vector<int> v_ids;
+        for(size_t k = 0; k < v_used.size(); k++)
+            if(v_used[k])
+                v_ids.push_back(k);
+        kernel_cache = svm_kernel_cache_create_ids(v_used.size(), v_ids.data(), v_ids.size(),
+                                                   Config_params::getInstance()->get_ms_shared_cache_size());
+    }
+#if export_SVM_models == 1
+    // the centers are read before the groups are trained at the same time
+    PetscInt num_features;
+    MatGetSize(m_avg_centers, NULL, &num_features);
+    std::vector<std::vector<double>> vv_center(num_groups, std::vector<double>(num_features, 0));
+    for(int i = 0; i < num_groups ; i++ ){
+        PetscInt ncols;
+        const PetscInt    *cols;
+        const PetscScalar *vals;
+        MatGetRow(m_avg_centers, i, &ncols, &cols, &vals);
+        for(PetscInt j=0; j < ncols; j++)
+            vv_center[i][cols[j]] = vals[j];
+        MatRestoreRow(m_avg_centers, i, &ncols, &cols, &vals);
+    }
+#endif
+    // each group collects its SVs, they are merged after all the groups are trained (see below)
+    std::vector<std::unordered_map<PetscInt,double>> v_umap_SV_alpha_p(num_groups), v_umap_SV_alpha_n(num_groups);
+    v_group_summary.assign(num_groups, summary());
+    auto train_group = [&](int i){
+        ModelSelection ms_partition;
+        ms_partition.set_kernel_cache(kernel_cache);
+        ms_partition.set_buffer_pool(&buffer_pool);
+        if(use_linear_stack)
+            ms_partition.set_linear_stack(&linear_stack);
+#if export_SVM_models == 1
+        ms_partition.set_group_center(vv_center[i]);
+#endif
+        ms_partition.uniform_design_index_base_separate_validation(m_data_p, v_vol_p, m_data_n, v_vol_n,
+                        true, param_C, param_G, level, vv_p_index[i], vv_n_index[i],
+                        v_umap_SV_alpha_p[i], v_umap_SV_alpha_n[i],
+                        m_VD_p, m_VD_n, m_VD_both, m_predict_VD, m_TD, i, m_predict_TD,
+                        v_init_alpha_p, v_init_alpha_n);
+        v_group_summary[i] = ms_partition.get_best_summary();
+    };
+    // the groups read the same Bayesian optimization history, hence the order they run in doesn't matter
+    BayesOpt::begin_batch();
+    if(DistTasks::distributed()){
+        // the ranks gather the candidates of each group (see DistTasks), hence they train the groups in the same order
+        for(int i = 0; i < num_groups ; i++ )
+            train_group(i);
+    }else{
+        // the groups and their candidates share the workers (nested batches, see TaskPool)
+        TaskPool::getInstance()->run(num_groups, train_group);
+    }
+    BayesOpt::end_batch();
+    // a point in multiple groups keeps the largest alpha, hence the order of the groups doesn't matter
+    for(int i = 0; i < num_groups ; i++ ){
+        for(auto it = v_umap_SV_alpha_p[i].begin(); it != v_umap_SV_alpha_p[i].end(); ++it){
+            double & sv_alpha = umap_SV_alpha_p[it->first];
+            sv_alpha = std::max(sv_alpha, it->second);
+        }
+        for(auto it = v_umap_SV_alpha_n[i].begin(); it != v_umap_SV_alpha_n[i].end(); ++it){
+            double & sv_alpha = umap_SV_alpha_n[it->first];
+            sv_alpha = std::max(sv_alpha, it->second);
+        }
+    }
+
+    linear_stack.predict(m_VD_both, m_predict_VD);
+    linear_stack.predict(m_TD, m_predict_TD);
+    svm_kernel_cache_destroy(&kernel_cache);
+}
+
+
 /*
  * @input:
  *      cc_name: class name used for logging information
@@ -369,7 +504,7 @@ solution Refinement::main(Mat& m_data_p, Mat& m_P_p, Vec& v_vol_p, Mat&m_WA_p,
 //                                      IS& IS_neigh_id){
 void Refinement::find_SV_neighbors(Mat& m_data, Mat& m_P, std::vector<int>& seeds_ind,
                                       Mat& m_WA, Mat& m_neighbors, std::string cc_name,
-                                      IS& IS_neigh_id){
+                                      IS& IS_neigh_id, const std::vector<double>& seeds_alpha, std::vector<double>& v_neigh_alpha){
 
     // create the index set to get the sub matrix in the end
     PetscInt        * ind_;         //arrays of Int that contains the row indices
@@ -421,6 +556,12 @@ void Refinement::find_SV_neighbors(Mat& m_data, Mat& m_P, std::vector<int>& seed
     /// - - - - - reserve as the number of rows in finer data set (for each class) - - - - -
     std::vector<int> v_fine_neigh_id(num_row_fine_points);
 
+    // projected alphas (P * alpha_coarse) for warm start, only if the alphas of the seeds are provided
+    bool project_alpha = Config_params::getInstance()->get_ms_warm_start() && (seeds_alpha.size() == seeds_ind.size());
+    std::vector<double> v_fine_alpha;
+    if(project_alpha)
+        v_fine_alpha.assign(num_row_fine_points, 0);
+
     /// - - - - - - - - - Select fine points - - - - - - - -
     // Loop over indices of SV's in coarser level in P' matrix (Oct 2, #bug, fixed)
     for(unsigned int i=0; i < num_seeds ; i++){
@@ -437,6 +578,11 @@ void Refinement::find_SV_neighbors(Mat& m_data, Mat& m_P, std::vector<int>& seed
                            << seeds_ind[i] << " ncols:" << ncols << std::endl;
         #endif
 #endif
+        if(project_alpha){
+            for(int j=0; j < ncols ; j++){
+                v_fine_alpha[cols[j]] += vals[j] * seeds_alpha[i];
+            }
+        }
         // - - - - if there is only one node in this aggregate, select it - - - -
         if(ncols == 1){
             v_fine_neigh_id[cols[0]] = 1;
@@ -521,6 +667,13 @@ void Refinement::find_SV_neighbors(Mat& m_data, Mat& m_P, std::vector<int>& seed
         }
     }   // the ind_ is sorted as it fills in sorted order (i is sorted in the above loop)
 
+    v_neigh_alpha.clear();
+    if(project_alpha){                          // same order as the rows of m_neighbors
+        v_neigh_alpha.reserve(cnt_total);
+        for(int i=0; i < cnt_total; i++)
+            v_neigh_alpha.push_back(v_fine_alpha[ind_[i]]);
+    }
+
 
     // Using WA matrix, find the neighbors of points which are participated in SV's aggregate
 #if dbl_RF_FSN >=1      // this should be 1
@@ -605,8 +758,12 @@ void Refinement::process_coarsest_level(Mat& m_data_p, Vec& v_vol_p, Mat& m_data
 
         // call model selection method
         ModelSelection ms_coarsest;
+        BufferPool buffer_pool;
+        ms_coarsest.set_buffer_pool(&buffer_pool);
         ms_coarsest.uniform_design_separate_validation(m_data_p, v_vol_p, m_data_n, v_vol_n, l_inh_param, local_param_c, local_param_gamma,
                                                        m_VD_p, m_VD_n, level, sol_coarsest,v_ref_results);
+        TelemetryLog::getInstance()->end_level(level, v_ref_results.back().validation_data_summary);
+        report_early_exit("[RF][PCL]", level);
 //        std::cout << "[RF][PCL] nSV+:" << sol_coarsest.p_index.size() << std::endl;     //$$debug
 
     }else{                                          // - - - - No model selection (call solver directly) - - - -
@@ -685,3 +842,28 @@ void Refinement::add_best_model(std::vector<ref_results>& v_ref_results) const{
     Config_params::getInstance()->add_final_summary(v_ref_results[0].test_data_summary, v_ref_results[0].level);
 
 }
+
+
+
+bool Refinement::plateau_reached(const std::vector<ref_results>& v_ref_results){
+    int patience = Config_params::getInstance()->get_rf_patience();
+    if(patience <= 0 || v_ref_results.size() <= (unsigned int) patience)
+        return false;
+    double gm_tol = Config_params::getInstance()->get_rf_gm_tol();
+    // the results are in the order of the refinement (coarsest level first)
+    double best_gmean = v_ref_results[0].validation_data_summary.perf.at(Gmean);
+    int num_no_gain = 0;
+    for(unsigned int i=1; i < v_ref_results.size(); i++){
+        double gmean = v_ref_results[i].validation_data_summary.perf.at(Gmean);
+        if(gmean > best_gmean + gm_tol)
+            num_no_gain = 0;
+        else
+            num_no_gain++;
+        best_gmean = std::max(best_gmean, gmean);
+    }
+#if dbl_RF_main >= 1
+    if(num_no_gain >= patience)
+        printf("[RF][PR] no gain of the validation G-mean (best:%g) in the last %d levels\n", best_gmean, num_no_gain);
+#endif
+    return num_no_gain >= patience;
+}
@@ -23,8 +23,23 @@ public:
                 Mat& m_data_n, Mat& m_P_n, Vec& v_vol_n, Mat&m_WA_n,Mat& m_VD_p, Mat& m_VD_n,
                 solution& sol_coarser,int level, std::vector<ref_results>& v_ref_results);
 
+    /*
+     * trains the groups (the rows vv_p_index[i], vv_n_index[i] of each class) with the parameters of the coarser level
+     * and merges their SVs in umap_SV_alpha_p/n, the group i predicts the row i of m_predict_VD and m_predict_TD
+     * the groups are trained at the same time (ms_threads), each one writes only its own rows, SV maps and v_group_summary[i]
+     * (its selected model), hence the results don't depend on ms_threads
+     */
+    void train_groups(Mat& m_data_p, Vec& v_vol_p, Mat& m_data_n, Vec& v_vol_n, double param_C, double param_G, int level,
+                      std::vector<std::vector<PetscInt>>& vv_p_index, std::vector<std::vector<PetscInt>>& vv_n_index,
+                      Mat& m_avg_centers, BufferPool& buffer_pool,
+                      Mat& m_VD_p, Mat& m_VD_n, Mat& m_VD_both, Mat& m_predict_VD, Mat& m_TD, Mat& m_predict_TD,
+                      const std::vector<double>& v_init_alpha_p, const std::vector<double>& v_init_alpha_n,
+                      std::unordered_map<PetscInt,double>& umap_SV_alpha_p, std::unordered_map<PetscInt,double>& umap_SV_alpha_n,
+                      std::vector<summary>& v_group_summary);
+
     void find_SV_neighbors(Mat& m_data, Mat& m_P, std::vector<int>& seeds_ind, Mat& m_WA, Mat& m_neighbors,
-                                                                        std::string cc_name, IS& IS_neigh_id);
+                                                                        std::string cc_name, IS& IS_neigh_id,
+                                                                        const std::vector<double>& seeds_alpha, std::vector<double>& v_neigh_alpha);
 
 
     void process_coarsest_level(Mat& p_data, Vec& v_vol_p, Mat& n_data, Vec& v_vol_n, Mat& m_VD_p, Mat& m_VD_n, int level,
@@ -32,6 +47,11 @@ public:
 
     void prepare_single_solution(svm_model **svm_trained_model, int num_row_p, solution& result_solution);
     void add_best_model(std::vector<ref_results>& v_ref_results) const;
+    /*
+     * true if the last rf_patience refined levels didn't improve the best validation G-mean by more than rf_gm_tol,
+     * then the finer levels are skipped since add_best_model would select one of the refined levels anyway
+     */
+    static bool plateau_reached(const std::vector<ref_results>& v_ref_results);
 };
 
 
@@ -0,0 +1,200 @@
+#include "result_cache.h"
+#include "config_params.h"
+#include "dist_tasks.h"
+#include "prediction_set.h"
+#include <cstdlib>
+#include <cinttypes>
+
+ResultCache* ResultCache::instance = NULL;
+
+ResultCache* ResultCache::getInstance(){
+    if(!instance) instance = new ResultCache;
+    return instance;
+}
+
+
+bool ResultCache::enabled() const{
+    return !Config_params::getInstance()->get_ms_cache_file().empty();
+}
+
+
+uint64_t ResultCache::hash_bytes(const void * data, size_t num_bytes, uint64_t seed){
+    const unsigned char * bytes = (const unsigned char *) data;
+    uint64_t hash = seed;
+    for(size_t i=0; i < num_bytes; i++){
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;           // FNV prime
+    }
+    return hash;
+}
+
+
+uint64_t ResultCache::hash_mat(Mat& m_data, uint64_t seed){
+    PetscInt num_row, num_col, ncols;
+    const PetscInt * cols;
+    const PetscScalar * vals;
+    MatGetSize(m_data, &num_row, &num_col);
+    uint64_t hash = hash_bytes(&num_row, sizeof(num_row), seed);
+    hash = hash_bytes(&num_col, sizeof(num_col), hash);
+    for(PetscInt i=0; i < num_row; i++){
+        MatGetRow(m_data, i, &ncols, &cols, &vals);
+        hash = hash_bytes(&ncols, sizeof(ncols), hash);
+        hash = hash_bytes(cols, ncols * sizeof(PetscInt), hash);
+        hash = hash_bytes(vals, ncols * sizeof(PetscScalar), hash);
+        MatRestoreRow(m_data, i, &ncols, &cols, &vals);
+    }
+    return hash;
+}
+
+
+uint64_t ResultCache::hash_vec(Vec& v_data, uint64_t seed){
+    PetscInt num_elem;
+    PetscScalar * arr;
+    VecGetSize(v_data, &num_elem);
+    VecGetArray(v_data, &arr);
+    uint64_t hash = hash_bytes(&num_elem, sizeof(num_elem), seed);
+    hash = hash_bytes(arr, num_elem * sizeof(PetscScalar), hash);
+    VecRestoreArray(v_data, &arr);
+    return hash;
+}
+
+
+uint64_t ResultCache::hash_mat_rows(Mat& m_data, const std::vector<PetscInt>& v_index, PetscInt num, uint64_t seed){
+    PetscInt num_col, ncols;
+    const PetscInt * cols;
+    const PetscScalar * vals;
+    MatGetSize(m_data, NULL, &num_col);
+    uint64_t hash = hash_bytes(&num, sizeof(num), seed);
+    hash = hash_bytes(&num_col, sizeof(num_col), hash);
+    for(PetscInt i=0; i < num; i++){
+        MatGetRow(m_data, v_index[i], &ncols, &cols, &vals);
+        hash = hash_bytes(&ncols, sizeof(ncols), hash);
+        hash = hash_bytes(cols, ncols * sizeof(PetscInt), hash);
+        hash = hash_bytes(vals, ncols * sizeof(PetscScalar), hash);
+        MatRestoreRow(m_data, v_index[i], &ncols, &cols, &vals);
+    }
+    return hash;
+}
+
+
+uint64_t ResultCache::hash_vec_entries(Vec& v_data, const std::vector<PetscInt>& v_index, PetscInt num, uint64_t seed){
+    PetscScalar * arr;
+    VecGetArray(v_data, &arr);
+    uint64_t hash = hash_bytes(&num, sizeof(num), seed);
+    for(PetscInt i=0; i < num; i++)
+        hash = hash_bytes(&arr[v_index[i]], sizeof(PetscScalar), hash);
+    VecRestoreArray(v_data, &arr);
+    return hash;
+}
+
+
+uint64_t ResultCache::fingerprint(Mat& m_data_p, Vec& v_vol_p, Mat& m_data_n, Vec& v_vol_n, const PredictionSet& vd_set){
+    uint64_t hash = 14695981039346656037ULL;   // FNV offset basis
+    hash = hash_mat(m_data_p, hash);
+    hash = hash_vec(v_vol_p, hash);
+    hash = hash_mat(m_data_n, hash);
+    hash = hash_vec(v_vol_n, hash);
+    uint64_t vd_fp = vd_set.fingerprint();
+    return hash_bytes(&vd_fp, sizeof(vd_fp), hash);
+}
+
+
+uint64_t ResultCache::fingerprint(Mat& m_data_p, Vec& v_vol_p, const std::vector<PetscInt>& v_p_index, PetscInt num_p,
+                                  Mat& m_data_n, Vec& v_vol_n, const std::vector<PetscInt>& v_n_index, PetscInt num_n,
+                                  const PredictionSet& vd_set){
+    uint64_t hash = 14695981039346656037ULL;   // FNV offset basis
+    hash = hash_mat_rows(m_data_p, v_p_index, num_p, hash);
+    hash = hash_vec_entries(v_vol_p, v_p_index, num_p, hash);
+    hash = hash_mat_rows(m_data_n, v_n_index, num_n, hash);
+    hash = hash_vec_entries(v_vol_n, v_n_index, num_n, hash);
+    uint64_t vd_fp = vd_set.fingerprint();
+    return hash_bytes(&vd_fp, sizeof(vd_fp), hash);
+}
+
+
+uint64_t ResultCache::key(uint64_t data_fp, double param_C, double param_G) const{
+    // the parameters which change the model or its prediction of the validation data
+    Config_params * cp = Config_params::getInstance();
+    int int_params[] = {cp->get_svm_svm_type(), cp->get_svm_kernel_type(), cp->get_svm_degree(),
+                        cp->get_svm_shrinking(), (int) cp->get_svm_mixed_precision(),
+                        cp->get_ms_svm_id(), cp->get_rf_weight_vol(), (int) cp->get_ms_warm_start()};
+    double double_params[] = {param_C, param_G, cp->get_svm_coef0(), cp->get_svm_eps()};
+    uint64_t hash = hash_bytes(int_params, sizeof(int_params), data_fp);
+    return hash_bytes(double_params, sizeof(double_params), hash);
+}
+
+
+void ResultCache::init(){
+    std::lock_guard<std::mutex> lock(mtx_);
+    if(file_ != NULL){
+        fclose(file_);
+        file_ = NULL;
+    }
+    umap_results_.clear();
+    loaded_ = true;
+    if(!enabled())
+        return;
+    const std::string& f_name = Config_params::getInstance()->get_ms_cache_file();
+    FILE * in_file = fopen(f_name.c_str(), "r");
+    if(in_file != NULL){        // a line per result: key, C, gamma, nSV+, nSV-, the number of measures and the (measure, value) pairs
+        uint64_t result_key;
+        summary result_summary;
+        int num_perf;
+        while(fscanf(in_file, "%" SCNx64 " %lf %lf %d %d %d", &result_key, &result_summary.C, &result_summary.gamma,
+                     &result_summary.num_SV_p, &result_summary.num_SV_n, &num_perf) == 6){
+            result_summary.perf.clear();
+            int measure;
+            double value;
+            for(int i=0; i < num_perf && fscanf(in_file, "%d %lf", &measure, &value) == 2; i++)
+                result_summary.perf[(measures) measure] = value;
+            umap_results_[result_key] = result_summary;
+        }
+        fclose(in_file);
+        printf("[RC] %lu results are loaded from %s\n", umap_results_.size(), f_name.c_str());
+    }
+    DistTasks::barrier();           // the root appends only after all the ranks read the same file
+    if(!DistTasks::is_root())       // the ranks add the same results (see DistTasks), only the first one writes them
+        return;
+    file_ = fopen(f_name.c_str(), "a");
+    if(file_ == NULL){
+        fprintf(stderr, "[RC] the result cache file %s can't be opened, Exit!\n", f_name.c_str());
+        exit(1);
+    }
+}
+
+
+bool ResultCache::find(uint64_t data_fp, double param_C, double param_G, summary& result_summary){
+    if(!enabled())
+        return false;
+    std::lock_guard<std::mutex> lock(mtx_);
+    if(!loaded_){
+        fprintf(stderr, "[RC] the result cache is used before ResultCache::init, Exit!\n");
+        exit(1);
+    }
+    std::unordered_map<uint64_t, summary>::const_iterator it = umap_results_.find(key(data_fp, param_C, param_G));
+    if(it == umap_results_.end())
+        return false;
+    result_summary = it->second;
+    result_summary.telemetry = train_telemetry();
+    return true;
+}
+
+
+void ResultCache::add(uint64_t data_fp, const summary& result_summary){
+    if(!enabled())
+        return;
+    std::lock_guard<std::mutex> lock(mtx_);
+    if(!loaded_){
+        fprintf(stderr, "[RC] the result cache is used before ResultCache::init, Exit!\n");
+        exit(1);
+    }
+    uint64_t result_key = key(data_fp, result_summary.C, result_summary.gamma);
+    if(!umap_results_.insert(std::make_pair(result_key, result_summary)).second || file_ == NULL)
+        return;                 // e.g. the selected candidate is trained again
+    fprintf(file_, "%016" PRIx64 " %.17g %.17g %d %d %lu", result_key, result_summary.C, result_summary.gamma,
+            result_summary.num_SV_p, result_summary.num_SV_n, result_summary.perf.size());
+    for(std::map<measures,double>::const_iterator it = result_summary.perf.begin(); it != result_summary.perf.end(); ++it)
+        fprintf(file_, " %d %.17g", (int) it->first, it->second);
+    fprintf(file_, "\n");
+    fflush(file_);              // keep the results of an interrupted run
+}
@@ -0,0 +1,62 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include "ds_global.h"
+#include <petscmat.h>
+#include <cstdio>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class PredictionSet;
+
+/*
+ * persistent results of the model selection trainings (ms_cache_file parameter, empty disables)
+ * the key is the fingerprint of the data (training rows, volumes and validation data) with C, gamma and
+ * the other parameters which change the model, the value is the summary on the validation data
+ * the validation data is hashed once per V-cycle (see PredictionSet::fingerprint), a partition group hashes only its rows
+ * the models are not kept, the caller trains the selected candidate again if its summary came from the cache
+ * each result is appended to the file when it is added, hence an interrupted run keeps the finished trainings
+ * the results are added after each batch of candidates, hence they come from all the ranks (see DistTasks)
+ * the file is loaded by init at the start of the program, all the ranks read it before the root appends to it,
+ * hence they find the same results and stay in step
+ */
+class ResultCache{
+public:
+    static ResultCache* getInstance();
+
+    bool enabled() const;
+    // (re)load the results of ms_cache_file, before any training (all the ranks call it, it waits for all of them)
+    void init();
+
+    // FNV-1a of the bytes, continues from seed (the fingerprints are chained by the seed)
+    static uint64_t hash_bytes(const void * data, size_t num_bytes, uint64_t seed);
+    // fingerprint of the training and validation data, the caller holds the PETSc lock if it is in a task
+    static uint64_t fingerprint(Mat& m_data_p, Vec& v_vol_p, Mat& m_data_n, Vec& v_vol_n, const PredictionSet& vd_set);
+    // the same for the first num_p (num_n) rows of v_p_index (v_n_index), e.g. a partition group (same lock)
+    static uint64_t fingerprint(Mat& m_data_p, Vec& v_vol_p, const std::vector<PetscInt>& v_p_index, PetscInt num_p,
+                                Mat& m_data_n, Vec& v_vol_n, const std::vector<PetscInt>& v_n_index, PetscInt num_n,
+                                const PredictionSet& vd_set);
+
+    // the summary is set if the candidate is in the cache (its telemetry is empty, no training)
+    bool find(uint64_t data_fp, double param_C, double param_G, summary& result_summary);
+    void add(uint64_t data_fp, const summary& result_summary);
+
+private:
+    ResultCache(){}
+    static ResultCache* instance;
+    std::mutex mtx_;
+    bool loaded_ = false;                           // see init
+    FILE * file_ = NULL;
+    std::unordered_map<uint64_t, summary> umap_results_;
+
+    static uint64_t hash_mat(Mat& m_data, uint64_t seed);
+    static uint64_t hash_vec(Vec& v_data, uint64_t seed);
+    // only the rows (entries) in v_index[0..num)
+    static uint64_t hash_mat_rows(Mat& m_data, const std::vector<PetscInt>& v_index, PetscInt num, uint64_t seed);
+    static uint64_t hash_vec_entries(Vec& v_data, const std::vector<PetscInt>& v_index, PetscInt num, uint64_t seed);
+    uint64_t key(uint64_t data_fp, double param_C, double param_G) const;
+};
+
+#endif // RESULT_CACHE_H
@@ -0,0 +1,136 @@
+#include "rff_approx.h"
+#include "prediction_set.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+RffApproximation::RffApproximation(int dim, int num_features, unsigned int seed)
+    : dim_(dim), num_features_(num_features){
+    if(dim_ < 1){
+        fprintf(stderr, "[RFF] the number of random features should be positive, dim:%d, Exit!\n", dim_);
+        exit(1);
+    }
+    std::mt19937 gen(seed);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    std::uniform_real_distribution<double> uniform(0.0, 2 * M_PI);
+    v_phase_.resize(dim_);
+    for(int d=0; d < dim_; d++)
+        v_phase_[d] = uniform(gen);
+    v_dir_.resize((size_t)(num_features_ + 1) * dim_);      // feature indices start from 1, the row 0 is not used
+    for(size_t j=0; j < v_dir_.size(); j++)
+        v_dir_[j] = normal(gen);
+}
+
+
+void RffApproximation::project(const svm_node * x, double * proj) const{
+    std::fill(proj, proj + dim_, 0);
+    for(; x->index != -1; ++x){
+        if(x->index < 1 || x->index > num_features_)    // never seen in the training, no direction is defined
+            continue;
+        const double * dir = &v_dir_[(size_t)x->index * dim_];
+        const double value = x->value;
+        for(int d=0; d < dim_; d++)
+            proj[d] += value * dir[d];
+    }
+}
+
+
+int RffApproximation::add_model(const svm_model * model){
+    if(model->param.kernel_type != RBF || model->nr_class != 2 ||
+            (model->param.svm_type != C_SVC && model->param.svm_type != NU_SVC)){
+        fprintf(stderr, "[RFF][AM] only the binary RBF classifiers can be approximated, Exit!\n");
+        exit(1);
+    }
+    double scale = sqrt(2 * model->param.gamma);
+    size_t offset = v_beta_.size();
+    v_beta_.resize(offset + dim_, 0);
+    double * beta = &v_beta_[offset];
+    std::vector<double> v_proj(dim_);
+    for(int i=0; i < model->l; i++){
+        project(model->SV[i], v_proj.data());
+        double coef = model->sv_coef[0][i];
+        for(int d=0; d < dim_; d++)
+            beta[d] += coef * cos(scale * v_proj[d] + v_phase_[d]);
+    }
+    for(int d=0; d < dim_; d++)         // sqrt(2/D) of phi(SV) and phi(x)
+        beta[d] *= 2.0 / dim_;
+    v_scale_.push_back(scale);
+    v_rho_.push_back(model->rho[0]);
+    v_label_pos_.push_back(model->label[0]);
+    v_label_neg_.push_back(model->label[1]);
+    return v_rho_.size() - 1;
+}
+
+
+double RffApproximation::decision_value(const double * proj, int model_id) const{
+    const double * beta = &v_beta_[(size_t)model_id * dim_];
+    const double scale = v_scale_[model_id];
+    double sum = 0;
+    for(int d=0; d < dim_; d++)
+        sum += beta[d] * cos(scale * proj[d] + v_phase_[d]);
+    return sum - v_rho_[model_id];
+}
+
+
+double RffApproximation::predict_values(const svm_node * x, int model_id, double * dec_value) const{
+    std::vector<double> v_proj(dim_);
+    project(x, v_proj.data());
+    *dec_value = decision_value(v_proj.data(), model_id);
+    return (*dec_value > 0) ? v_label_pos_[model_id] : v_label_neg_[model_id];
+}
+
+
+void RffApproximation::predict_all(const svm_node * x, double * labels, double * dec_values) const{
+    std::vector<double> v_proj(dim_);
+    project(x, v_proj.data());
+    for(int m=0; m < get_num_models(); m++){
+        double dec_value = decision_value(v_proj.data(), m);
+        labels[m] = (dec_value > 0) ? v_label_pos_[m] : v_label_neg_[m];
+        if(dec_values != NULL)
+            dec_values[m] = dec_value;
+    }
+}
+
+
+double RffApproximation::predict(const svm_node * x, int model_id) const{
+    double dec_value;
+    return predict_values(x, model_id, &dec_value);
+}
+
+
+double RffApproximation::agreement(const svm_model * exact_model, int model_id, const PredictionSet& data, int max_points,
+                                   unsigned int seed) const{
+    int num_points = data.size();
+    if(num_points == 0 || max_points < 1)
+        return 1;
+    std::vector<int> v_idx(num_points);
+    for(int i=0; i < num_points; i++)
+        v_idx[i] = i;
+    int num_sample = std::min(num_points, max_points);
+    if(num_sample < num_points){            // the first num_sample of a partial shuffle
+        std::mt19937 gen(seed);
+        for(int i=0; i < num_sample; i++){
+            std::uniform_int_distribution<int> pick(i, num_points - 1);
+            std::swap(v_idx[i], v_idx[pick(gen)]);
+        }
+    }
+    int num_agree = 0;
+    for(int i=0; i < num_sample; i++){
+        const svm_node * x = data.row(v_idx[i]);
+        if(svm_predict(exact_model, x) == predict(x, model_id))
+            ++num_agree;
+    }
+    return (double) num_agree / num_sample;
+}
+
+
+int RffApproximation::num_features(const svm_model * model, const PredictionSet& data){
+    int max_index = 0;
+    for(int i=0; i < model->l; i++)
+        for(const svm_node * px = model->SV[i]; px->index != -1; ++px)
+            max_index = std::max(max_index, px->index);
+    for(int i=0; i < data.size(); i++)
+        for(const svm_node * px = data.row(i); px->index != -1; ++px)
+            max_index = std::max(max_index, px->index);
+    return max_index;
+}
@@ -0,0 +1,69 @@
+#ifndef RFF_APPROX_H
+#define RFF_APPROX_H
+
+#include "solver.h"
+#include <vector>
+
+class PredictionSet;
+
+/*
+ * Random Fourier feature approximation of the RBF models
+ * k(x,z) = exp(-gamma |x-z|^2) ~ phi(x).phi(z), phi_d(x) = sqrt(2/D) cos(sqrt(2 gamma) r_d.x + b_d)
+ * where r_d ~ N(0,I) and b_d ~ U[0,2pi], hence a model collapses to beta = sum(sv_coef_i phi(SV_i))
+ * and the decision value is beta.phi(x) - rho, the cost per point is O(D nnz) instead of O(nSV nnz)
+ * the random directions don't depend on gamma, so the models of a partition ensemble share one projection r.x
+ * and each extra model costs only O(D)
+ * only the binary RBF models are supported
+ */
+class RffApproximation{
+public:
+    /*
+     * dim is the number of random features (D), num_features is the largest feature index of the data
+     * the same seed produces the same approximation (e.g. in training and in the prediction tool),
+     * the directions of the common features don't depend on num_features
+     */
+    RffApproximation(int dim, int num_features, unsigned int seed = 2018);
+
+    // compile the model and return its id in the ensemble
+    int add_model(const svm_model * model);
+    int get_num_models() const { return v_rho_.size(); }
+    int get_dim() const { return dim_; }
+
+    // decision value and label of a model, x ends with index -1 (same as libsvm)
+    double predict_values(const svm_node * x, int model_id, double * dec_value) const;
+    double predict(const svm_node * x, int model_id = 0) const;
+    /*
+     * labels (and decision values if dec_values is not NULL) of all the models, x is projected once
+     * and each model costs O(D), the arrays have get_num_models() elements
+     * the approximation is read only after the models are added, hence the threads can predict at the same time
+     */
+    void predict_all(const svm_node * x, double * labels, double * dec_values = NULL) const;
+
+    /*
+     * fraction of a random sample of max_points rows of data (all the rows if it is smaller) that get the same label
+     * from the exact model and the approximation of model_id, the exact model is evaluated on each sampled row
+     * the same seed samples the same rows, data is read only (no PETSc calls)
+     */
+    double agreement(const svm_model * exact_model, int model_id, const PredictionSet& data, int max_points,
+                     unsigned int seed = 2018) const;
+
+    // the largest feature index of the SVs of the model and the rows of data, the approximation of these features is exact
+    static int num_features(const svm_model * model, const PredictionSet& data);
+
+private:
+    int dim_;
+    int num_features_;
+    std::vector<double> v_dir_;         // r_d for all the features, [feature][d] (sparse x reads a row per nonzero)
+    std::vector<double> v_phase_;       // b_d
+    std::vector<double> v_scale_;       // sqrt(2 gamma) of each model
+    std::vector<double> v_rho_;
+    std::vector<double> v_beta_;        // [model][d], the 2/D of both features is included
+    std::vector<int> v_label_pos_;      // label for decision value > 0
+    std::vector<int> v_label_neg_;
+
+    // r.x in proj (dim_ elements)
+    void project(const svm_node * x, double * proj) const;
+    double decision_value(const double * proj, int model_id) const;
+};
+
+#endif // RFF_APPROX_H
@@ -1,10 +1,17 @@
 #include "solver.h"
+#include "model_binary.h"
+#include "rff_approx.h"
+#include "buffer_pool.h"
+#include "training_problem.h"
+#include "task_pool.h"
+#include "prediction_set.h"
 #include "config_logs.h"
 #include "loader.h"
 #include <algorithm>    // std::random_shuffle
+#include <numeric>
 
 
-struct svm_node *x;
+thread_local struct svm_node *x;        // row buffer of the predictions, the candidates may run at the same time
 
 
 //======================================================================
@@ -14,9 +21,158 @@ void Solver::free_solver(std::string caller_name){
 #endif
     svm_free_and_destroy_model(&local_model);
     svm_destroy_param(&param);
-    free(prob.y);
-    free(prob.x);
-    free(x_space);
+    if(training_problem_){          // the arrays belong to the training problem
+        training_problem_.reset();
+    }else{
+        free_buffer(prob.y);
+        free_buffer(prob.x);
+        free_buffer(prob.W);
+        free_buffer(x_space);
+    }
+    prob.y = NULL;
+    prob.x = NULL;
+    prob.W = NULL;
+    x_space = NULL;
+}
+
+
+template<typename T> T * Solver::alloc_buffer(size_t num_elements){
+    if(buffer_pool_ != NULL)
+        return buffer_pool_->acquire_array<T>(num_elements);
+    return Malloc(T, num_elements);
+}
+
+void Solver::free_buffer(void * ptr){
+    if(buffer_pool_ != NULL)
+        buffer_pool_->release(ptr);
+    else
+        free(ptr);
+}
+
+
+/*
+ * alphas of the trained model for all the points in the training problem (zero for non SVs)
+ * the order is the same as the rows of the problem which is required by set_warm_start
+ */
+void Solver::get_alphas(std::vector<double>& v_alpha) const{
+    v_alpha.assign(prob.l, 0);
+    for(int i=0; i < local_model->l; i++){
+        v_alpha[local_model->sv_indices[i] - 1] = fabs(local_model->sv_coef[0][i]);
+    }
+}
+
+
+void Solver::get_model_values(std::vector<double>& v_values) const{
+    v_values.clear();
+    if(local_model == NULL)
+        return;
+    v_values.resize(svm_model_values_size(local_model));
+    svm_get_model_values(local_model, v_values.data());
+}
+
+
+/*
+ * retrain the problem in double precision and compare it with the mixed precision model
+ * the agreement is the fraction of the training points with the same predicted label
+ */
+static void check_mixed_precision_agreement(const svm_problem& prob, const svm_parameter& param, const svm_model * mp_model){
+    svm_model * dp_model = svm_train(&prob, &param);        // double precision (the precision is set per training)
+
+    int num_agree = 0;
+    double max_diff = 0;
+    double dv_mp, dv_dp;
+    for(int i=0; i < prob.l; i++){
+        double label_mp = svm_predict_values(mp_model, prob.x[i], &dv_mp);
+        double label_dp = svm_predict_values(dp_model, prob.x[i], &dv_dp);
+        if(label_mp == label_dp)
+            num_agree++;
+        max_diff = std::max(max_diff, fabs(dv_mp - dv_dp));
+    }
+    std::cout << "[SV][MP] mixed precision agreement:" << (double) num_agree / prob.l <<
+                 ", max decision value diff:" << max_diff <<
+                 ", nSV float:" << mp_model->l << ", nSV double:" << dp_model->l <<
+                 ", rho float:" << mp_model->rho[0] << ", rho double:" << dp_model->rho[0] << std::endl;
+    svm_free_and_destroy_model(&dp_model);
+}
+
+
+/*
+ * the trainings without a warm start or shared rows, the kernels are in single precision if svm_mixed_precision is set
+ */
+static svm_model * train_plain(const svm_problem& prob, const svm_parameter& param){
+    svm_train_context ctx = svm_train_context();        // zero
+    ctx.single_precision = Config_params::getInstance()->get_svm_mixed_precision();
+    return svm_train_with_context(&prob, &param, &ctx);
+}
+
+
+/*
+ * train with the warm start alphas if they are set and enabled, otherwise start from zero
+ * the model of v_model_values is taken instead of the training if it is not empty (no statistics)
+ * the kernel rows are shared through the kernel_cache if it is set
+ * the float rows of the mixed precision kernels are shared through single_rows if it is set (built per training otherwise)
+ * the statistics of the solver are set in telemetry (the build time is left to the caller)
+ */
+static svm_model * train_with_optional_warm_start(const svm_problem& prob, const svm_parameter& param,
+                                                  const std::vector<double>& v_warm_alpha,
+                                                  const std::vector<double>& v_model_values,
+                                                  svm_kernel_cache * kernel_cache,
+                                                  const std::vector<int>& v_point_ids,
+                                                  const svm_single_rows * single_rows,
+                                                  svm_cache_stats& cache_stats,
+                                                  train_telemetry& telemetry){
+    ETimer t_solve;
+    svm_train_context ctx;
+    ctx.init_alpha = NULL;
+    ctx.kernel_cache = kernel_cache;
+    ctx.point_ids = NULL;
+    ctx.single_precision = Config_params::getInstance()->get_svm_mixed_precision();
+    ctx.single_rows = single_rows;
+    cache_stats = svm_cache_stats();        // zero
+    ctx.cache_stats = &cache_stats;
+    svm_solver_stats solver_stats = svm_solver_stats();
+    ctx.solver_stats = &solver_stats;
+    if(Config_params::getInstance()->get_ms_warm_start() && v_warm_alpha.size() == (unsigned long) prob.l){
+#if dbl_SV_TM >= 1
+        std::cout << "[SV][TM] warm start from the initial alphas, l:" << prob.l << std::endl;
+#endif
+        ctx.init_alpha = v_warm_alpha.data();
+    }
+    if(kernel_cache != NULL && !v_point_ids.empty()){
+        if(v_point_ids.size() == (unsigned long) prob.l)
+            ctx.point_ids = v_point_ids.data();
+        else            // the ids don't describe this problem, don't risk mixing the rows
+            ctx.kernel_cache = NULL;
+    }
+    svm_model * model;
+    telemetry = train_telemetry();
+    if(!v_model_values.empty()){
+        model = svm_model_from_values(&prob, &param, v_model_values.data(), v_model_values.size());
+        if(model == NULL){
+            fprintf(stderr, "[SV][TM] the received model doesn't match the training problem (l:%d), Exit!\n", prob.l);
+            exit(1);
+        }
+    }else{
+        model = svm_train_with_context(&prob, &param, &ctx);
+        telemetry.num_trainings = 1;
+    }
+    telemetry.iterations = solver_stats.iterations;
+    telemetry.kernel_evals = cache_stats.kernel_evals;
+    telemetry.cache_hits = cache_stats.hits;
+    telemetry.cache_misses = cache_stats.misses;
+    telemetry.shrink_rounds = solver_stats.shrink_rounds;
+    telemetry.reconstructions = solver_stats.reconstructions;
+    telemetry.max_iter_reached = solver_stats.max_iter_reached;
+    telemetry.solve_time = t_solve.get_elapsed();
+    if(Config_params::getInstance()->get_svm_linear_weights())
+        svm_build_linear_weights(model);        // nothing for the non-linear kernels
+    if(Config_params::getInstance()->get_svm_early_exit())
+        svm_build_early_exit(model);            // nothing for the non-RBF kernels
+#if dbl_SV_MP >= 1
+    if(Config_params::getInstance()->get_svm_mixed_precision())
+        check_mixed_precision_agreement(prob, param, model);
+#endif
+    return model;
 }
 
 
@@ -58,7 +214,12 @@ svm_model * Solver::train_model(Mat& m_data_p, Vec& v_vol_p, Mat& m_data_n, Vec&
     }while(error_msg);                                                       // now prob and param are loaded and checked
 //    std::cout << "[SV][TM] after read parameters:"<< "\n";
 
-    read_problem(m_data_p, v_vol_p, m_data_n,v_vol_n);
+    ETimer t_build;
+    {
+        std::lock_guard<std::mutex> petsc_lock(TaskPool::petsc_mutex());
+        read_problem(m_data_p, v_vol_p, m_data_n,v_vol_n);
+    }
+    double build_time = t_build.get_elapsed();
 
 #if weight_instance == 0    // without instance weight support
     if(Config_params::getInstance()->get_ms_svm_id()==2){                   //Weighted SVM
@@ -76,10 +237,14 @@ svm_model * Solver::train_model(Mat& m_data_p, Vec& v_vol_p, Mat& m_data_n, Vec&
     param.nr_weight=0;
 #endif
 
-    local_model = svm_train(&prob,&param);
+    local_model = train_with_optional_warm_start(prob, param, v_warm_alpha_, v_model_values_, kernel_cache_, v_point_ids_, NULL,
+                                                 cache_stats_, telemetry_);
+    telemetry_.build_time = build_time;
 
 #if dbl_SV_TM >= 1
     std::cout << "[SV][TM] param C:"<< local_model->param.C <<", gamma:" << local_model->param.gamma << std::endl;
+    std::cout << "[SV][TM] kernel cache hits:" << cache_stats_.hits << ", misses:" << cache_stats_.misses <<
+                 ", evictions:" << cache_stats_.evictions << ", bytes:" << cache_stats_.bytes << std::endl;
 #endif
 
 #if dbl_SV_TM_report_time == 1
@@ -115,12 +280,14 @@ svm_model * Solver::train_model_index_base(Mat& m_data_p, Vec& v_vol_p, Mat& m_d
         exit(1);
     }                                                       // now prob and param are loaded and checked
 
+    ETimer t_build;
     read_problem_index_base(m_data_p, m_data_n, v_p_index, v_n_index, iter_p_end, iter_n_end,v_vol_p, v_vol_n );
+    double build_time = t_build.get_elapsed();      // zero for a shared problem, its owner adds the time
 
 #if weight_instance == 0    // without instance weight support
     if(Config_params::getInstance()->get_ms_svm_id()==2){                   //Weighted SVM
         alloc_memory_for_weights(param, 0);     // 0 means don't free old memory and it makes sense because this is the first time
-        set_weights_sum_volume_index_base(param, v_vol_p, v_vol_n, v_p_index, v_n_index, iter_p_end, iter_n_end);
+        set_weights_sum_volume_index_base(param);
     }else{
         param.weight = NULL;
         param.weight_label=NULL;
@@ -133,9 +300,13 @@ svm_model * Solver::train_model_index_base(Mat& m_data_p, Vec& v_vol_p, Mat& m_d
 #endif
 
 
-    local_model = svm_train(&prob,&param);
+    local_model = train_with_optional_warm_start(prob, param, v_warm_alpha_, v_model_values_, kernel_cache_, v_point_ids_,
+                                                 training_problem_->get_single_rows(), cache_stats_, telemetry_);
+    telemetry_.build_time = build_time;
 #if dbl_SV_TM >= 1
     std::cout << "[SV][TMIB] param C:"<< local_model->param.C <<", gamma:" << local_model->param.gamma << std::endl;
+    std::cout << "[SV][TMIB] kernel cache hits:" << cache_stats_.hits << ", misses:" << cache_stats_.misses <<
+                 ", evictions:" << cache_stats_.evictions << ", bytes:" << cache_stats_.bytes << std::endl;
 #endif
 #if dbl_SV_TM_report_time == 1
     t_sv_tm.stop_timer("train model index base");
@@ -146,6 +317,53 @@ svm_model * Solver::train_model_index_base(Mat& m_data_p, Vec& v_vol_p, Mat& m_d
 
 
 
+svm_model * Solver::train_model_shared_problem(double param_c, double param_gamma){
+    if(!training_problem_){
+        fprintf(stderr,"[SV][TMSP] ERROR: no training problem is set, Exit!\n");
+        exit(1);
+    }
+    read_parameters();
+    this->param.C = param_c;
+    this->param.gamma = param_gamma;
+    prob = training_problem_->get_problem();
+    x_space = NULL;
+
+    const char *error_msg;                                  //check parameters
+    error_msg = svm_check_parameter(&prob,&param);
+    if(error_msg) {
+        fprintf(stderr,"[SV][TMSP] ERROR: %s\n",error_msg);
+        print_parameters();
+        exit(1);
+    }
+
+#if weight_instance == 0    // without instance weight support
+    if(Config_params::getInstance()->get_ms_svm_id()==2){                   //Weighted SVM
+        alloc_memory_for_weights(param, 0);
+        set_weights_sum_volume_index_base(param);
+    }else{
+        param.weight = NULL;
+        param.weight_label=NULL;
+        param.nr_weight=0;
+    }
+#else
+    param.weight = NULL;
+    param.weight_label=NULL;
+    param.nr_weight=0;
+#endif
+
+    local_model = train_with_optional_warm_start(prob, param, v_warm_alpha_, v_model_values_, kernel_cache_, v_point_ids_,
+                                                 training_problem_->get_single_rows(), cache_stats_, telemetry_);
+    telemetry_.build_time = 0;          // the owner of the problem adds the time
+#if dbl_SV_TM >= 1
+    std::cout << "[SV][TMSP] param C:"<< local_model->param.C <<", gamma:" << local_model->param.gamma <<
+                 ", eps:" << local_model->param.eps << ", l:" << prob.l << std::endl;
+#endif
+    return local_model;
+}
+
+
+
+
 void Solver::stand_alone_train_without_instance_weight(Mat& m_data_p, Mat& m_data_n, std::string model_fname){
     ETimer t_sv_sat;
     // - - - - - get dimensions - - - - -
@@ -190,7 +408,7 @@ void Solver::stand_alone_train_without_instance_weight(Mat& m_data_p, Mat& m_dat
         }
     #endif
 
-    local_model = svm_train(&prob,&param);
+    local_model = train_plain(prob, param);
     solution tmp_sol;
     prepare_solution_single_model(local_model, p_num_row_, tmp_sol);
 
@@ -231,7 +449,7 @@ void Solver::stand_alone_train_instance_weight(Mat& m_data_p , Vec& v_vol_p, Mat
 
 
 
-    local_model = svm_train(&prob,&param);
+    local_model = train_plain(prob, param);
     solution tmp_sol;
     prepare_solution_single_model(local_model, p_num_row_, tmp_sol);
 
@@ -285,7 +503,7 @@ void Solver::PD_train_model_index_base(Mat& m_data, std::vector<int>& v_target_l
         param.nr_weight=0;
     }
 
-    local_model = svm_train(&prob,&param);
+    local_model = train_plain(prob, param);
     svm_save_model("./debug/single_level.model",local_model);
 
 #if dbl_SV_PDTMIB >= 1
@@ -336,7 +554,7 @@ void Solver::partial_solver(Mat& p_data, Vec& v_vol_p, Mat& n_data, Vec& v_vol_n
 
         if(Config_params::getInstance()->get_rf_weight_vol()){      //based on volume
             //calc sum of volumes       //TODO
-            set_weights_sum_volume_index_base(param, v_vol_p, v_vol_n, v_p_index, v_n_index, v_p_index.size(), v_n_index.size());
+            set_weights_sum_volume_index_base(param);
         }else{                                                      //based on number of points
             set_weights_num_points(param, p_num_row_, n_num_row_);
         }
@@ -346,15 +564,20 @@ void Solver::partial_solver(Mat& p_data, Vec& v_vol_p, Mat& n_data, Vec& v_vol_n
         param.nr_weight=0;
     }
 
-    local_model = svm_train(&prob,&param);
+    local_model = train_plain(prob, param);
+    if(Config_params::getInstance()->get_svm_linear_weights())
+        svm_build_linear_weights(local_model);
+    if(Config_params::getInstance()->get_svm_early_exit())
+        svm_build_early_exit(local_model);
 //    t_sv_ps.stop_timer("[SV][PS] model training");
 
     /// - - - - - - - - predict the validation data - - - - - - - - -
     // this is used to check the quality of this classifier on the test data in the end,
     // as this method is called in the refinement with partitioning, the predicted labels
     // for validation data is stores in a related column of a prediction matrix to a group of partitions
-    predict_test_data_in_matrix_output(m_testdata, classifier_id, m_all_predict_TD);
-    predict_test_data_in_matrix_output(m_VD_both, classifier_id, m_all_predict_VD);     //added 021517-1920
+    std::shared_ptr<const PredictionSet> td_set = PredictionSet::test(Config_params::getInstance()->get_test_ds_f_name(), m_testdata);
+    predict_test_data_in_matrix_output(*td_set, classifier_id, m_all_predict_TD);
+    predict_VD_in_output_matrix(*PredictionSet::validation(m_VD_p, m_VD_n), classifier_id, m_all_predict_VD);     // the same rows as m_VD_both
 
 
 /// - - - - - - - - prepare the solution for refinement - - - - - - - - -
@@ -593,207 +816,25 @@ void Solver::combine_test_data(Mat& test_total, Mat& dt_test_p,
 
 
 //=========== read the training data using the vector of indices ============
+/*
+ * the problem is shared if the caller set it by set_training_problem, otherwise it is built for this Solver only
+ */
 void Solver::read_problem_index_base(Mat& m_train_data_p, Mat& m_train_data_n,
                                         std::vector<PetscInt>& v_p_index, std::vector<PetscInt>& v_n_index,
                                         PetscInt iter_p_end,PetscInt iter_n_end,
                                         Vec& v_vol_p, Vec& v_vol_n){
-#if dbl_SV_RPIB >= 3
-    printf("[SV][RPIB] DEBUG start Solver::read_problem_index_base\n");
-#endif
-    PetscInt i=0, j=0, l=0, k=0, ncols;
-    const PetscInt    *cols;                        //if not NULL, the column numbers
-    const PetscScalar *vals;
-    PetscInt num_col=0, num_total_nodes=0;  //num_row=0,
-    PetscInt p_num_node_=0, n_num_node_=0, num_elements_=0;
-
-    PetscScalar sum_all_vol_p=0, sum_all_vol_n=0;       //calculate the sum of all the volumes in each class of the current training set
-//    VecSum(v_vol_p, &sum_all_vol_p);
-//    VecSum(v_vol_n, &sum_all_vol_n);      // The sum of indices which are sent are important not all the points in the vector
-    PetscScalar     *arr_vol_p, *arr_vol_n;
-    PetscInt        max_num_p, max_num_n;
-    VecGetSize(v_vol_p, &max_num_p);
-    VecGetSize(v_vol_p, &max_num_p);
-
-    PetscMalloc1(max_num_p, &arr_vol_p);
-    PetscMalloc1(max_num_n, &arr_vol_n);
-
-    VecGetArray(v_vol_p,&arr_vol_p);                // the restore goes at the end of each class
-    VecGetArray(v_vol_n,&arr_vol_n);
-
-#if dbl_SV_RPIB >= 7
-    printf("[SV][RPIB] m_train_data_p matrix:\n");                   //$$debug
-    MatView(m_train_data_p, PETSC_VIEWER_STDOUT_WORLD);
-    printf("[SV][RPIB] m_train_data_n matrix:\n");                   //$$debug
-    MatView(m_train_data_n, PETSC_VIEWER_STDOUT_WORLD);
-#endif
-
-
-// - - - - - - find number of nodes and elements - - - - - - -
-    MatGetSize(m_train_data_p,NULL,&num_col);    // we need the number of columns
-    p_num_node_ = iter_p_end;
-    n_num_node_ = iter_n_end;
-
-    num_total_nodes = p_num_node_ + n_num_node_;
-#if dbl_SV_RPIB >= 1
-    printf("[SV][RPIB] number of P_data: %d, N_data: %d, total_nodes :%d \n",
-                               p_num_node_,n_num_node_,num_total_nodes);     //$$debug
-#endif
-//---- Count number of non zero elements -----
-    // for positive class
-    for (i=0; i< p_num_node_;i++){
-        MatGetRow(m_train_data_p, v_p_index[i],&ncols, &cols, &vals);                 // data points
-        num_elements_ += ncols + 1;     // +1 : for the end of line index
-        MatRestoreRow(m_train_data_p, v_p_index[i],&ncols, &cols, &vals);
-        sum_all_vol_p += arr_vol_p[v_p_index[i]];                                  // sum up the selected volumes
-    }
-#if dbl_SV_RPIB >= 3
-    printf("[SV][RPIB] number of p elems:%d\n",num_elements_);
-#endif
-    // for negative class
-    for (i=0; i< n_num_node_;i++){
-        MatGetRow(m_train_data_n, v_n_index[i],&ncols, &cols, &vals);
-        num_elements_ += ncols + 1;     // +1 : for the end of line index
-        MatRestoreRow(m_train_data_n, v_n_index[i],&ncols, &cols, &vals);
-        sum_all_vol_n += arr_vol_n[v_n_index[i]];                                   // sum up the selected volumes
-    }
-#if dbl_SV_RPIB >= 3
-    printf("[SV][RPIB] sum all vol p:%g \t sum all vol n:%g\n",sum_all_vol_p,sum_all_vol_n);                  //$$debug
-    #if dbl_SV_RPIB >= 5
-        printf("[SV][RPIB] total number of elems for both classes (one column as terminator [-1,0]):%d\n",num_elements_);
-    #endif
-#endif
-
-#if weight_instance == 1
-    PetscScalar        min_vol=0, max_vol=0;
-    PetscScalar        sq_inv_sum_vol_p=pow(1.0/sum_all_vol_p, 2);
-    PetscScalar        sq_inv_sum_vol_n=pow(1.0/sum_all_vol_n, 2);
-//        printf("[SV][RP] sq_inv_sum_vol_p:%.12f, sq_inv_sum_vol_n:%.12f\n",sq_inv_sum_vol_p,sq_inv_sum_vol_n);         //$$debug
-#endif
-
-
-
-//---- read the data to prob for libsvm -----
-    prob.y = Malloc(double, num_total_nodes );
-
-    #if weight_instance == 1
-        prob.W = Malloc(double, num_total_nodes );
-    #endif
-
-    prob.x = Malloc(struct svm_node *, num_total_nodes );
-    x_space = Malloc(struct svm_node, num_elements_ );
-
-#if dbl_SV_RPIB >= 3
-    printf("[SV][RPIB] After Malloc svm objects\n");
-#endif
-
-    // - - - - set the problem from the data and volume - - - -
-    prob.l = num_total_nodes;
-    // - - - - - read positive data - - - - -
-    j=0;                //set the j as an index to go through the x_space
-    for (i=0; i< p_num_node_;i++){
-        unsigned long ul_target_index = v_p_index[i];
-        prob.y[i] = 1;
-
-        #if weight_instance == 1
-            prob.W[i] = arr_vol_p[ul_target_index] * sq_inv_sum_vol_p;      ///* instance weight */
-            if(prob.W[i] < min_vol)
-                min_vol = prob.W[i];    //store the min
-            if(prob.W[i] > max_vol)
-                max_vol = prob.W[i];    //store the max
-//            printf("(%.4f,%.4f),",arr_vol_p[ul_target_index],prob.W[i]);                  //$$debug
-        #endif
-
-        prob.x[i] = &x_space[j];
-        MatGetRow(m_train_data_p, ul_target_index,&ncols, &cols, &vals);
-        l=0;
-#if dbl_SV_RPIB >= 3
-        if(ncols == 0){
-            printf("[SV][RPIB]  *** Error *** Empty row at %d row in m_train_data_p! Exit\n",i);
+    if(training_problem_){
+        if(training_problem_->get_num_p() != iter_p_end || training_problem_->get_num_n() != iter_n_end){
+            fprintf(stderr,"[SV][RPIB] the shared training problem (P:%d, N:%d) doesn't match the requested one (P:%d, N:%d), Exit!\n",
+                    training_problem_->get_num_p(), training_problem_->get_num_n(), iter_p_end, iter_n_end);
             exit(1);
         }
-#endif
-        for (k=0; k< num_col; k++) {    //note this is num_col instead of ncols because of j increament
-            if(k == cols[l])
-            {
-                x_space[j].index = k+1;   //the libsvm use 1 index instead of zero
-                x_space[j].value = vals[l];
-                l++;
-            }
-#if dbl_SV_RPIB >= 7            //default is 7
-            printf("[SV][RPIB] {P} i:%d j:%d prob.y[i]:%g x_space[j].index:%d x_space[j].value:%g\n",
-                                        i, j, prob.y[i], x_space[j].index, x_space[j].value);     //$$debug
-            printf("k:%d ,l:%d, cols[l]:%d, vals[l]:%g\n",
-                   k, l, cols[l], vals[l]);
-#endif
-            ++j;
-        }
-        //create the end element of each node (-1,0)
-        x_space[j].index = -1;
-        x_space[j].value = 0;
-        ++j;
-
-        MatRestoreRow(m_train_data_p, ul_target_index,&ncols, &cols, &vals);
-    }
-    VecRestoreArray(v_vol_p,&arr_vol_p);
-#if dbl_SV_RPIB >= 3
-    printf("[SV][RPIB] end of positive class, i is :%d,num of elements(j) is :%d\n",i,j);
-#endif
-
-    // - - - - - read negative data - - - - -
-    for (i=0; i< n_num_node_;i++){
-        unsigned long ul_target_index = v_n_index[i];
-        prob.y[i+p_num_node_] = -1;
-
-        #if weight_instance == 1
-            prob.W[i+p_num_node_] = arr_vol_n[ul_target_index] * sq_inv_sum_vol_n;
-            if(prob.W[i+p_num_node_] < min_vol)
-                min_vol = prob.W[i+p_num_node_];    //store the min
-            if(prob.W[i+p_num_node_] > max_vol)
-                max_vol = prob.W[i+p_num_node_];    //store the max
-//            printf("(%.4f,%.4f),",arr_vol_n[ul_target_index], prob.W[i+p_num_node_]);                  //$$debug
-        #endif
-
-        prob.x[i+p_num_node_] = &x_space[j];
-        MatGetRow(m_train_data_n, ul_target_index,&ncols, &cols, &vals);
-
-        l=0;
-        for (k=0; k< num_col; k++) {
-            if(k == cols[l])
-            {
-                x_space[j].index = k+1;   //the libsvm use 1 index instead of zero
-                x_space[j].value = vals[l];
-                l++;
-            }
-#if dbl_SV_RPIB >= 7
-            printf("[SV][RPIB] {N} i:%d j:%d prob.y[i+p_num_node_]:%g x_space[j].index:%d x_space[j].value:%g\n",
-                                        i, j, prob.y[i+p_num_node_], x_space[j].index, x_space[j].value);     //$$debug
-//            printf("k:%d ,l:%d, cols[l]:%d, vals[l]:%g\n",
-//                   k, l, cols[l], vals[l]);
-#endif
-            ++j;
-        }
-        //create the end element of each node (-1,0)
-        x_space[j].index = -1;
-        x_space[j].value = 0;
-        ++j;
-
-        MatRestoreRow(m_train_data_n, ul_target_index,&ncols, &cols, &vals);
-    }
-    VecRestoreArray(v_vol_n,&arr_vol_n);
-#if dbl_SV_RPIB >= 3
-    printf("[SV][RPIB] end of negative class, i is :%d,num of elements(j) is :%d\n",i,j);
-#endif
-
-#if weight_instance == 1
-    // - - - - normaliz instance weights between 0 and 1
-    PetscScalar vol_range = max_vol - min_vol;
-//    printf("\n\n[SV][RP] vol range is:%.20f, min vol:%.20f, max vol:%.20f\n",vol_range, min_vol, max_vol);            //$$debug
-    for(unsigned int i = 0; i < num_total_nodes; i++){
-        prob.W[i] = (prob.W[i] - min_vol) / vol_range ;
-//        printf("%d,%.8f\t",i, prob.W[i]);                              //$$debug
+    }else{
+        training_problem_ = std::make_shared<const TrainingProblem>(m_train_data_p, v_vol_p, m_train_data_n, v_vol_n,
+                                                                    v_p_index, v_n_index, iter_p_end, iter_n_end, buffer_pool_);
     }
-#endif
-//    Don't Destroy input matrices at all    ( They are deleted after 2nd stage of model selection )
+    prob = training_problem_->get_problem();
+    x_space = NULL;
 }
 
 
@@ -836,9 +877,14 @@ void Solver::PD_read_problem_index_base(Mat& m_data, std::vector<int>& v_target_
 #endif
 
 //---- read the data to prob for libsvm -----
-    prob.y = Malloc(double, num_total_nodes );
-    prob.x = Malloc(struct svm_node *, num_total_nodes );
-    x_space = Malloc(struct svm_node, num_elements_ );
+    prob.y = alloc_buffer<double>(num_total_nodes);
+    #if weight_instance == 1        // the weighted libsvm reads the instance weights, all the points have the same weight
+        prob.W = alloc_buffer<double>(num_total_nodes);
+        for(i=0; i < num_total_nodes; i++)
+            prob.W[i] = 1;
+    #endif
+    prob.x = alloc_buffer<struct svm_node *>(num_total_nodes);
+    x_space = alloc_buffer<struct svm_node>(num_elements_);
 
     prob.l = num_total_nodes;
     // - - - - - read data - - - - -
@@ -942,14 +988,14 @@ void Solver::read_problem(Mat& m_train_data_p, Vec& v_vol_p, Mat& m_train_data_n
 #endif
 
 //---- read the data to prob for libsvm -----
-    this->prob.y = Malloc(double, num_total_nodes );
+    this->prob.y = alloc_buffer<double>(num_total_nodes);
 
     #if weight_instance == 1
-        this->prob.W = Malloc(double, num_total_nodes );
+        this->prob.W = alloc_buffer<double>(num_total_nodes);
     #endif
 
-    this->prob.x = Malloc(struct svm_node *, num_total_nodes );
-    this->x_space = Malloc(struct svm_node, num_elements_ );
+    this->prob.x = alloc_buffer<struct svm_node *>(num_total_nodes);
+    this->x_space = alloc_buffer<struct svm_node>(num_elements_);
 
 #if dbl_SV_read_problem >= 3
     printf("[SV][RP]After Malloc\n");
@@ -1138,9 +1184,14 @@ void Solver::read_problem_without_instance_weight(Mat& m_train_data_p, Mat& m_tr
 #endif
 
 //---- read the data to prob for libsvm -----
-    this->prob.y = Malloc(double, num_total_nodes );
-    this->prob.x = Malloc(struct svm_node *, num_total_nodes );
-    this->x_space = Malloc(struct svm_node, num_elements_ );
+    this->prob.y = alloc_buffer<double>(num_total_nodes);
+    #if weight_instance == 1        // the weighted libsvm reads the instance weights, all the points have the same weight
+        this->prob.W = alloc_buffer<double>(num_total_nodes);
+        for(i=0; i < num_total_nodes; i++)
+            this->prob.W[i] = 1;
+    #endif
+    this->prob.x = alloc_buffer<struct svm_node *>(num_total_nodes);
+    this->x_space = alloc_buffer<struct svm_node>(num_elements_);
 
 #if dbl_SV_read_problem >= 3
     printf("[SV][RP]After Malloc\n");
@@ -1248,38 +1299,14 @@ void Solver::set_weights_sum_volume(svm_parameter& param_, Vec& v_vol_p, Vec& v_
 #endif
 }
 
-void Solver::set_weights_sum_volume_index_base(svm_parameter& param_, Vec& v_vol_p, Vec& v_vol_n,
-                                               std::vector<PetscInt>& v_p_index, std::vector<PetscInt>& v_n_index,
-                                               PetscInt iter_p_end, PetscInt iter_n_end ){  //@@
-    PetscScalar sum_vol_p = 0, sum_vol_n=0;
-    PetscInt i, all_vol_p_size, all_vol_n_size;
-    VecGetSize(v_vol_p, &all_vol_p_size);
-    VecGetSize(v_vol_n, &all_vol_n_size);
-
-    PetscScalar     *arr_vol_p_, * arr_vol_n_;
-
-    PetscMalloc1(all_vol_p_size, &arr_vol_p_);
-    VecGetArray(v_vol_p,&arr_vol_p_);
-    for(i=0 ; i < iter_p_end ; i++){
-        sum_vol_p += arr_vol_p_[v_p_index[i]];
-    }
-    VecRestoreArray(v_vol_p,&arr_vol_p_);
-    PetscFree(arr_vol_p_);
-
-    PetscMalloc1(all_vol_n_size, &arr_vol_n_);
-    VecGetArray(v_vol_n,&arr_vol_n_);
-    for(i=0 ; i < iter_n_end ; i++){
-        sum_vol_n += arr_vol_n_[v_n_index[i]];
-    }
-    VecRestoreArray(v_vol_n,&arr_vol_n_);
-    PetscFree(arr_vol_n_);
-
-
+void Solver::set_weights_sum_volume_index_base(svm_parameter& param_){
+    double sum_vol_p = training_problem_->get_sum_vol_p();
+    double sum_vol_n = training_problem_->get_sum_vol_n();
     param_.weight[0]= 1.0 / sum_vol_p;
     param_.weight[1]= 1.0 / sum_vol_n;
 #if dbl_SV_SWSVIB >= 1
-        printf("[SV][set_weights_sum_volume] Min class P(label :%d,\t Sum_volume:%d,\t weight:%g)\n",param_.weight_label[0], sum_vol_p, param_.weight[0]);
-        printf("[SV][set_weights_sum_volume] Maj class N(label :%d,\t Sum_volume:%d,\t weight:%g)\n",param_.weight_label[1], sum_vol_n, param_.weight[1]);
+        printf("[SV][set_weights_sum_volume] Min class P(label :%d,\t Sum_volume:%g,\t weight:%g)\n",param_.weight_label[0], sum_vol_p, param_.weight[0]);
+        printf("[SV][set_weights_sum_volume] Maj class N(label :%d,\t Sum_volume:%g,\t weight:%g)\n",param_.weight_label[1], sum_vol_n, param_.weight[1]);
 #endif
 }
 
@@ -1338,6 +1365,8 @@ void Solver::read_parameters(){
     param.cache_size = Config_params::getInstance()->get_svm_cache_size();
     param.C = Config_params::getInstance()->get_svm_C();
     param.eps = Config_params::getInstance()->get_svm_eps();
+    if(eps_ > 0)
+        param.eps = eps_;
 //    param.p = Config_params::getInstance()->get_svm_p();
     param.shrinking = Config_params::getInstance()->get_svm_shrinking();
     param.probability = Config_params::getInstance()->get_svm_probability();
@@ -1410,6 +1439,14 @@ void Solver::test_predict(Mat& test_data, summary& result_summary, int iteration
     printf("[SV][test_predict] test_predict_data Matrix:\n");                                       //$$debug
     MatView(test_data,PETSC_VIEWER_STDOUT_WORLD);                                //$$debug
 #endif
+    std::unique_lock<std::mutex> petsc_lock(TaskPool::petsc_mutex());     // MatGetRow is not thread safe (see TaskPool)
+    PredictionSet test_set(test_data);
+    petsc_lock.unlock();
+    test_predict(test_set, result_summary, iteration);
+}
+
+
+void Solver::test_predict(const PredictionSet& test_set, summary& result_summary, int iteration){
     int correct = 0;
     int total = 0;
     double error = 0;
@@ -1421,41 +1458,19 @@ void Solver::test_predict(Mat& test_data, summary& result_summary, int iteration
     double *prob_estimates=NULL;
 //    std::map<measures,double> results_;
 //start of reading the test points
-    PetscInt i=0, k=0, ncols=0,num_points=0,num_col=0;
-    const PetscInt    *cols;                        //if not NULL, the column numbers
-    const PetscScalar *vals;
-
-    MatGetSize(test_data,&num_points,&num_col);   //get the number of data points
+    int num_points = test_set.size();
 #if dbl_SV_test_predict >= 3
-    printf("[SV][test_predict] test data points rows:%d cols:%d \n", num_points,num_col);
+    printf("[SV][test_predict] test data points rows:%d\n", num_points);
 #endif
-//    std::cout <<"[SV][TP] {2} \n" ; //exit(1);
-//read test points from matrix to array
-//    num_points = 1;                         /// only for debug $$
-    for (i=0; i< num_points;i++){
+    for (int i=0; i< num_points;i++){
         double target_label, predict_label;//target is the one that is in the vector
-        MatGetRow(test_data,i,&ncols, &cols, &vals);
-
-        target_label = vals[0];             //read the label in the first column(0)
-        //allocate required memory
-        x = (struct svm_node *) realloc(x, (ncols + 1 ) * sizeof(struct svm_node));    //No need for +1 as I add the label in index 0 that add one non-zero value to each row
+        target_label = test_set.label(i);
+        const svm_node * x = test_set.row(i);
 
-        for (k=1; k< ncols; k++) {  //zero is the label
-            x[k-1].index = cols[k];   //since I add the label in the first column +1 is not required anymore
-            x[k-1].value = vals[k];
-#if dbl_SV_test_predict >= 9 // 9 default
-            printf("[SV][test_predict] i:%d, k-1:%d, x[k-1].index:%d, x[k-1].value:%g\n",i, k-1,x[k-1].index, x[k-1].value);    //$$debug
-#endif
+        if(approx_ != NULL){
+            predict_label = approx_->predict(x, approx_model_id_);
         }
-        //create the end element of each node (-1,0)
-        x[k].index = -1;
-        x[k].value = 0;
-#if dbl_SV_test_predict >= 9 // 9 default
-        printf("[SV][test_predict] k:%d, x[k].index:%d, x[k].value:%g\n", k,x[k].index, x[k].value);    //$$debug
-#endif
-        MatRestoreRow(test_data,i,&ncols, &cols, &vals);
-
-        if (predict_probability && (svm_type==C_SVC || svm_type==NU_SVC))  {    // Not used
+        else if (predict_probability && (svm_type==C_SVC || svm_type==NU_SVC))  {    // Not used
             predict_label = svm_predict_probability(local_model,x,prob_estimates);
         }
         else {
@@ -1545,57 +1560,33 @@ void Solver::predict_validation_data(Mat& m_VD_p,Mat& m_VD_n, summary& result_su
     printf("[SV][Predict_VD] m_VD_n Matrix:\n");                              //$$debug
     MatView(m_VD_n,PETSC_VIEWER_STDOUT_WORLD);                                //$$debug
 #endif
+    predict_validation_data(*PredictionSet::validation(m_VD_p, m_VD_n), result_summary, iteration);
+}
+
+
+void Solver::predict_validation_data(const PredictionSet& vd_set, summary& result_summary, int iteration){
     ETimer t_predict_VD;
     int correct = 0;
     double tp =0, tn =0, fp =0, fn=0;
-    PetscInt    i=0, k=0, ncols=0,num_points_p=0,num_points_n=0,num_col=0;
-    const PetscInt    *cols;                        //if not NULL, the column numbers
-    const PetscScalar *vals;
-    double target_label = 0, predict_label=0;
-
-    MatGetSize(m_VD_p,&num_points_p,&num_col);   //get the number of data points in positive class
-    MatGetSize(m_VD_n,&num_points_n,NULL);       //get the number of data points in negative class
+    double predict_label=0;
+    int num_points = vd_set.size();
 #if dbl_SV_predict_VD >= 3
-    printf("[SV][Predict_VD] m_VD_p rows:%d cols:%d \n", num_points_p,num_col);
-    printf("[SV][Predict_VD] m_VD_n rows:%d cols:%d \n", num_points_p,num_col);
+    printf("[SV][Predict_VD] VD rows p:%d n:%d\n", vd_set.num_p(), num_points - vd_set.num_p());
 #endif
 
-    // - - - - - positive class - - - - -
-    target_label = 1;
-    for (i=0; i< num_points_p;i++){
-        MatGetRow(m_VD_p,i,&ncols, &cols, &vals);
-        x = (struct svm_node *) realloc(x, (ncols + 1 ) * sizeof(struct svm_node));    //No need for +1 as I add the label in index 0 that add one non-zero value to each row
-        for (k=0; k< ncols; k++) {  // data starts at zero
-            x[k].index = cols[k]+1;   //validation data doesn't have the label, so I need to add 1 to indices
-            x[k].value = vals[k];
-        }
-        x[k].index = -1;    //create the end element of each node (-1,0)
-        x[k].value = 0;
-        MatRestoreRow(m_VD_p,i,&ncols, &cols, &vals);
-
-        predict_label = svm_predict(local_model,x);
-        if (predict_label == 1)     //correct
-            tp++;
-        else                                //predict negative
-            fn++;                   //false
-    }
-    // - - - - - negative class - - - - -@@
-    target_label = -1;
-    for (i=0; i< num_points_n;i++){
-        MatGetRow(m_VD_n,i,&ncols, &cols, &vals);
-        x = (struct svm_node *) realloc(x, (ncols + 1 ) * sizeof(struct svm_node));    //No need for +1 as I add the label in index 0 that add one non-zero value to each row
-        for (k=0; k< ncols; k++) {  // data starts at zero
-            x[k].index = cols[k]+1;   //validation data doesn't have the label, so I need to add 1 to indices
-            x[k].value = vals[k];
+    for (int i=0; i< num_points;i++){
+        predict_label = svm_predict(local_model, vd_set.row(i));
+        if(vd_set.label(i) == 1){       // - - - - - positive class - - - - -
+            if (predict_label == 1)     //correct
+                tp++;
+            else                                //predict negative
+                fn++;                   //false
+        }else{                          // - - - - - negative class - - - - -
+            if (predict_label == -1)    //correct
+                tn++;
+            else                                //predict positive
+                fp++;                   //false
         }
-        x[k].index = -1;    //create the end element of each node (-1,0)
-        x[k].value = 0;
-        MatRestoreRow(m_VD_n,i,&ncols, &cols, &vals);
-        predict_label = svm_predict(local_model,x);
-        if (predict_label == -1)    //correct
-            tn++;
-        else                                //predict positive
-            fp++;                   //false
     }
 
     // - - - - - calc performance measures - - - - -
@@ -1603,7 +1594,7 @@ void Solver::predict_validation_data(Mat& m_VD_p,Mat& m_VD_n, summary& result_su
     result_summary.perf[Sens] = tp / (tp+fn) ;
     result_summary.perf[Spec] = tn / (tn+fp) ;
     result_summary.perf[Gmean] = sqrt(result_summary.perf[Sens] * result_summary.perf[Spec]);
-    result_summary.perf[Acc] = (double)correct / (num_points_p + num_points_n) ;
+    result_summary.perf[Acc] = (double)correct / num_points ;
     if(tp+fp == 0)              //prevent nan case
         result_summary.perf[PPV] = 0;
     else
@@ -1626,6 +1617,8 @@ void Solver::predict_validation_data(Mat& m_VD_p,Mat& m_VD_n, summary& result_su
     result_summary.num_SV_n = local_model->nSV[1];
     if(iteration != -1)             //later it is needed to select the best model
         result_summary.iter = iteration;
+    result_summary.telemetry = telemetry_;
+    result_summary.telemetry.predict_time = t_predict_VD.get_elapsed();
 #if dbl_SV_predict_VD >= 1    // 1 default
     Config_params::getInstance()->print_summary(result_summary,"[SV][TP]");
 #endif
@@ -1655,6 +1648,7 @@ void Solver::predict_validation_data(Mat& m_VD_p,Mat& m_VD_n, summary& result_su
 void Solver::test_predict_index_base(Mat& m_data_p, Mat& m_data_n,
                                                std::vector<PetscInt>& v_p_index, std::vector<PetscInt>& v_n_index,
                                                PetscInt iter_p_end, PetscInt iter_n_end, summary& result_summary, int iteration){
+    std::unique_lock<std::mutex> petsc_lock(TaskPool::petsc_mutex(), std::defer_lock);
 
     int correct = 0;
     double tp =0, tn =0, fp =0, fn=0;
@@ -1676,6 +1670,7 @@ void Solver::test_predict_index_base(Mat& m_data_p, Mat& m_data_n,
     //read test points P from matrix to array
     for (i=iter_p_end; i< num_points_p;i++){
 //        double target_label, predict_label;//target is the one that is in the vector
+        petsc_lock.lock();
         MatGetRow(m_data_p,i,&ncols, &cols, &vals);
 
 //        target_label = +1;
@@ -1689,6 +1684,7 @@ void Solver::test_predict_index_base(Mat& m_data_p, Mat& m_data_n,
         x[k].index = -1;
         x[k].value = 0;
         MatRestoreRow(m_data_p,i,&ncols, &cols, &vals);
+        petsc_lock.unlock();
 
         predict_label = svm_predict(local_model,x);
 
@@ -1700,6 +1696,7 @@ void Solver::test_predict_index_base(Mat& m_data_p, Mat& m_data_n,
     //read test points N from matrix to array
     for (i=iter_n_end; i< num_points_n;i++){
 //        double target_label, predict_label;//target is the one that is in the vector
+        petsc_lock.lock();
         MatGetRow(m_data_n,i,&ncols, &cols, &vals);
 
 //        target_label = -1;
@@ -1713,6 +1710,7 @@ void Solver::test_predict_index_base(Mat& m_data_p, Mat& m_data_n,
         x[k].index = -1;
         x[k].value = 0;
         MatRestoreRow(m_data_n,i,&ncols, &cols, &vals);
+        petsc_lock.unlock();
 
         predict_label = svm_predict(local_model,x);
 
@@ -1889,58 +1887,55 @@ void Solver::predict_test_data_in_matrix_output(Mat& test_data, int target_row,
     printf("[SV][test_predict] predict_label1 test_data Matrix:\n");                                       //$$debug
     MatView(test_data,PETSC_VIEWER_STDOUT_WORLD);                                //$$debug
 #endif
+    PredictionSet test_set(test_data);
+    predict_test_data_in_matrix_output(test_set, target_row, m_predicted_label);
+}
+
+
+void Solver::predict_test_data_in_matrix_output(const PredictionSet& test_set, int target_row, Mat& m_predicted_label){
     int svm_type=svm_get_svm_type(local_model);
     double *prob_estimates=NULL;
-//start of reading the test points
-    PetscInt i=0, k=0, ncols=0,num_points=0,num_col=0;
-    const PetscInt    *cols;                        //if not NULL, the column numbers
-    const PetscScalar *vals;
-
-    MatGetSize(test_data,&num_points,&num_col);   //get the number of data points
+    int num_points = test_set.size();
 #if dbl_SV_predict_label1 >= 3
-    printf("[SV][test_predict] test data points rows:%d cols:%d \n", num_points,num_col);
-#endif
-//read test points from matrix to array
-    for (i=0; i< num_points;i++){
-        double target_label, predict_label;//target is the one that is in the vector
-        MatGetRow(test_data,i,&ncols, &cols, &vals);
-
-        target_label = vals[0];             //read the label in the first column(0)
-        //allocate required memory
-        x = (struct svm_node *) realloc(x, (ncols + 1 ) * sizeof(struct svm_node));    //No need for +1 as I add the label in index 0 that add one non-zero value to each row
-        for (k=1; k< ncols; k++) {  //zero is the label
-            x[k-1].index = cols[k];   //since I add the label in the first column +1 is not required anymore
-            x[k-1].value = vals[k];
-#if dbl_SV_predict_label1 >= 9
-            printf("[SV][PL] i:%d, k-1:%d, x[k-1].index:%d, x[k-1].value:%g\n",i, k-1,x[k-1].index, x[k-1].value);    //$$debug
-#endif
-        }
-        //create the end element of each node (-1,0)
-        x[k].index = -1;
-        x[k].value = 0;
-#if dbl_SV_predict_label1 >= 9
-        printf("[SV][PL] end element k:%d, x[k].index:%d, x[k].value:%g\n", k,x[k].index, x[k].value);    //$$debug
+    printf("[SV][test_predict] test data points rows:%d\n", num_points);
 #endif
-        MatRestoreRow(test_data,i,&ncols, &cols, &vals);
+    std::vector<PetscScalar> v_predict_label(num_points);
+    for (int i=0; i< num_points;i++){
+        double predict_label;
+        const svm_node * x = test_set.row(i);
 
-        if (predict_probability && (svm_type==C_SVC || svm_type==NU_SVC))  {    // Not used
+        if(approx_ != NULL){
+            predict_label = approx_->predict(x, approx_model_id_);
+        }else if (predict_probability && (svm_type==C_SVC || svm_type==NU_SVC))  {    // Not used
             predict_label = svm_predict_probability(local_model,x,prob_estimates);
         }else {
             predict_label = svm_predict(local_model,x);
         }
 
 #if dbl_SV_predict_label1 >= 3
-        printf("[SV][PL1] target_row:%d, i:%d, target_label:%g, predict_label:%g\n", target_row, i, target_label, predict_label);    //$$debug
+        printf("[SV][PL1] target_row:%d, i:%d, target_label:%g, predict_label:%g\n", target_row, i, test_set.label(i), predict_label);    //$$debug
 #endif
 
-        MatSetValue(m_predicted_label,target_row,i,(PetscScalar)predict_label,INSERT_VALUES);
+        v_predict_label[i] = predict_label;
     }
+    set_output_row(target_row, v_predict_label, m_predicted_label);
 
     if(predict_probability)
         free(prob_estimates);
 }
 
 
+/*
+ * the row of the model in the output matrix is set at once, the partition groups train and predict at the same time
+ */
+void Solver::set_output_row(int target_row, const std::vector<PetscScalar>& v_predict_label, Mat& m_predicted_label){
+    std::vector<PetscInt> v_cols(v_predict_label.size());
+    std::iota(v_cols.begin(), v_cols.end(), 0);
+    std::lock_guard<std::mutex> petsc_lock(TaskPool::petsc_mutex());
+    MatSetValues(m_predicted_label, 1, &target_row, v_cols.size(), v_cols.data(), v_predict_label.data(), INSERT_VALUES);
+}
+
+
 
 
 /*
@@ -2012,6 +2007,27 @@ void Solver::predict_VD_in_output_matrix(Mat& m_VD_p,Mat& m_VD_n, int target_row
 }
 
 
+/*
+ * same as above with the rows converted once (see PredictionSet), the columns are the positive and then the negative points
+ */
+void Solver::predict_VD_in_output_matrix(const PredictionSet& vd_set, int target_row, Mat& m_predicted_label){
+    int svm_type=svm_get_svm_type(local_model);
+    double *prob_estimates=NULL;
+    std::vector<PetscScalar> v_predict_label(vd_set.size());
+    for (int i=0; i< vd_set.size();i++){
+        if (predict_probability && (svm_type==C_SVC || svm_type==NU_SVC))  {    // Not used
+            v_predict_label[i] = svm_predict_probability(local_model,vd_set.row(i),prob_estimates);
+        }else {
+            v_predict_label[i] = svm_predict(local_model,vd_set.row(i));
+        }
+    }
+    set_output_row(target_row, v_predict_label, m_predicted_label);
+
+    if(predict_probability)
+        free(prob_estimates);
+}
+
+
 
 
 
@@ -2191,19 +2207,22 @@ void Solver::prepare_solution_single_model(svm_model * model_, int num_point_p,
 #endif
 
     sol_single_model.p_index.reserve(model_->nSV[0] );
+    sol_single_model.p_alpha.reserve(model_->nSV[0] );
     for (i=0; i < model_->nSV[0];i++){
         // -1 because sv_indice start from 1, while petsc row start from 0
         sol_single_model.p_index.push_back(model_->sv_indices[i] - 1);
+        sol_single_model.p_alpha.push_back(fabs(model_->sv_coef[0][i]));     // used to warm start the finer level
     }
 
     sol_single_model.n_index.reserve(model_->nSV[1] );
+    sol_single_model.n_alpha.reserve(model_->nSV[1] );
     // add the index in the model for it after subtract from number of minority in training data
     for (int i=0; i < model_->nSV[1];i++){
         // -1 the same as pos class, p_num_row because they are after each other
 
 //        sol_single_model.n_index.push_back(model_->sv_indices[model_->nSV[0] + i] - 1 - num_point_p); //for normal libsvm
         sol_single_model.n_index.push_back(model_->sv_indices[model_->nSV[0] + i] - 1 - num_point_p); //for instance weighted libsvm
-
+        sol_single_model.n_alpha.push_back(fabs(model_->sv_coef[0][model_->nSV[0] + i]));
     }
 
 #if dbl_SV_PSSM >= 3
@@ -2218,8 +2237,13 @@ void Solver::prepare_solution_single_model(svm_model * model_, int num_point_p,
     std::string output_file = "./svm_models/" + Config_params::getInstance()->get_ds_name()+
             "_exp_" + std::to_string(Config_params::getInstance()->get_main_current_exp_id()) +
             "_kf_" + std::to_string(Config_params::getInstance()->get_main_current_kf_id()) +
-            "_level_" + std::to_string(Config_params::getInstance()->get_main_current_level_id()) + ".svmmodel";
-    svm_save_model(output_file.c_str(), local_model);
+            "_level_" + std::to_string(Config_params::getInstance()->get_main_current_level_id());
+#if export_SVM_models_format != 1
+    svm_save_model((output_file + ".svmmodel").c_str(), local_model);
+#endif
+#if export_SVM_models_format >= 1
+    ModelBinary::save_async(output_file + ".svmbin", local_model);
+#endif
     Config_params::getInstance()->update_levels_models_info(Config_params::getInstance()->get_main_current_level_id(), 1);
 //    printf("[SV][PSSM] model %s is saved\n", output_file.c_str());
 #endif
@@ -25,6 +25,11 @@ struct weight_info{
     PetscInt s_vol_p, s_vol_n;
 };
 
+class RffApproximation;
+class PredictionSet;
+class BufferPool;
+class TrainingProblem;
+
 
 class Solver{
 private:
@@ -42,6 +47,17 @@ private:
     int test_num_node_=0, test_num_elem_=0;
     int predict_probability=0;
     const char * test_dataset_f_name;
+    std::vector<double> v_warm_alpha_;      // initial alphas for the next training (same order as prob)
+    std::vector<double> v_model_values_;    // the next training takes this model instead of the SMO (see set_model_values)
+    svm_kernel_cache * kernel_cache_ = NULL;    // shared kernel rows, owned by the caller (model selection)
+    std::vector<int> v_point_ids_;          // id of each point of the problem in the kernel_cache_
+    svm_cache_stats cache_stats_ = svm_cache_stats();   // libsvm kernel cache statistics of the last training
+    train_telemetry telemetry_;             // statistics of the last training, copied to the summary of the validation data
+    const RffApproximation * approx_ = NULL;    // replaces the local_model in test_predict and predict_test_data_in_matrix_output
+    BufferPool * buffer_pool_ = NULL;           // the problem arrays come from this pool if it is set (owned by the caller)
+    std::shared_ptr<const TrainingProblem> training_problem_;  // prob of the index base trainings points to its arrays
+    int approx_model_id_ = 0;
+    double eps_ = 0;                        // stopping tolerance instead of svm_eps (0 uses svm_eps)
 
     void read_parameters();
     void print_parameters();
@@ -57,22 +73,33 @@ private:
     void read_problem_without_instance_weight(Mat& m_train_data_p, Mat& m_train_data_n);
 
     void set_weights_num_points(svm_parameter& param_, PetscInt num_p_point, PetscInt num_n_point);
+    // the predictions of a model in its row of the output matrix (one call under the PETSc lock)
+    void set_output_row(int target_row, const std::vector<PetscScalar>& v_predict_label, Mat& m_predicted_label);
 
     void set_weights_sum_volume(svm_parameter& param_, Vec& v_vol_p, Vec& v_vol_n);
 
-    void set_weights_sum_volume_index_base(svm_parameter& param_, Vec& v_vol_p, Vec& v_vol_n,
-                        std::vector<PetscInt>& v_p_index, std::vector<PetscInt>& v_n_index, PetscInt iter_p_end, PetscInt iter_n_end);
+    void set_weights_sum_volume_index_base(svm_parameter& param_);     // uses the volume sums of the training_problem_
 
     void PD_set_weights_sum_num_point_IB(svm_parameter& param_,std::vector<int>& v_lbl, const PetscScalar * arr_index, int num_nnz); //personalized classifier
 
     void alloc_memory_for_weights(svm_parameter& in_param, bool free_first);
 
+    template<typename T> T * alloc_buffer(size_t num_elements);
+    void free_buffer(void * ptr);
+
 
 
 public:
     Solver(){
         test_dataset_f_name = Config_params::getInstance()->get_test_ds_f_name().c_str();
         predict_probability = Config_params::getInstance()->get_svm_probability();
+        prob.y = NULL;
+        prob.x = NULL;
+        prob.W = NULL;
+        x_space = NULL;
+        local_model = NULL;             // no training (e.g. the result came from the result cache)
+        param.weight_label = NULL;
+        param.weight = NULL;
     }
 
     void set_local_model(svm_model * in_model){
@@ -81,6 +108,77 @@ public:
 
     void free_solver(std::string caller_name);    //work as deconstructor
 
+    /*
+     * warm start the next train_model/train_model_index_base from v_init_alpha
+     * the alphas follow the order of the training problem (positive points first, then negative points)
+     * they are clipped to the new box constraints inside the libsvm, a size mismatch falls back to a cold start
+     */
+    void set_warm_start(const std::vector<double>& v_init_alpha){
+        v_warm_alpha_ = v_init_alpha;
+    }
+
+    /*
+     * share the kernel rows of the next trainings through kernel_cache (NULL disables)
+     * v_point_ids maps the rows of the training problem (positive points first) to the ids of the cache,
+     * an empty vector means the identity
+     */
+    void set_kernel_cache(svm_kernel_cache * kernel_cache, const std::vector<int>& v_point_ids){
+        kernel_cache_ = kernel_cache;
+        v_point_ids_ = v_point_ids;
+    }
+
+    /*
+     * predict with the compiled approximation of the local model instead of the exact model (NULL disables)
+     * model_id is the id of the local model in the approximation, the caller owns the approximation
+     */
+    void set_approximation(const RffApproximation * approx, int model_id = 0){
+        approx_ = approx;
+        approx_model_id_ = model_id;
+    }
+
+    /*
+     * take the problem arrays (x_space, prob.x, prob.y, prob.W) from the pool and give them back in free_solver
+     * the pool should be set before the training and it should be alive until free_solver
+     */
+    void set_buffer_pool(BufferPool * buffer_pool){
+        buffer_pool_ = buffer_pool;
+    }
+
+    /*
+     * train the next train_model_index_base on a problem which is built once for all the candidates of a group
+     * it should be built from the same data, indices and ends which are passed to train_model_index_base
+     * the Solver keeps a reference until free_solver, hence the models stay valid after the caller drops it
+     */
+    void set_training_problem(const std::shared_ptr<const TrainingProblem>& training_problem){
+        training_problem_ = training_problem;
+    }
+
+    // stopping tolerance of the next trainings instead of svm_eps (0 uses svm_eps), e.g. a looser one for a quick ranking
+    void set_eps(double eps){
+        eps_ = eps;
+    }
+
+    void get_alphas(std::vector<double>& v_alpha) const;
+
+    /*
+     * the local model as an array (svm_get_model_values), e.g. the owner rank broadcasts it (see DistTasks)
+     * the array is empty if there is no local model
+     */
+    void get_model_values(std::vector<double>& v_values) const;
+
+    /*
+     * the next train_model/train_model_index_base/train_model_shared_problem builds its problem as usual
+     * and takes the model of v_values instead of training it, the values should come from get_model_values
+     * of the same problem and parameters (e.g. on another rank), an empty vector trains as usual
+     */
+    void set_model_values(const std::vector<double>& v_values){
+        v_model_values_ = v_values;
+    }
+
+    const svm_cache_stats& get_cache_stats() const { return cache_stats_; }
+
+    const train_telemetry& get_telemetry() const { return telemetry_; }
+
     svm_model * train_model(Mat& m_data_p, Vec& v_vol_p, Mat& m_data_n, Vec& v_vol_n,
                             bool inherit_params, double param_c, double param_gamma);
 
@@ -90,6 +188,9 @@ public:
                                                PetscInt iter_p_end, PetscInt iter_n_end,
                                                bool inherit_params, double param_c, double param_gamma);
 
+    // train the problem which is set by set_training_problem (nothing is read from the PETSc data)
+    svm_model * train_model_shared_problem(double param_c, double param_gamma);
+
     void stand_alone_train_without_instance_weight(Mat& m_data_p, Mat& m_data_n, std::string model_fname);
 
     void stand_alone_train_instance_weight(Mat& m_data_p , Vec& v_vol_p, Mat& m_data_n, Vec& v_vol_n, std::string model_fname);
@@ -109,8 +210,11 @@ public:
 
 
     void predict_test_data_in_matrix_output(Mat& test_data, int target_row, Mat& m_predicted_label);
+    // the rows are converted already (see PredictionSet), the column i of the target_row is the label of the row i
+    void predict_test_data_in_matrix_output(const PredictionSet& test_set, int target_row, Mat& m_predicted_label);
 
     void predict_VD_in_output_matrix(Mat& m_VD_p,Mat& m_VD_n, int target_row, Mat& m_predicted_label);
+    void predict_VD_in_output_matrix(const PredictionSet& vd_set, int target_row, Mat& m_predicted_label);
 
 //    std::map<measures,double> evaluate_testdata(int level);
     void evaluate_testdata(int level, summary& final_summary);
@@ -118,8 +222,11 @@ public:
 
 //    std::map<measures,double> test_predict(Mat& );
     void test_predict(Mat& test_data, summary& result_summary, int iteration=-1);
+    void test_predict(const PredictionSet& test_set, summary& result_summary, int iteration=-1);
     
     void predict_validation_data(Mat& m_VD_p,Mat& m_VD_n, summary& result_summary, int iteration);
+    // no PETSc call, hence no lock in the tasks (the set of the current V-cycle is shared by all the candidates)
+    void predict_validation_data(const PredictionSet& vd_set, summary& result_summary, int iteration);
 
     svm_model * get_model(){return local_model;}
 
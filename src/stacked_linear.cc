@@ -0,0 +1,73 @@
+#include "stacked_linear.h"
+#include "etimer.h"
+
+void StackedLinearModels::add(int row_id, const svm_model * model){
+    if(model->w == NULL){
+        fprintf(stderr, "[SLM][Add] the model has no linear weights, Exit!\n");
+        exit(1);
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    v_row_id_.push_back(row_id);
+    v_rho_.push_back(model->rho[0]);
+    v_label_pos_.push_back(model->label[0]);
+    v_label_neg_.push_back(model->label[1]);
+    vv_cols_.push_back(std::vector<PetscInt>());
+    vv_vals_.push_back(std::vector<PetscScalar>());
+    for(int j=1; j <= model->w_dim; j++){       // the feature j is the column j of the data (column 0 is the label)
+        if(model->w[j] != 0){
+            vv_cols_.back().push_back(j);
+            vv_vals_.back().push_back(model->w[j]);
+        }
+    }
+}
+
+
+void StackedLinearModels::predict(Mat& m_data, Mat& m_predicted_label){
+    if(empty())
+        return;
+#if dbl_SV_predict_label1 >= 1
+    ETimer t_slm;
+#endif
+    PetscInt num_points, num_col;
+    MatGetSize(m_data, &num_points, &num_col);
+    PetscInt num_models = size();
+
+    // - - - - - - build W (num_models x num_col) - - - - - -
+    std::vector<PetscInt> v_nnz(num_models);
+    for(PetscInt k=0; k < num_models; k++)
+        v_nnz[k] = vv_cols_[k].size();
+    Mat m_W;
+    MatCreateSeqAIJ(PETSC_COMM_SELF, num_models, num_col, 0, v_nnz.data(), &m_W);
+    for(PetscInt k=0; k < num_models; k++){
+        PetscInt num_valid = 0;                 // weights beyond the columns of the data never meet a value
+        while(num_valid < (PetscInt) vv_cols_[k].size() && vv_cols_[k][num_valid] < num_col)
+            ++num_valid;
+        MatSetValues(m_W, 1, &k, num_valid, vv_cols_[k].data(), vv_vals_[k].data(), INSERT_VALUES);
+    }
+    MatAssemblyBegin(m_W, MAT_FINAL_ASSEMBLY);
+    MatAssemblyEnd(m_W, MAT_FINAL_ASSEMBLY);
+
+    // - - - - - - scores of all the models for all the points - - - - - -
+    Mat m_scores;                               // num_points x num_models
+    MatMatTransposeMult(m_data, m_W, MAT_INITIAL_MATRIX, PETSC_DEFAULT, &m_scores);
+
+    PetscInt ncols;
+    const PetscInt    *cols;
+    const PetscScalar *vals;
+    std::vector<double> v_dec(num_models);
+    for(PetscInt i=0; i < num_points; i++){
+        for(PetscInt k=0; k < num_models; k++)
+            v_dec[k] = - v_rho_[k];             // a missing entry is a zero score
+        MatGetRow(m_scores, i, &ncols, &cols, &vals);
+        for(PetscInt j=0; j < ncols; j++)
+            v_dec[cols[j]] += vals[j];
+        MatRestoreRow(m_scores, i, &ncols, &cols, &vals);
+        for(PetscInt k=0; k < num_models; k++)
+            MatSetValue(m_predicted_label, v_row_id_[k], i, (v_dec[k] > 0) ? v_label_pos_[k] : v_label_neg_[k], INSERT_VALUES);
+    }
+    MatDestroy(&m_scores);
+    MatDestroy(&m_W);
+#if dbl_SV_predict_label1 >= 1
+    t_slm.stop_timer("[SLM][Predict] stacked linear models:", std::to_string(num_models));
+#endif
+}
@@ -0,0 +1,38 @@
+#ifndef STACKED_LINEAR_H
+#define STACKED_LINEAR_H
+
+#include "solver.h"
+#include <mutex>
+#include <vector>
+
+/*
+ * The linear models of the partition groups stacked in one sparse matrix W (a row per model)
+ * all the models are scored with one product data * W^T instead of a kernel evaluation per SV and model
+ * only the binary linear models with the weights (svm_build_linear_weights) can be added
+ */
+class StackedLinearModels{
+public:
+    // copy the weights of the model, the predictions are written in the row_id of the output matrix
+    // the partition groups add their models at the same time, hence the order of the models is not fixed
+    void add(int row_id, const svm_model * model);
+    bool empty() const { return v_row_id_.empty(); }
+    int  size() const { return v_row_id_.size(); }
+
+    /*
+     * m_data has the label in the 1st column (same layout as the test data)
+     * m_predicted_label gets the predicted label of point j by model i at (row_id of model i, j)
+     * it is not assembled here, the caller assembles it after all the models are predicted
+     */
+    void predict(Mat& m_data, Mat& m_predicted_label);
+
+private:
+    std::vector<int> v_row_id_;
+    std::vector<double> v_rho_;
+    std::vector<int> v_label_pos_;          // label for decision value > 0
+    std::vector<int> v_label_neg_;
+    std::vector<std::vector<PetscInt> > vv_cols_;      // nonzero weights of each model
+    std::vector<std::vector<PetscScalar> > vv_vals_;
+    std::mutex mtx_;                        // add
+};
+
+#endif // STACKED_LINEAR_H
@@ -7,6 +7,16 @@
 #include <stdarg.h>
 #include <limits.h>
 #include <locale.h>
+#include <map>
+#include <list>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "svm_weighted.h"
 #include "config_logs.h"
 
@@ -62,6 +72,218 @@ static void info(const char *fmt,...)
 static void info(const char *fmt,...) {}
 #endif
 
+//
+// parallel SMO: number of threads for the gradient update and the working set selection
+// problems with less than smo_parallel_threshold active variables stay serial
+//
+static int smo_num_threads = 1;
+static int smo_parallel_threshold = 8192;
+
+//
+// full kernel matrix: the C-SVC problems with at most full_kernel_max_size points compute
+// the whole Q up front (with smo_num_threads threads) and skip the LRU cache
+//
+static int full_kernel_max_size = 0;
+
+void svm_set_full_kernel(int max_size)
+{
+	full_kernel_max_size = max(max_size, 0);
+}
+
+//
+// parallel folds: svm_cross_validation and the internal cross validation of the probability estimates
+// train fold_num_threads folds at the same time, each one with a share of the cache
+// the folds are assigned before the parallel loop, a fold which needs random numbers inside (probability
+// estimates of a fold model) uses its own seed (drawn in order), so the results don't depend on the threads
+// the global rand() is not used: a cross validation outside a fold seeds a local generator from the problem
+// and the parameters, hence the concurrent trainings of the task pool don't share (or race on) a state
+//
+static int fold_num_threads = 1;
+static thread_local unsigned int *fold_rand_state = NULL;	// NULL: outside a cross validation
+
+void svm_set_fold_parallel(int num_threads)
+{
+#ifdef _OPENMP
+	fold_num_threads = max(num_threads, 1);
+#else
+	fold_num_threads = 1;	// compiled without OpenMP
+#endif
+}
+
+static int fold_rand()
+{
+	if(fold_rand_state == NULL)
+	{
+		fprintf(stderr,"[SVM] fold_rand is called outside a cross validation, Exit!\n");
+		exit(1);
+	}
+	return rand_r(fold_rand_state);
+}
+
+// the seed of a cross validation which is not inside a fold, the same problem and parameters get the same folds
+static unsigned int fold_base_seed(const svm_problem *prob, const svm_parameter *param, int nr_fold)
+{
+	unsigned long int h = 14695981039346656037UL;	// FNV-1a
+	const double values[] = {(double) prob->l, (double) nr_fold, (double) param->svm_type, (double) param->kernel_type,
+							 param->C, param->gamma, param->nu, param->p, (double) param->degree, param->coef0};
+	const unsigned char *bytes = (const unsigned char *) values;
+	for(size_t i=0;i<sizeof(values);i++)
+		h = (h ^ bytes[i]) * 1099511628211UL;
+	return (unsigned int) (h ^ (h >> 32));
+}
+
+void svm_set_smo_parallel(int num_threads, int min_active_size)
+{
+#ifdef _OPENMP
+	smo_num_threads = max(num_threads, 1);
+#else
+	smo_num_threads = 1;	// compiled without OpenMP
+#endif
+	smo_parallel_threshold = max(min_active_size, 2);
+}
+
+//
+// Cache arena
+//
+// one memory budget (in bytes) for all the kernel caches of the process (concurrent trainings)
+// each cache asks for its demand (the smaller of the requested size and the whole Q matrix)
+// and its floor (the head array and two columns, a training can't run with less),
+// the floors are reserved first and the rest of the budget is shared in proportion to
+// the demand and the miss rate of each cache,
+// the shares are recomputed when a cache registers, leaves or reports its statistics
+// and published in the grant of each cache, which applies it at its next miss
+// a cache waits to register while the floors of the others leave no room for its own
+// budget 0 disables the arena, then each cache uses its requested size
+//
+class Cache_arena
+{
+public:
+	static Cache_arena& instance()
+	{
+		static Cache_arena arena;
+		return arena;
+	}
+
+	void set_budget(long int budget_)
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		budget = budget_;
+		rebalance();
+		cv.notify_all();
+	}
+	bool enabled() const { return budget > 0; }
+
+	// the granted size in bytes is published in grant (also later, when the shares change)
+	void register_cache(const void *owner, long int demand, long int floor, std::atomic<long int> *grant)
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		// a single cache is always admitted, otherwise the training could never run
+		cv.wait(lock, [&]{ return entries.empty() || sum_floor + floor <= budget; });
+		if(entries.empty() && floor > budget)
+			info("cache arena: the floor of a cache (%ld bytes) exceeds the budget (%ld bytes)\n", floor, budget);
+		entry_t e;
+		e.demand = max(demand, floor);
+		e.floor = floor;
+		e.miss_rate = 1;	// unknown yet, assume a cold cache
+		e.grant = grant;
+		entries[owner] = e;
+		sum_floor += floor;
+		rebalance();
+	}
+
+	void unregister_cache(const void *owner)
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		std::map<const void *, entry_t>::iterator it = entries.find(owner);
+		if(it == entries.end())
+			return;
+		sum_floor -= it->second.floor;
+		entries.erase(it);
+		rebalance();
+		cv.notify_all();
+	}
+
+	// update the statistics of a cache, its new share is published in its grant
+	void report(const void *owner, long int hits, long int misses)
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		std::map<const void *, entry_t>::iterator it = entries.find(owner);
+		if(it == entries.end())
+			return;
+		if(hits + misses > 0)
+			it->second.miss_rate = (double) misses / (double)(hits + misses);
+		rebalance();
+	}
+private:
+	struct entry_t
+	{
+		long int demand;
+		long int floor;
+		double miss_rate;
+		std::atomic<long int> *grant;
+	};
+
+	Cache_arena():budget(0),sum_floor(0) {}
+
+	// water filling over the budget above the floors: the caches which need less than their share
+	// get their demand, the rest is divided between the others by weight
+	void rebalance()
+	{
+		if(budget <= 0 || entries.empty())
+			return;
+		std::map<const void *, long int> share_of;
+		for(std::map<const void *, entry_t>::iterator it = entries.begin(); it != entries.end(); ++it)
+			share_of[it->first] = 0;
+		std::map<const void *, bool> done;
+		long int remain = max(budget - sum_floor, 0L);
+		bool changed = true;
+		while(changed)
+		{
+			changed = false;
+			double sum_weight = 0;
+			for(std::map<const void *, entry_t>::iterator it = entries.begin(); it != entries.end(); ++it)
+				if(!done.count(it->first))
+					sum_weight += weight(it->second);
+			if(sum_weight <= 0)
+				break;
+			for(std::map<const void *, entry_t>::iterator it = entries.begin(); it != entries.end(); ++it)
+			{
+				if(done.count(it->first))
+					continue;
+				long int extra = it->second.demand - it->second.floor;
+				double share = remain * weight(it->second) / sum_weight;
+				if(share >= extra)
+				{
+					share_of[it->first] = extra;
+					remain -= extra;
+					done[it->first] = true;
+					changed = true;
+					break;		// the shares of the others are changed
+				}
+				share_of[it->first] = (long int) share;
+			}
+		}
+		for(std::map<const void *, entry_t>::iterator it = entries.begin(); it != entries.end(); ++it)
+			it->second.grant->store(it->second.floor + share_of[it->first], std::memory_order_relaxed);
+	}
+
+	static double weight(const entry_t& e)
+	{
+		return (double) (e.demand - e.floor) * (0.5 + e.miss_rate);
+	}
+
+	std::mutex mtx;
+	std::condition_variable cv;
+	long int budget;
+	long int sum_floor;			// reserved by the registered caches
+	std::map<const void *, entry_t> entries;
+};
+
+void svm_cache_arena_set_budget(double size_mb)
+{
+	Cache_arena::instance().set_budget((long int)(size_mb*(1<<20)));
+}
+
 //
 // Kernel Cache
 //
@@ -79,6 +301,7 @@ public:
 	// (p >= len if nothing needs to be filled)
 	int get_data(const int index, Qfloat **data, int len);
 	void swap_index(int i, int j);
+	void add_stats(svm_cache_stats *stats) const;
 private:
 	int l;
 	long int size;
@@ -93,14 +316,37 @@ private:
 	head_t lru_head;
 	void lru_delete(head_t *h);
 	void lru_insert(head_t *h);
+
+	// statistics and the granted size from the arena (limit in Qfloat, grant in bytes)
+	long int limit;
+	long int hits, misses, evictions;
+	long int peak_used;
+	bool in_arena;
+	std::atomic<long int> grant;		// set by the arena, applied at the next miss
+	long int applied_grant;
+	void evict_lru();
+	void update_limit(long int size_in_bytes);
 };
 
-Cache::Cache(int l_,long int size_):l(l_),size(size_)
+Cache::Cache(int l_,long int size_):l(l_),size(size_),limit(0),hits(0),misses(0),evictions(0),peak_used(0),in_arena(false),
+	grant(0),applied_grant(0)
 {
 	head = (head_t *)calloc(l,sizeof(head_t));	// initialized to 0
+	Cache_arena& arena = Cache_arena::instance();
+	if(arena.enabled())
+	{
+		// no need to ask for more than the whole matrix, the cache must be large enough for two columns
+		long int head_bytes = l * (long int) sizeof(head_t);
+		long int demand = min(size, (long int) l * l * (long int) sizeof(Qfloat) + head_bytes);
+		long int floor = 2 * (long int) l * (long int) sizeof(Qfloat) + head_bytes;
+		arena.register_cache(this, demand, floor, &grant);
+		size = applied_grant = grant.load(std::memory_order_relaxed);
+		in_arena = true;
+	}
 	size /= sizeof(Qfloat);
 	size -= l * sizeof(head_t) / sizeof(Qfloat);
-	size = max(size, 2 * (long int) l);	// cache must be large enough for two columns
+	size = max(size, 2 * (long int) l);	// cache must be large enough for two columns (counted by the arena)
+	limit = size;
 	lru_head.next = lru_head.prev = &lru_head;
 }
 
@@ -109,6 +355,38 @@ Cache::~Cache()
 	for(head_t *h = lru_head.next; h != &lru_head; h=h->next)
 		free(h->data);
 	free(head);
+	if(in_arena)
+		Cache_arena::instance().unregister_cache(this);
+}
+
+void Cache::evict_lru()
+{
+	head_t *old = lru_head.next;
+	lru_delete(old);
+	free(old->data);
+	size += old->len;
+	old->data = 0;
+	old->len = 0;
+	++evictions;
+}
+
+// apply a new granted size, shrinking frees the least recently used columns
+void Cache::update_limit(long int size_in_bytes)
+{
+	long int new_limit = size_in_bytes / sizeof(Qfloat) - l * sizeof(head_t) / sizeof(Qfloat);
+	new_limit = max(new_limit, 2 * (long int) l);
+	size += new_limit - limit;
+	limit = new_limit;
+	while(size < 0 && lru_head.next != &lru_head)
+		evict_lru();
+}
+
+void Cache::add_stats(svm_cache_stats *stats) const
+{
+	stats->hits += hits;
+	stats->misses += misses;
+	stats->evictions += evictions;
+	stats->bytes = max(stats->bytes, peak_used * (long int) sizeof(Qfloat));
 }
 
 void Cache::lru_delete(head_t *h)
@@ -129,28 +407,39 @@ void Cache::lru_insert(head_t *h)
 
 int Cache::get_data(const int index, Qfloat **data, int len)
 {
+	if(in_arena)
+	{
+		// a smaller share is applied at once (also by a warm cache which doesn't miss)
+		long int new_grant = grant.load(std::memory_order_relaxed);
+		if(new_grant != applied_grant)
+		{
+			applied_grant = new_grant;
+			update_limit(new_grant);
+		}
+	}
 	head_t *h = &head[index];
 	if(h->len) lru_delete(h);
 	int more = len - h->len;
 
 	if(more > 0)
 	{
+		++misses;
+		// report the statistics once in a while (every l misses), the arena may change the grants
+		if(in_arena && misses % l == 0)
+			Cache_arena::instance().report(this, hits, misses);
+
 		// free old space
 		while(size < more)
-		{
-			head_t *old = lru_head.next;
-			lru_delete(old);
-			free(old->data);
-			size += old->len;
-			old->data = 0;
-			old->len = 0;
-		}
+			evict_lru();
 
 		// allocate new space
 		h->data = (Qfloat *)realloc(h->data,sizeof(Qfloat)*len);
 		size -= more;
+		peak_used = max(peak_used, limit - size);
 		swap(h->len,len);
 	}
+	else
+		++hits;
 
 	lru_insert(h);
 	*data = h->data;
@@ -183,8 +472,230 @@ void Cache::swap_index(int i, int j)
 				size += h->len;
 				h->data = 0;
 				h->len = 0;
+				++evictions;
+			}
+		}
+	}
+}
+
+//
+// Shared kernel cache
+//
+// the ids of the points are mapped to the slots 0..n-1 (e.g. the points of the partition groups of a level,
+// not all the points of the level), size is the cache size limit in bytes
+// a row holds K(id,all the slots) for a set of kernel parameters, entries which are not computed yet are NAN,
+// rows are evicted in LRU order
+// the trainings may run at the same time (the task pool): a row is locked by a training from acquire_row to
+// release_row (the others wait for it, they need the same values), the locked rows are not evicted
+//
+struct svm_kernel_cache
+{
+public:
+	struct row_key
+	{
+		int kernel_type;
+		int degree;
+		double gamma;
+		double coef0;
+		int id;
+		bool operator < (const row_key& other) const
+		{
+			if(kernel_type != other.kernel_type) return kernel_type < other.kernel_type;
+			if(degree != other.degree) return degree < other.degree;
+			if(gamma != other.gamma) return gamma < other.gamma;
+			if(coef0 != other.coef0) return coef0 < other.coef0;
+			return id < other.id;
+		}
+	};
+	struct row_t
+	{
+		row_key key;
+		Qfloat *data;
+		int pins;		// trainings which acquired the row (not evicted if positive)
+		std::mutex lock;	// held by the training which fills the row
+	};
+
+	svm_kernel_cache(int num_ids, const int *ids, int n, long int size);
+	~svm_kernel_cache();
+
+	// slot of the point id, -1 if the id is not in the cache
+	int slot_of(int id) const { return (id >= 0 && id < (int) slot.size()) ? slot[id] : -1; }
+	// the row of the slot for the kernel parameters (allocated if needed), locked until release_row
+	row_t *acquire_row(const svm_parameter& param, int row_slot);
+	void release_row(row_t *row);
+private:
+	int n;
+	long int size;		// remaining number of Qfloat
+	std::vector<int> slot;	// id -> slot
+	std::mutex mtx;		// the list and the map
+	std::list<row_t> lru;	// least recently used in the front
+	std::map<row_key, std::list<row_t>::iterator> rows;
+};
+
+svm_kernel_cache::svm_kernel_cache(int num_ids, const int *ids, int n_, long int size_):n(n_),size(size_)
+{
+	slot.assign(num_ids,-1);
+	for(int k=0;k<n;k++)
+		slot[(ids != NULL) ? ids[k] : k] = k;
+	size /= sizeof(Qfloat);
+	size = max(size, 2 * (long int) n);	// at least two rows
+}
+
+svm_kernel_cache::~svm_kernel_cache()
+{
+	for(std::list<row_t>::iterator it = lru.begin(); it != lru.end(); ++it)
+		free(it->data);
+}
+
+svm_kernel_cache::row_t *svm_kernel_cache::acquire_row(const svm_parameter& param, int row_slot)
+{
+	row_key key;
+	key.kernel_type = param.kernel_type;
+	key.degree = param.degree;
+	key.gamma = param.gamma;
+	key.coef0 = param.coef0;
+	key.id = row_slot;
+
+	row_t *row;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		std::map<row_key, std::list<row_t>::iterator>::iterator found = rows.find(key);
+		if(found != rows.end())
+		{
+			lru.splice(lru.end(), lru, found->second);	// move to the most recent position
+			row = &*found->second;
+		}
+		else
+		{
+			// free old rows which no training holds, the limit is exceeded if all of them are held
+			std::list<row_t>::iterator it = lru.begin();
+			while(size < n && it != lru.end())
+			{
+				if(it->pins > 0)
+				{
+					++it;
+					continue;
+				}
+				rows.erase(it->key);
+				free(it->data);
+				it = lru.erase(it);
+				size += n;
 			}
+
+			lru.emplace_back();
+			row = &lru.back();
+			row->key = key;
+			row->data = Malloc(Qfloat,n);
+			row->pins = 0;
+			for(int j=0;j<n;j++)
+				row->data[j] = NAN;
+			size -= n;
+			rows[key] = --lru.end();
 		}
+		++row->pins;
+	}
+	row->lock.lock();
+	return row;
+}
+
+void svm_kernel_cache::release_row(row_t *row)
+{
+	row->lock.unlock();
+	std::lock_guard<std::mutex> lock(mtx);
+	--row->pins;
+}
+
+svm_kernel_cache *svm_kernel_cache_create(int num_points, double size_mb)
+{
+	return new svm_kernel_cache(num_points, NULL, num_points, (long int)(size_mb*(1<<20)));
+}
+
+svm_kernel_cache *svm_kernel_cache_create_ids(int num_points, const int *ids, int num_ids, double size_mb)
+{
+	return new svm_kernel_cache(num_points, ids, num_ids, (long int)(size_mb*(1<<20)));
+}
+
+void svm_kernel_cache_destroy(svm_kernel_cache **cache_ptr_ptr)
+{
+	if(cache_ptr_ptr != NULL && *cache_ptr_ptr != NULL)
+	{
+		delete *cache_ptr_ptr;
+		*cache_ptr_ptr = NULL;
+	}
+}
+
+//
+// Single precision rows
+//
+// mixed precision: the training kernels are computed from dense float copies of the features
+// instead of the sparse double rows, the gradients of the solver and the prediction stay in double
+//
+struct svm_single_rows
+{
+	int l;
+	int dim;
+	float **rows;
+	float *space;		// NULL for a view of other rows
+};
+
+// float rows of x, NULL for sparse data (the dense rows would be larger than the sparse ones)
+static svm_single_rows *single_rows_build(int l, const svm_node * const *x)
+{
+	long int nnz = 0;
+	int dim = 0;
+	for(int i=0;i<l;i++)
+		for(const svm_node *px = x[i]; px->index != -1; ++px)
+		{
+			if(px->index < 1)
+				return NULL;
+			++nnz;
+			dim = max(dim, px->index);
+		}
+	if(l == 0 || dim == 0 || 2 * nnz < (long int) l * dim)
+	{
+		info("mixed precision is skipped for sparse data\n");
+		return NULL;
+	}
+
+	svm_single_rows *single_rows = new svm_single_rows;
+	single_rows->l = l;
+	single_rows->dim = dim;
+	single_rows->space = (float *)calloc((size_t) l * dim, sizeof(float));
+	single_rows->rows = new float*[l];
+	for(int i=0;i<l;i++)
+	{
+		single_rows->rows[i] = single_rows->space + (long int) i * dim;
+		for(const svm_node *px = x[i]; px->index != -1; ++px)
+			single_rows->rows[i][px->index - 1] = (float) px->value;	// index starts from 1
+	}
+	return single_rows;
+}
+
+svm_single_rows *svm_single_rows_create(const svm_problem *prob)
+{
+	return single_rows_build(prob->l, prob->x);
+}
+
+svm_single_rows *svm_single_rows_select(const svm_single_rows *full, const int *ids, int l)
+{
+	svm_single_rows *single_rows = new svm_single_rows;
+	single_rows->l = l;
+	single_rows->dim = full->dim;
+	single_rows->space = NULL;
+	single_rows->rows = new float*[l];
+	for(int i=0;i<l;i++)
+		single_rows->rows[i] = full->rows[ids[i]];
+	return single_rows;
+}
+
+void svm_single_rows_destroy(svm_single_rows **rows_ptr_ptr)
+{
+	if(rows_ptr_ptr != NULL && *rows_ptr_ptr != NULL)
+	{
+		delete[] (*rows_ptr_ptr)->rows;
+		free((*rows_ptr_ptr)->space);
+		delete *rows_ptr_ptr;
+		*rows_ptr_ptr = NULL;
 	}
 }
 
@@ -205,26 +716,79 @@ public:
 
 class Kernel: public QMatrix {
 public:
-	Kernel(int l, svm_node * const * x, const svm_parameter& param);
+	// single_precision uses the float rows (shared by the caller, otherwise built here) instead of x
+	Kernel(int l, svm_node * const * x, const svm_parameter& param,
+	       int single_precision = 0, const svm_single_rows *single_rows = NULL);
 	virtual ~Kernel();
 
 	static double k_function(const svm_node *x, const svm_node *y,
 				 const svm_parameter& param);
+	// kernel values of x and the l SVs, the kernel type is dispatched once for all the SVs
+	static void k_function_row(const svm_node *x, const svm_node * const *SV, int l,
+				   const svm_parameter& param, double *kvalue);
+	static double k_function_rbf(const svm_node *x, const svm_node *y, const svm_parameter& param)
+	{
+		return k_function_t<RBF>(x,y,param);
+	}
 	virtual Qfloat *get_Q(int column, int len) const = 0;
 	virtual double *get_QD() const = 0;
 	virtual void swap_index(int i, int j) const	// no so const...
 	{
-		swap(x[i],x[j]);
+		if(x) swap(x[i],x[j]);
 		if(x_square) swap(x_square[i],x_square[j]);
+		if(xf) swap(xf[i],xf[j]);
 	}
 protected:
 
 	double (Kernel::*kernel_function)(int i, int j) const;
+	// data[j] = K(i,j) for start <= j < len, multiplied by y[i]*y[j] if y is not NULL
+	// the kernel type is a template parameter, so there is one indirect call per row instead of per entry
+	void (Kernel::*kernel_row)(int i, int start, int len, Qfloat *data, const schar *y) const;
 
 private:
 	const svm_node **x;
 	double *x_square;
 
+	// single precision dense rows for the mixed precision mode (NULL otherwise), x and x_square are NULL then
+	float **xf;
+	int xf_dim;
+	svm_single_rows *own_rows;	// built here if the caller didn't share the rows
+	static float dot_f(const float *px, const float *py, int n)
+	{
+		float sum = 0;
+#pragma omp simd reduction(+:sum)
+		for(int k=0;k<n;k++)
+			sum += px[k] * py[k];
+		return sum;
+	}
+	static float dist_f(const float *px, const float *py, int n)
+	{
+		float sum = 0;
+#pragma omp simd reduction(+:sum)
+		for(int k=0;k<n;k++)
+		{
+			float d = px[k] - py[k];
+			sum += d * d;
+		}
+		return sum;
+	}
+	double kernel_linear_f(int i, int j) const
+	{
+		return dot_f(xf[i],xf[j],xf_dim);
+	}
+	double kernel_poly_f(int i, int j) const
+	{
+		return powi(gamma*dot_f(xf[i],xf[j],xf_dim)+coef0,degree);
+	}
+	double kernel_rbf_f(int i, int j) const
+	{
+		return exp(-gamma*dist_f(xf[i],xf[j],xf_dim));
+	}
+	double kernel_sigmoid_f(int i, int j) const
+	{
+		return tanh(gamma*dot_f(xf[i],xf[j],xf_dim)+coef0);
+	}
+
 	// svm_parameter
 	const int kernel_type;
 	const int degree;
@@ -252,47 +816,115 @@ private:
 	{
 		return x[i][(int)(x[j][0].value)].value;
 	}
+
+	// the switch is resolved at compile time and the kernel functions are inlined
+	template<int kt, bool single> double kernel_eval(int i, int j) const
+	{
+		switch(kt)
+		{
+			case LINEAR:
+				return single ? kernel_linear_f(i,j) : kernel_linear(i,j);
+			case POLY:
+				return single ? kernel_poly_f(i,j) : kernel_poly(i,j);
+			case RBF:
+				return single ? kernel_rbf_f(i,j) : kernel_rbf(i,j);
+			case SIGMOID:
+				return single ? kernel_sigmoid_f(i,j) : kernel_sigmoid(i,j);
+			default:
+				return kernel_precomputed(i,j);
+		}
+	}
+	template<int kt, bool single> void kernel_row_t(int i, int start, int len, Qfloat *data, const schar *y) const
+	{
+		if(y != NULL)
+		{
+			const double yi = y[i];
+			for(int j=start;j<len;j++)
+				data[j] = (Qfloat)(yi*y[j]*kernel_eval<kt,single>(i,j));
+		}
+		else
+			for(int j=start;j<len;j++)
+				data[j] = (Qfloat)kernel_eval<kt,single>(i,j);
+	}
+	template<bool single> void select_kernel_functions();
+
+	template<int kt> static double k_function_t(const svm_node *x, const svm_node *y,
+						   const svm_parameter& param);
+	template<int kt> static void k_function_row_t(const svm_node *x, const svm_node * const *SV, int l,
+						     const svm_parameter& param, double *kvalue)
+	{
+		for(int i=0;i<l;i++)
+			kvalue[i] = k_function_t<kt>(x,SV[i],param);
+	}
 };
 
-Kernel::Kernel(int l, svm_node * const * x_, const svm_parameter& param)
-:kernel_type(param.kernel_type), degree(param.degree),
- gamma(param.gamma), coef0(param.coef0)
+template<bool single> void Kernel::select_kernel_functions()
 {
 	switch(kernel_type)
 	{
 		case LINEAR:
-			kernel_function = &Kernel::kernel_linear;
+			kernel_function = &Kernel::kernel_eval<LINEAR,single>;
+			kernel_row = &Kernel::kernel_row_t<LINEAR,single>;
 			break;
 		case POLY:
-			kernel_function = &Kernel::kernel_poly;
+			kernel_function = &Kernel::kernel_eval<POLY,single>;
+			kernel_row = &Kernel::kernel_row_t<POLY,single>;
 			break;
 		case RBF:
-			kernel_function = &Kernel::kernel_rbf;
+			kernel_function = &Kernel::kernel_eval<RBF,single>;
+			kernel_row = &Kernel::kernel_row_t<RBF,single>;
 			break;
 		case SIGMOID:
-			kernel_function = &Kernel::kernel_sigmoid;
+			kernel_function = &Kernel::kernel_eval<SIGMOID,single>;
+			kernel_row = &Kernel::kernel_row_t<SIGMOID,single>;
 			break;
 		case PRECOMPUTED:
-			kernel_function = &Kernel::kernel_precomputed;
+			kernel_function = &Kernel::kernel_eval<PRECOMPUTED,false>;
+			kernel_row = &Kernel::kernel_row_t<PRECOMPUTED,false>;
 			break;
 	}
+}
 
-	clone(x,x_,l);
+Kernel::Kernel(int l, svm_node * const * x_, const svm_parameter& param,
+	       int single_precision, const svm_single_rows *single_rows)
+:kernel_type(param.kernel_type), degree(param.degree),
+ gamma(param.gamma), coef0(param.coef0)
+{
+	x = NULL;
+	x_square = NULL;
+	xf = NULL;
+	xf_dim = 0;
+	own_rows = NULL;
+	if(single_precision && kernel_type != PRECOMPUTED)
+	{
+		if(single_rows == NULL)
+			single_rows = own_rows = single_rows_build(l, x_);
+		if(single_rows != NULL)
+		{
+			// the row pointers are swapped by the solver, the float data is shared
+			clone(xf,single_rows->rows,l);
+			xf_dim = single_rows->dim;
+			select_kernel_functions<true>();	// dense rows
+			return;
+		}
+	}
 
+	clone(x,x_,l);
+	select_kernel_functions<false>();		// sparse rows
 	if(kernel_type == RBF)
 	{
 		x_square = new double[l];
 		for(int i=0;i<l;i++)
 			x_square[i] = dot(x[i],x[i]);
 	}
-	else
-		x_square = 0;
 }
 
 Kernel::~Kernel()
 {
 	delete[] x;
 	delete[] x_square;
+	delete[] xf;
+	svm_single_rows_destroy(&own_rows);
 }
 
 double Kernel::dot(const svm_node *px, const svm_node *py)
@@ -317,10 +949,10 @@ double Kernel::dot(const svm_node *px, const svm_node *py)
 	return sum;
 }
 
-double Kernel::k_function(const svm_node *x, const svm_node *y,
-			  const svm_parameter& param)
+template<int kt> double Kernel::k_function_t(const svm_node *x, const svm_node *y,
+				      const svm_parameter& param)
 {
-	switch(param.kernel_type)
+	switch(kt)
 	{
 		case LINEAR:
 			return dot(x,y);
@@ -376,6 +1008,52 @@ double Kernel::k_function(const svm_node *x, const svm_node *y,
 	}
 }
 
+double Kernel::k_function(const svm_node *x, const svm_node *y,
+			  const svm_parameter& param)
+{
+	switch(param.kernel_type)
+	{
+		case LINEAR:
+			return k_function_t<LINEAR>(x,y,param);
+		case POLY:
+			return k_function_t<POLY>(x,y,param);
+		case RBF:
+			return k_function_t<RBF>(x,y,param);
+		case SIGMOID:
+			return k_function_t<SIGMOID>(x,y,param);
+		case PRECOMPUTED:
+			return k_function_t<PRECOMPUTED>(x,y,param);
+		default:
+			return 0;  // Unreachable 
+	}
+}
+
+void Kernel::k_function_row(const svm_node *x, const svm_node * const *SV, int l,
+			    const svm_parameter& param, double *kvalue)
+{
+	switch(param.kernel_type)
+	{
+		case LINEAR:
+			k_function_row_t<LINEAR>(x,SV,l,param,kvalue);
+			break;
+		case POLY:
+			k_function_row_t<POLY>(x,SV,l,param,kvalue);
+			break;
+		case RBF:
+			k_function_row_t<RBF>(x,SV,l,param,kvalue);
+			break;
+		case SIGMOID:
+			k_function_row_t<SIGMOID>(x,SV,l,param,kvalue);
+			break;
+		case PRECOMPUTED:
+			k_function_row_t<PRECOMPUTED>(x,SV,l,param,kvalue);
+			break;
+		default:
+			for(int i=0;i<l;i++)
+				kvalue[i] = 0;
+	}
+}
+
 // An SMO algorithm in Fan et al., JMLR 6(2005), p. 1889--1918
 // Solves:
 //
@@ -409,6 +1087,7 @@ public:
 	void Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 		   double *alpha_, const double* C_, double eps,
 		   SolutionInfo* si, int shrinking);
+	void add_stats(svm_solver_stats *stats) const;
 protected:
 	int active_size;
 	schar *y;
@@ -426,30 +1105,203 @@ protected:
 	double *G_bar;		// gradient, if we treat free variables as 0
 	int l;
 	bool unshrink;	// XXX
+	int num_iter;		// statistics of the last Solve
+	int num_shrink;
+	int num_reconstruct;
+	bool max_iter_reached;
+
+	double get_C(int i)
+	{
+		return C[i];
+	}
+	void update_alpha_status(int i)
+	{
+		if(alpha[i] >= get_C(i))
+			alpha_status[i] = UPPER_BOUND;
+		else if(alpha[i] <= 0)
+			alpha_status[i] = LOWER_BOUND;
+		else alpha_status[i] = FREE;
+	}
+	bool is_upper_bound(int i) { return alpha_status[i] == UPPER_BOUND; }
+	bool is_lower_bound(int i) { return alpha_status[i] == LOWER_BOUND; }
+	bool is_free(int i) { return alpha_status[i] == FREE; }
+	void swap_index(int i, int j);
+	void reconstruct_gradient();
+	virtual int select_working_set(int &i, int &j);
+	virtual double calculate_rho();
+	virtual void do_shrinking();
+
+	// parallel SMO, the first half of the working set selection (i) is done together with the gradient update
+	bool use_parallel() const { return smo_num_threads > 1 && active_size >= smo_parallel_threshold; }
+	void update_gradient_select_i(const Qfloat *Q_i, const Qfloat *Q_j, double delta_alpha_i, double delta_alpha_j);
+	void parallel_select_j(int i, const Qfloat *Q_i, double Gmax, double &Gmax2, int &Gmin_idx);
+	bool fused_valid;	// fused_Gmax, fused_Gmax_idx are valid for the current G and active set
+	double fused_Gmax;
+	int fused_Gmax_idx;
+	// the per thread results of the reductions, allocated once per Solve
+	int t_size;
+	double *t_value;	// 2*t_size, the maximum gradient (and the minimum objective change) of each thread
+	int *t_idx;
+private:
+	bool be_shrunk(int i, double Gmax1, double Gmax2);
+};
+
+//
+// G[k] += Q_i[k]*delta_alpha_i + Q_j[k]*delta_alpha_j for the active set and find
+// the i of the next working set in the same pass, each thread reduces its own contiguous block
+// ties are broken toward the larger index like the serial loop
+//
+void Solver::update_gradient_select_i(const Qfloat *Q_i, const Qfloat *Q_j, double delta_alpha_i, double delta_alpha_j)
+{
+	int num_threads = min(t_size, active_size);
+	double *t_Gmax = t_value;
+	int *t_Gmax_idx = t_idx;
+
+#pragma omp parallel num_threads(num_threads)
+	{
+#ifdef _OPENMP
+		int tid = omp_get_thread_num();
+		int nt = omp_get_num_threads();
+#else
+		int tid = 0;
+		int nt = 1;
+#endif
+		int begin = (int)((long int) active_size * tid / nt);
+		int end = (int)((long int) active_size * (tid + 1) / nt);
+		double *G_ = G;
+
+		if(Q_i != NULL)		// NULL: only the selection
+		{
+#pragma omp simd
+			for(int k=begin;k<end;k++)
+				G_[k] += Q_i[k]*delta_alpha_i + Q_j[k]*delta_alpha_j;
+		}
+
+		double Gmax = -INF;
+		int Gmax_idx = -1;
+		for(int t=begin;t<end;t++)
+			if(y[t]==+1)
+			{
+				if(!is_upper_bound(t))
+					if(-G[t] >= Gmax)
+					{
+						Gmax = -G[t];
+						Gmax_idx = t;
+					}
+			}
+			else
+			{
+				if(!is_lower_bound(t))
+					if(G[t] >= Gmax)
+					{
+						Gmax = G[t];
+						Gmax_idx = t;
+					}
+			}
+		t_Gmax[tid] = Gmax;
+		t_Gmax_idx[tid] = Gmax_idx;
+		if(tid == 0)
+			for(int t=nt;t<num_threads;t++)		// fewer threads than requested
+				t_Gmax_idx[t] = -1;
+	}
+
+	fused_Gmax = -INF;
+	fused_Gmax_idx = -1;
+	for(int t=0;t<num_threads;t++)
+		if(t_Gmax_idx[t] != -1 && t_Gmax[t] >= fused_Gmax)
+		{
+			fused_Gmax = t_Gmax[t];
+			fused_Gmax_idx = t_Gmax_idx[t];
+		}
+	fused_valid = true;
+}
+
+//
+// second half of the working set selection (j) with per thread reductions
+//
+void Solver::parallel_select_j(int i, const Qfloat *Q_i, double Gmax, double &Gmax2_out, int &Gmin_idx_out)
+{
+	int num_threads = min(t_size, active_size);
+	double *t_Gmax2 = t_value;
+	double *t_obj_diff_min = t_value + t_size;
+	int *t_Gmin_idx = t_idx;
+	for(int t=0;t<num_threads;t++)
+	{
+		t_Gmax2[t] = -INF;
+		t_obj_diff_min[t] = INF;
+		t_Gmin_idx[t] = -1;
+	}
 
-	double get_C(int i)
+#pragma omp parallel num_threads(num_threads)
 	{
-		return C[i];
+#ifdef _OPENMP
+		int tid = omp_get_thread_num();
+		int nt = omp_get_num_threads();
+#else
+		int tid = 0;
+		int nt = 1;
+#endif
+		int begin = (int)((long int) active_size * tid / nt);
+		int end = (int)((long int) active_size * (tid + 1) / nt);
+		double Gmax2 = -INF;
+		double obj_diff_min = INF;
+		int Gmin_idx = -1;
+
+		for(int j=begin;j<end;j++)
+		{
+			double grad_diff, quad_coef;
+			if(y[j]==+1)
+			{
+				if(is_lower_bound(j))
+					continue;
+				grad_diff = Gmax+G[j];
+				if (G[j] >= Gmax2)
+					Gmax2 = G[j];
+				quad_coef = QD[i]+QD[j]-2.0*y[i]*Q_i[j];
+			}
+			else
+			{
+				if(is_upper_bound(j))
+					continue;
+				grad_diff = Gmax-G[j];
+				if (-G[j] >= Gmax2)
+					Gmax2 = -G[j];
+				quad_coef = QD[i]+QD[j]+2.0*y[i]*Q_i[j];
+			}
+			if (grad_diff > 0)
+			{
+				double obj_diff;
+				if (quad_coef > 0)
+					obj_diff = -(grad_diff*grad_diff)/quad_coef;
+				else
+					obj_diff = -(grad_diff*grad_diff)/TAU;
+
+				if (obj_diff <= obj_diff_min)
+				{
+					Gmin_idx=j;
+					obj_diff_min = obj_diff;
+				}
+			}
+		}
+		t_Gmax2[tid] = Gmax2;
+		t_obj_diff_min[tid] = obj_diff_min;
+		t_Gmin_idx[tid] = Gmin_idx;
 	}
-	void update_alpha_status(int i)
+
+	Gmax2_out = -INF;
+	Gmin_idx_out = -1;
+	double obj_diff_min = INF;
+	for(int t=0;t<num_threads;t++)
 	{
-		if(alpha[i] >= get_C(i))
-			alpha_status[i] = UPPER_BOUND;
-		else if(alpha[i] <= 0)
-			alpha_status[i] = LOWER_BOUND;
-		else alpha_status[i] = FREE;
+		if(t_Gmax2[t] >= Gmax2_out)
+			Gmax2_out = t_Gmax2[t];
+		if(t_Gmin_idx[t] != -1 && t_obj_diff_min[t] <= obj_diff_min)
+		{
+			Gmin_idx_out = t_Gmin_idx[t];
+			obj_diff_min = t_obj_diff_min[t];
+		}
 	}
-	bool is_upper_bound(int i) { return alpha_status[i] == UPPER_BOUND; }
-	bool is_lower_bound(int i) { return alpha_status[i] == LOWER_BOUND; }
-	bool is_free(int i) { return alpha_status[i] == FREE; }
-	void swap_index(int i, int j);
-	void reconstruct_gradient();
-	virtual int select_working_set(int &i, int &j);
-	virtual double calculate_rho();
-	virtual void do_shrinking();
-private:
-	bool be_shrunk(int i, double Gmax1, double Gmax2);
-};
+}
 
 void Solver::swap_index(int i, int j)
 {
@@ -469,6 +1321,7 @@ void Solver::reconstruct_gradient()
 	// reconstruct inactive elements of G from G_bar and free variables
 
 	if(active_size == l) return;
+	++num_reconstruct;
 
 	int i,j;
 	int nr_free = 0;
@@ -519,6 +1372,10 @@ void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 	clone(C,C_,l);
 	this->eps = eps;
 	unshrink = false;
+	fused_valid = false;
+	t_size = max(smo_num_threads, 1);
+	t_value = new double[2*t_size];
+	t_idx = new int[t_size];
 
 	// initialize alpha_status
 	{
@@ -564,6 +1421,8 @@ void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 	int iter = 0;
 	int max_iter = max(10000000, l>INT_MAX/100 ? INT_MAX : 100*l);
 	int counter = min(l,1000)+1;
+	num_shrink = 0;
+	num_reconstruct = 0;
 	
 	while(iter < max_iter)
 	{
@@ -572,8 +1431,13 @@ void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 		if(--counter == 0)
 		{
 			counter = min(l,1000);
-			if(shrinking) do_shrinking();
+			if(shrinking)
+			{
+				do_shrinking();
+				++num_shrink;
+			}
 			info(".");
+			fused_valid = false;	// the active set may be changed
 		}
 
 		int i,j;
@@ -584,6 +1448,7 @@ void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 			// reset active set size and check
 			active_size = l;
 			info("*");
+			fused_valid = false;
 			if(select_working_set(i,j)!=0)
 				break;
 			else
@@ -694,19 +1559,30 @@ void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 
 		double delta_alpha_i = alpha[i] - old_alpha_i;
 		double delta_alpha_j = alpha[j] - old_alpha_j;
+		bool ui = is_upper_bound(i);
+		bool uj = is_upper_bound(j);
 		
-		for(int k=0;k<active_size;k++)
+		if(use_parallel())
 		{
-			G[k] += Q_i[k]*delta_alpha_i + Q_j[k]*delta_alpha_j;
+			// the status is needed by the selection of the next i
+			update_alpha_status(i);
+			update_alpha_status(j);
+			update_gradient_select_i(Q_i, Q_j, delta_alpha_i, delta_alpha_j);
 		}
-
-		// update alpha_status and G_bar
-
+		else
 		{
-			bool ui = is_upper_bound(i);
-			bool uj = is_upper_bound(j);
+			for(int k=0;k<active_size;k++)
+			{
+				G[k] += Q_i[k]*delta_alpha_i + Q_j[k]*delta_alpha_j;
+			}
 			update_alpha_status(i);
 			update_alpha_status(j);
+			fused_valid = false;
+		}
+
+		// update G_bar
+
+		{
 			int k;
 			if(ui != is_upper_bound(i))
 			{
@@ -776,6 +1652,8 @@ void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 		si->upper_bound[i] = C[i];
 
 	info("\noptimization finished, #iter = %d\n",iter);
+	num_iter = iter;
+	max_iter_reached = (iter >= max_iter);
 
 	delete[] p;
 	delete[] y;
@@ -785,6 +1663,8 @@ void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 	delete[] active_set;
 	delete[] G;
 	delete[] G_bar;
+	delete[] t_value;
+	delete[] t_idx;
 }
 
 // return 1 if already optimal, return 0 otherwise
@@ -802,6 +1682,32 @@ int Solver::select_working_set(int &out_i, int &out_j)
 	int Gmin_idx = -1;
 	double obj_diff_min = INF;
 
+	if(use_parallel())
+	{
+		if(fused_valid)		// found by the last gradient update
+		{
+			Gmax = fused_Gmax;
+			Gmax_idx = fused_Gmax_idx;
+		}
+		else
+		{
+			// same pass as the fused one without any update
+			update_gradient_select_i(NULL, NULL, 0, 0);
+			Gmax = fused_Gmax;
+			Gmax_idx = fused_Gmax_idx;
+		}
+		fused_valid = false;
+		if(Gmax_idx == -1)
+			return 1;
+		const Qfloat *Q_i = Q->get_Q(Gmax_idx,active_size);
+		parallel_select_j(Gmax_idx, Q_i, Gmax, Gmax2, Gmin_idx);
+		if(Gmax+Gmax2 < eps || Gmin_idx == -1)
+			return 1;
+		out_i = Gmax_idx;
+		out_j = Gmin_idx;
+		return 0;
+	}
+
 	for(int t=0;t<active_size;t++)
 		if(y[t]==+1)	
 		{
@@ -907,6 +1813,15 @@ bool Solver::be_shrunk(int i, double Gmax1, double Gmax2)
 		return(false);
 }
 
+void Solver::add_stats(svm_solver_stats *stats) const
+{
+	stats->iterations += num_iter;
+	stats->shrink_rounds += num_shrink;
+	stats->reconstructions += num_reconstruct;
+	if(max_iter_reached)
+		++stats->max_iter_reached;
+}
+
 void Solver::do_shrinking()
 {
 	int i;
@@ -1271,24 +2186,72 @@ double Solver_NU::calculate_rho()
 class SVC_Q: public Kernel
 { 
 public:
-	SVC_Q(const svm_problem& prob, const svm_parameter& param, const schar *y_)
-	:Kernel(prob.l, prob.x, param)
+	SVC_Q(const svm_problem& prob, const svm_parameter& param, const schar *y_,
+	      svm_kernel_cache *shared_cache_ = NULL, const int *point_ids = NULL,
+	      int single_precision = 0, const svm_single_rows *single_rows = NULL)
+	:Kernel(prob.l, prob.x, param, single_precision, single_rows), l(prob.l), kernel_param(param), shared_cache(shared_cache_), id(NULL),
+	 cache(NULL), full(NULL), full_space(NULL), full_synced(NULL)
 	{
 		clone(y,y_,prob.l);
-		cache = new Cache(prob.l,(long int)(param.cache_size*(1<<20)));
 		QD = new double[prob.l];
 		for(int i=0;i<prob.l;i++)
 			QD[i] = (this->*kernel_function)(i,i);
+		kernel_evals = prob.l;
+		if(shared_cache != NULL)
+		{
+			id = new int[prob.l];
+			for(int i=0;i<prob.l && shared_cache != NULL;i++)
+			{
+				id[i] = shared_cache->slot_of((point_ids != NULL) ? point_ids[i] : i);
+				if(id[i] < 0)		// a point out of the cache, e.g. the ids of another level
+				{
+					info("the point %d is not in the shared kernel cache, it is not used\n", (point_ids != NULL) ? point_ids[i] : i);
+					shared_cache = NULL;
+				}
+			}
+		}
+		if(l <= full_kernel_max_size)
+			compute_full();
+		else
+			cache = new Cache(prob.l,(long int)(param.cache_size*(1<<20)));
 	}
 	
 	Qfloat *get_Q(int i, int len) const
 	{
+		if(full != NULL)
+		{
+			// bring the columns of the row up to date with the swaps since it was used last time
+			Qfloat *row = full[i];
+			for(size_t k=full_synced[i];k<full_swaps.size();k++)
+				swap(row[full_swaps[k].first],row[full_swaps[k].second]);
+			full_synced[i] = full_swaps.size();
+			return row;
+		}
 		Qfloat *data;
 		int start, j;
 		if((start = cache->get_data(i,&data,len)) < len)
 		{
-			for(j=start;j<len;j++)
-				data[j] = (Qfloat)(y[i]*y[j]*(this->*kernel_function)(i,j));
+			if(shared_cache != NULL)
+			{
+				// reuse the kernel values from other trainings with the same kernel parameters
+				svm_kernel_cache::row_t *shared_row = shared_cache->acquire_row(kernel_param,id[i]);
+				Qfloat *row = shared_row->data;
+				for(j=start;j<len;j++)
+				{
+					if(isnan(row[id[j]]))
+					{
+						row[id[j]] = (Qfloat)(this->*kernel_function)(i,j);
+						++kernel_evals;
+					}
+					data[j] = (Qfloat)(y[i]*y[j])*row[id[j]];
+				}
+				shared_cache->release_row(shared_row);
+			}
+			else
+			{
+				(this->*kernel_row)(i,start,len,data,y);
+				kernel_evals += len - start;
+			}
 		}
 		return data;
 	}
@@ -1298,12 +2261,30 @@ public:
 		return QD;
 	}
 
+	void add_cache_stats(svm_cache_stats *stats) const
+	{
+		stats->kernel_evals += kernel_evals;
+		if(cache != NULL)
+			cache->add_stats(stats);
+		else
+			stats->bytes = max(stats->bytes, (long int) l * l * (long int) sizeof(Qfloat));
+	}
+
 	void swap_index(int i, int j) const
 	{
-		cache->swap_index(i,j);
+		if(full != NULL)
+		{
+			// the rows are swapped now, the columns when a row is requested (most rows are never used again)
+			swap(full[i],full[j]);
+			swap(full_synced[i],full_synced[j]);
+			full_swaps.push_back(std::make_pair(i,j));
+		}
+		else
+			cache->swap_index(i,j);
 		Kernel::swap_index(i,j);
 		swap(y[i],y[j]);
 		swap(QD[i],QD[j]);
+		if(id) swap(id[i],id[j]);
 	}
 
 	~SVC_Q()
@@ -1311,13 +2292,87 @@ public:
 		delete[] y;
 		delete cache;
 		delete[] QD;
+		delete[] id;
+		delete[] full;
+		delete[] full_synced;
+		free(full_space);
 	}
 private:
+	int l;
 	schar *y;
-	Cache *cache;
 	double *QD;
+	const svm_parameter kernel_param;
+	svm_kernel_cache *shared_cache;
+	int *id;		// id of each point in the shared cache
+	Cache *cache;		// NULL for the full matrix
+	Qfloat **full;		// full[i][j] = y[i]*y[j]*K(i,j), the rows and columns follow swap_index
+	Qfloat *full_space;
+	mutable std::vector<std::pair<int,int> > full_swaps;	// all the swaps of swap_index
+	size_t *full_synced;	// number of the swaps that are applied to the columns of each row
+	mutable long int kernel_evals;	// kernel values computed by this matrix (not taken from a cache)
+
+	void compute_full();
 };
 
+void SVC_Q::compute_full()
+{
+	full_space = Malloc(Qfloat,(long int) l * l);
+	full = new Qfloat*[l];
+	full_synced = new size_t[l];
+	for(int i=0;i<l;i++)
+	{
+		full[i] = full_space + (long int) i * l;
+		full_synced[i] = 0;
+	}
+
+	if(shared_cache != NULL)
+	{
+		// the rows computed by other trainings with the same kernel parameters are reused, the new ones are shared
+		// a row is held by one training at a time, its entries are computed in parallel
+		for(int i=0;i<l;i++)
+		{
+			svm_kernel_cache::row_t *shared_row = shared_cache->acquire_row(kernel_param,id[i]);
+			Qfloat *row = shared_row->data;
+			for(int j=0;j<i;j++)		// the lower triangle is known from the previous rows
+			{
+				full[i][j] = full[j][i];
+				row[id[j]] = (Qfloat)(y[i]*y[j])*full[j][i];
+			}
+			long int num_evals = 0;
+#pragma omp parallel for schedule(static) num_threads(smo_num_threads) if(l - i >= 256) reduction(+:num_evals)
+			for(int j=i;j<l;j++)
+			{
+				if(isnan(row[id[j]]))
+				{
+					row[id[j]] = (Qfloat)(this->*kernel_function)(i,j);
+					++num_evals;
+				}
+				full[i][j] = (Qfloat)(y[i]*y[j])*row[id[j]];
+			}
+			kernel_evals += num_evals;
+			shared_cache->release_row(shared_row);
+		}
+		return;
+	}
+	kernel_evals += (long int) l * (l + 1) / 2;
+
+	// lower triangle in blocks (a block of columns stays in the cache for a block of rows), then mirror
+	const int block = 128;
+	int num_blocks = (l + block - 1) / block;
+#pragma omp parallel for schedule(dynamic,1) num_threads(smo_num_threads)
+	for(int bi=0;bi<num_blocks;bi++)
+	{
+		int i_end = min((bi+1)*block, l);
+		for(int bj=0;bj<=bi;bj++)
+			for(int i=bi*block;i<i_end;i++)
+				(this->*kernel_row)(i,bj*block,min((bj+1)*block,i+1),full[i],y);
+	}
+#pragma omp parallel for schedule(static) num_threads(smo_num_threads)
+	for(int i=0;i<l;i++)
+		for(int j=i+1;j<l;j++)
+			full[i][j] = full[j][i];
+}
+
 class ONE_CLASS_Q: public Kernel
 {
 public:
@@ -1333,12 +2388,9 @@ public:
 	Qfloat *get_Q(int i, int len) const
 	{
 		Qfloat *data;
-		int start, j;
+		int start;
 		if((start = cache->get_data(i,&data,len)) < len)
-		{
-			for(j=start;j<len;j++)
-				data[j] = (Qfloat)(this->*kernel_function)(i,j);
-		}
+			(this->*kernel_row)(i,start,len,data,NULL);
 		return data;
 	}
 
@@ -1401,10 +2453,7 @@ public:
 		Qfloat *data;
 		int j, real_i = index[i];
 		if(cache->get_data(real_i,&data,l) < l)
-		{
-			for(j=0;j<l;j++)
-				data[j] = (Qfloat)(this->*kernel_function)(real_i,j);
-		}
+			(this->*kernel_row)(real_i,0,l,data,NULL);
 
 		// reorder and copy
 		Qfloat *buf = buffer[next_buffer];
@@ -1444,8 +2493,10 @@ private:
 //
 static void solve_c_svc(
 	const svm_problem *prob, const svm_parameter* param,
-	double *alpha, Solver::SolutionInfo* si, double Cp, double Cn)
+	double *alpha, Solver::SolutionInfo* si, double Cp, double Cn,
+	const svm_train_context *ctx)
 {
+	const double *init_alpha = (ctx != NULL) ? ctx->init_alpha : NULL;
 	int l = prob->l;
 	double *minus_ones = new double[l];
 	schar *y = new schar[l];
@@ -1469,9 +2520,46 @@ static void solve_c_svc(
 		}
 	}
 
+	// warm start: clip the initial alphas to the new box [0, C_i] and
+	// scale down the heavier class to restore y^T alpha = 0, the gradient
+	// is then seeded from these alphas in Solver::Solve
+	if(init_alpha != NULL)
+	{
+		double sum_p = 0, sum_n = 0;
+		for(i=0;i<l;i++)
+		{
+			alpha[i] = min(max(init_alpha[i],0.0),C[i]);
+			if(y[i] == +1)
+				sum_p += alpha[i];
+			else
+				sum_n += alpha[i];
+		}
+		if(sum_p <= 0 || sum_n <= 0)
+		{
+			for(i=0;i<l;i++)
+				alpha[i] = 0;
+		}
+		else
+		{
+			double scale_p = min(1.0, sum_n/sum_p);
+			double scale_n = min(1.0, sum_p/sum_n);
+			for(i=0;i<l;i++)
+				alpha[i] *= (y[i] == +1) ? scale_p : scale_n;
+			info("warm start, sum alpha = %f\n", min(sum_p,sum_n));
+		}
+	}
+
 	Solver s;
-	s.Solve(l, SVC_Q(*prob,*param,y), minus_ones, y,
-		alpha, C, param->eps, si, param->shrinking);
+	SVC_Q Q(*prob,*param,y,
+		(ctx != NULL) ? ctx->kernel_cache : NULL,
+		(ctx != NULL) ? ctx->point_ids : NULL,
+		(ctx != NULL) ? ctx->single_precision : 0,
+		(ctx != NULL) ? ctx->single_rows : NULL);
+	s.Solve(l, Q, minus_ones, y, alpha, C, param->eps, si, param->shrinking);
+	if(ctx != NULL && ctx->cache_stats != NULL)
+		Q.add_cache_stats(ctx->cache_stats);
+	if(ctx != NULL && ctx->solver_stats != NULL)
+		s.add_stats(ctx->solver_stats);
 
 	/*
 	double sum_alpha=0;
@@ -1692,7 +2780,7 @@ struct decision_function
 
 static decision_function svm_train_one(
 	const svm_problem *prob, const svm_parameter *param,
-	double Cp, double Cn)
+	double Cp, double Cn, const svm_train_context *ctx = NULL)
 {
 	double *alpha = Malloc(double,prob->l);
 	Solver::SolutionInfo si;
@@ -1700,7 +2788,7 @@ static decision_function svm_train_one(
 	{
 		case C_SVC:
 			si.upper_bound = Malloc(double,prob->l); 
-			solve_c_svc(prob,param,alpha,&si,Cp,Cn);
+			solve_c_svc(prob,param,alpha,&si,Cp,Cn,ctx);
 			break;
 		case NU_SVC:
 			si.upper_bound = Malloc(double,prob->l); 
@@ -1951,14 +3039,23 @@ static void svm_binary_svc_probability(
 	int nr_fold = 5;
 	int *perm = Malloc(int,prob->l);
 	double *dec_values = Malloc(double,prob->l);
+	bool in_fold = fold_rand_state != NULL;		// inside a fold of svm_cross_validation
+	unsigned int local_state = fold_base_seed(prob,param,nr_fold);
+	if(!in_fold)
+		fold_rand_state = &local_state;
 
 	// random shuffle
 	for(i=0;i<prob->l;i++) perm[i]=i;
 	for(i=0;i<prob->l;i++)
 	{
-		int j = i+rand()%(prob->l-i);
+		int j = i+fold_rand()%(prob->l-i);
 		swap(perm[i],perm[j]);
 	}
+	if(!in_fold)
+		fold_rand_state = NULL;
+	// the folds write disjoint parts of dec_values (no random numbers inside, the fold models have no probability)
+	int num_threads = in_fold ? 1 : min(fold_num_threads, nr_fold);	// a fold of a parallel cv is serial
+#pragma omp parallel for schedule(dynamic,1) num_threads(num_threads) if(num_threads > 1)
 	for(i=0;i<nr_fold;i++)
 	{
 		int begin = i*prob->l/nr_fold;
@@ -2006,6 +3103,7 @@ static void svm_binary_svc_probability(
 		{
 			svm_parameter subparam = *param;
 			subparam.probability=0;
+			subparam.cache_size = param->cache_size / num_threads;
 			subparam.C=1.0;
 			subparam.nr_weight=2;
 			subparam.weight_label = Malloc(int,2);
@@ -2174,6 +3272,58 @@ static void remove_zero_weight(svm_problem *newprob, const svm_problem *prob)
 //
 svm_model *svm_train(const svm_problem *prob, const svm_parameter *param)
 {
+	return svm_train_with_context(prob, param, NULL);
+}
+
+svm_model *svm_train_warm_start(const svm_problem *prob, const svm_parameter *param, const double *init_alpha)
+{
+	svm_train_context ctx;
+	ctx.init_alpha = init_alpha;
+	ctx.kernel_cache = NULL;
+	ctx.point_ids = NULL;
+	ctx.cache_stats = NULL;
+	ctx.solver_stats = NULL;
+	ctx.single_precision = 0;
+	ctx.single_rows = NULL;
+	return svm_train_with_context(prob, param, &ctx);
+}
+
+svm_model *svm_train_with_context(const svm_problem *prob, const svm_parameter *param, const svm_train_context *ctx)
+{
+	// keep the initial alphas and the point ids aligned with the points which survive remove_zero_weight
+	double *newinit = NULL;
+	int *newids = NULL;
+	svm_kernel_cache *kernel_cache = NULL;
+	svm_single_rows *newrows = NULL;
+	if(ctx != NULL && param->svm_type == C_SVC)
+	{
+		int i, j;
+		if(ctx->init_alpha != NULL)
+		{
+			newinit = Malloc(double,prob->l);
+			for(i=0,j=0;i<prob->l;i++)
+				if(prob->W[i] > 0)
+					newinit[j++] = ctx->init_alpha[i];
+		}
+		if(ctx->kernel_cache != NULL)
+		{
+			kernel_cache = ctx->kernel_cache;
+			newids = Malloc(int,prob->l);
+			for(i=0,j=0;i<prob->l;i++)
+				if(prob->W[i] > 0)
+					newids[j++] = (ctx->point_ids != NULL) ? ctx->point_ids[i] : i;
+		}
+		if(ctx->single_precision && ctx->single_rows != NULL)
+		{
+			int *rows_ids = Malloc(int,prob->l);
+			for(i=0,j=0;i<prob->l;i++)
+				if(prob->W[i] > 0)
+					rows_ids[j++] = i;
+			newrows = svm_single_rows_select(ctx->single_rows, rows_ids, j);
+			free(rows_ids);
+		}
+	}
+
 	svm_problem newprob;
 	remove_zero_weight(&newprob, prob);
 	prob = &newprob;
@@ -2181,6 +3331,10 @@ svm_model *svm_train(const svm_problem *prob, const svm_parameter *param)
 	svm_model *model = Malloc(svm_model,1);
 	model->param = *param;
 	model->free_sv = 0;	// XXX
+	model->w = NULL;
+	model->w_dim = 0;
+	model->ee_order = NULL;
+	model->ee_tail = NULL;
 
 	if(param->svm_type == ONE_CLASS ||
 	   param->svm_type == EPSILON_SVR ||
@@ -2307,10 +3461,54 @@ svm_model *svm_train(const svm_problem *prob, const svm_parameter *param)
 					sub_prob.W[ci+k] = W[sj+k];
 				}
 
+				svm_train_context sub_ctx;
+				sub_ctx.init_alpha = NULL;
+				sub_ctx.kernel_cache = kernel_cache;
+				sub_ctx.point_ids = NULL;
+				sub_ctx.cache_stats = (ctx != NULL) ? ctx->cache_stats : NULL;
+				sub_ctx.solver_stats = (ctx != NULL) ? ctx->solver_stats : NULL;
+				sub_ctx.single_precision = (ctx != NULL) ? ctx->single_precision : 0;
+				sub_ctx.single_rows = NULL;
+				double *sub_init = NULL;
+				int *sub_ids = NULL;
+				svm_single_rows *sub_rows = NULL;
+				if(newinit != NULL)
+				{
+					sub_init = Malloc(double,sub_prob.l);
+					for(k=0;k<ci;k++)
+						sub_init[k] = newinit[perm[si+k]];
+					for(k=0;k<cj;k++)
+						sub_init[ci+k] = newinit[perm[sj+k]];
+					sub_ctx.init_alpha = sub_init;
+				}
+				if(newids != NULL)
+				{
+					sub_ids = Malloc(int,sub_prob.l);
+					for(k=0;k<ci;k++)
+						sub_ids[k] = newids[perm[si+k]];
+					for(k=0;k<cj;k++)
+						sub_ids[ci+k] = newids[perm[sj+k]];
+					sub_ctx.point_ids = sub_ids;
+				}
+				if(newrows != NULL)
+				{
+					int *sub_rows_ids = Malloc(int,sub_prob.l);
+					for(k=0;k<ci;k++)
+						sub_rows_ids[k] = perm[si+k];
+					for(k=0;k<cj;k++)
+						sub_rows_ids[ci+k] = perm[sj+k];
+					sub_rows = svm_single_rows_select(newrows, sub_rows_ids, sub_prob.l);
+					free(sub_rows_ids);
+					sub_ctx.single_rows = sub_rows;
+				}
+
 				if(param->probability)
 					svm_binary_svc_probability(&sub_prob,param,weighted_C[i],weighted_C[j],probA[p],probB[p]);
 
-				f[p] = svm_train_one(&sub_prob,param,weighted_C[i],weighted_C[j]);
+				f[p] = svm_train_one(&sub_prob,param,weighted_C[i],weighted_C[j],&sub_ctx);
+				free(sub_init);
+				free(sub_ids);
+				svm_single_rows_destroy(&sub_rows);
 				for(k=0;k<ci;k++)
 					if(!nonzero[si+k] && fabs(f[p].alpha[k]) > 0)
 						nonzero[si+k] = true;
@@ -2433,6 +3631,135 @@ svm_model *svm_train(const svm_problem *prob, const svm_parameter *param)
 	free(newprob.x);
 	free(newprob.y);
 	free(newprob.W);
+	free(newinit);
+	free(newids);
+	svm_single_rows_destroy(&newrows);
+	return model;
+}
+
+// nr_class, l, (label, nSV), probA, probB are present, then label[k], nSV[k], rho, probA, probB, sv_coef, sv_indices
+enum { MV_NR_CLASS, MV_L, MV_HAS_LABEL, MV_HAS_PROBA, MV_HAS_PROBB, MV_HEADER };
+
+int svm_model_values_size(const svm_model *model)
+{
+	int nr_class = model->nr_class;
+	int num_pairs = nr_class*(nr_class-1)/2;
+	int size = MV_HEADER + num_pairs + (nr_class-1)*model->l + model->l;
+	if(model->label != NULL && model->nSV != NULL)
+		size += 2*nr_class;
+	if(model->probA != NULL)
+		size += num_pairs;
+	if(model->probB != NULL)
+		size += num_pairs;
+	return size;
+}
+
+void svm_get_model_values(const svm_model *model, double *values)
+{
+	int i, k;
+	int nr_class = model->nr_class;
+	int num_pairs = nr_class*(nr_class-1)/2;
+	bool has_label = model->label != NULL && model->nSV != NULL;
+	values[MV_NR_CLASS] = nr_class;
+	values[MV_L] = model->l;
+	values[MV_HAS_LABEL] = has_label;
+	values[MV_HAS_PROBA] = model->probA != NULL;
+	values[MV_HAS_PROBB] = model->probB != NULL;
+	double *p = values + MV_HEADER;
+	if(has_label)
+	{
+		for(i=0;i<nr_class;i++) *p++ = model->label[i];
+		for(i=0;i<nr_class;i++) *p++ = model->nSV[i];
+	}
+	for(i=0;i<num_pairs;i++) *p++ = model->rho[i];
+	if(model->probA != NULL)
+		for(i=0;i<num_pairs;i++) *p++ = model->probA[i];
+	if(model->probB != NULL)
+		for(i=0;i<num_pairs;i++) *p++ = model->probB[i];
+	for(k=0;k<nr_class-1;k++)
+		for(i=0;i<model->l;i++) *p++ = model->sv_coef[k][i];
+	for(i=0;i<model->l;i++) *p++ = model->sv_indices[i];
+}
+
+svm_model *svm_model_from_values(const svm_problem *prob, const svm_parameter *param, const double *values, int num_values)
+{
+	if(num_values < MV_HEADER)
+		return NULL;
+	int i, k;
+	int nr_class = (int) values[MV_NR_CLASS];
+	int l = (int) values[MV_L];
+	bool has_label = values[MV_HAS_LABEL] != 0;
+	bool has_probA = values[MV_HAS_PROBA] != 0;
+	bool has_probB = values[MV_HAS_PROBB] != 0;
+	int num_pairs = nr_class*(nr_class-1)/2;
+	if(nr_class < 2 || l < 0 || num_values != MV_HEADER + (has_label ? 2*nr_class : 0) + num_pairs*(1+has_probA+has_probB) +
+	   (nr_class-1)*l + l)
+		return NULL;
+
+	// the sv_indices are in the problem without the zero weights (see svm_train_with_context)
+	int *nonzero = Malloc(int,prob->l);
+	int num_nonzero = 0;
+	for(i=0;i<prob->l;i++)
+		if(prob->W[i] > 0)
+			nonzero[num_nonzero++] = i;
+
+	svm_model *model = Malloc(svm_model,1);
+	model->param = *param;
+	model->free_sv = 0;		// the SVs are the rows of prob
+	model->nr_class = nr_class;
+	model->l = l;
+	model->w = NULL;
+	model->w_dim = 0;
+	model->ee_order = NULL;
+	model->ee_tail = NULL;
+	model->label = NULL;
+	model->nSV = NULL;
+	model->probA = NULL;
+	model->probB = NULL;
+	const double *p = values + MV_HEADER;
+	if(has_label)
+	{
+		model->label = Malloc(int,nr_class);
+		model->nSV = Malloc(int,nr_class);
+		for(i=0;i<nr_class;i++) model->label[i] = (int) *p++;
+		for(i=0;i<nr_class;i++) model->nSV[i] = (int) *p++;
+	}
+	model->rho = Malloc(double,num_pairs);
+	for(i=0;i<num_pairs;i++) model->rho[i] = *p++;
+	if(has_probA)
+	{
+		model->probA = Malloc(double,num_pairs);
+		for(i=0;i<num_pairs;i++) model->probA[i] = *p++;
+	}
+	if(has_probB)
+	{
+		model->probB = Malloc(double,num_pairs);
+		for(i=0;i<num_pairs;i++) model->probB[i] = *p++;
+	}
+	model->sv_coef = Malloc(double *,nr_class-1);
+	for(k=0;k<nr_class-1;k++)
+	{
+		model->sv_coef[k] = Malloc(double,l);
+		for(i=0;i<l;i++) model->sv_coef[k][i] = *p++;
+	}
+	model->SV = Malloc(svm_node *,l);
+	model->sv_indices = Malloc(int,l);
+	bool valid = true;
+	for(i=0;i<l;i++)
+	{
+		int index = (int) *p++;
+		model->sv_indices[i] = index;
+		if(index < 1 || index > num_nonzero)
+		{
+			valid = false;
+			model->SV[i] = NULL;
+		}
+		else
+			model->SV[i] = prob->x[nonzero[index-1]];
+	}
+	free(nonzero);
+	if(!valid)
+		svm_free_and_destroy_model(&model);		// the values belong to another problem
 	return model;
 }
 
@@ -2444,6 +3771,10 @@ void svm_cross_validation(const svm_problem *prob, const svm_parameter *param, i
 	int l = prob->l;
 	int *perm = Malloc(int,l);
 	int nr_class;
+	unsigned int *outer_state = fold_rand_state;		// a cv inside a fold continues the fold's sequence
+	unsigned int local_state = fold_base_seed(prob,param,nr_fold);
+	if(outer_state == NULL)
+		fold_rand_state = &local_state;
 	if (nr_fold > l)
 	{
 		nr_fold = l;
@@ -2469,7 +3800,7 @@ void svm_cross_validation(const svm_problem *prob, const svm_parameter *param, i
 		for (c=0; c<nr_class; c++) 
 			for(i=0;i<count[c];i++)
 			{
-				int j = i+rand()%(count[c]-i);
+				int j = i+fold_rand()%(count[c]-i);
 				swap(index[start[c]+j],index[start[c]+i]);
 			}
 		for(i=0;i<nr_fold;i++)
@@ -2506,19 +3837,30 @@ void svm_cross_validation(const svm_problem *prob, const svm_parameter *param, i
 		for(i=0;i<l;i++) perm[i]=i;
 		for(i=0;i<l;i++)
 		{
-			int j = i+rand()%(l-i);
+			int j = i+fold_rand()%(l-i);
 			swap(perm[i],perm[j]);
 		}
 		for(i=0;i<=nr_fold;i++)
 			fold_start[i]=i*l/nr_fold;
 	}
 
+	// the folds are independent and write disjoint parts of target, each one gets a share of the cache
+	int num_threads = min(fold_num_threads, nr_fold);
+	svm_parameter fold_param = *param;
+	if(num_threads > 1)
+		fold_param.cache_size = param->cache_size / num_threads;
+	// the seeds are drawn in order in both modes, a fold gets the same numbers on any thread
+	unsigned int *fold_seed = Malloc(unsigned int,nr_fold);
+	for(i=0;i<nr_fold;i++)
+		fold_seed[i] = (unsigned int) fold_rand();
+#pragma omp parallel for schedule(dynamic,1) num_threads(num_threads) if(num_threads > 1)
 	for(i=0;i<nr_fold;i++)
 	{
 		int begin = fold_start[i];
 		int end = fold_start[i+1];
 		int j,k;
 		struct svm_problem subprob;
+		fold_rand_state = &fold_seed[i];
 
 		subprob.l = l-(end-begin);
 		subprob.x = Malloc(struct svm_node*,subprob.l);
@@ -2540,7 +3882,7 @@ void svm_cross_validation(const svm_problem *prob, const svm_parameter *param, i
 			subprob.W[k] = prob->W[perm[j]];
 			++k;
 		}
-		struct svm_model *submodel = svm_train(&subprob,param);
+		struct svm_model *submodel = svm_train(&subprob,&fold_param);
 		if(param->probability && 
 		   (param->svm_type == C_SVC || param->svm_type == NU_SVC))
 		{
@@ -2556,7 +3898,10 @@ void svm_cross_validation(const svm_problem *prob, const svm_parameter *param, i
 		free(subprob.x);
 		free(subprob.y);
 		free(subprob.W);
+		fold_rand_state = NULL;
 	}		
+	fold_rand_state = outer_state;		// the serial folds run on this thread
+	free(fold_seed);
 	free(fold_start);
 	free(perm);
 }
@@ -2603,17 +3948,156 @@ double svm_get_svr_probability(const svm_model *model)
 	}
 }
 
+void svm_build_linear_weights(svm_model *model)
+{
+	if(model->param.kernel_type != LINEAR || model->nr_class != 2 ||
+	   (model->param.svm_type != C_SVC && model->param.svm_type != NU_SVC))
+		return;
+
+	int i, dim = 0;
+	for(i=0;i<model->l;i++)
+		for(const svm_node *px = model->SV[i]; px->index != -1; ++px)
+			dim = max(dim, px->index);
+
+	free(model->w);
+	model->w = (double *)calloc(dim+1,sizeof(double));
+	model->w_dim = dim;
+	double *coef = model->sv_coef[0];
+	for(i=0;i<model->l;i++)
+		for(const svm_node *px = model->SV[i]; px->index != -1; ++px)
+			if(px->index > 0)
+				model->w[px->index] += coef[i] * px->value;
+}
+
+static std::atomic<long int> ee_num_predictions(0);
+static std::atomic<long int> ee_num_evaluated(0);
+static std::atomic<long int> ee_num_total(0);
+
+void svm_build_early_exit(svm_model *model)
+{
+	if(model->param.kernel_type != RBF || model->nr_class != 2 ||
+	   (model->param.svm_type != C_SVC && model->param.svm_type != NU_SVC))
+		return;
+
+	int l = model->l;
+	const double *coef = model->sv_coef[0];
+	free(model->ee_order);
+	free(model->ee_tail);
+	model->ee_order = Malloc(int,l);
+	model->ee_tail = Malloc(double,2*(l+1));
+	for(int i=0;i<l;i++)
+		model->ee_order[i] = i;
+	std::stable_sort(model->ee_order, model->ee_order + l,
+			 [coef](int a, int b) { return fabs(coef[a]) > fabs(coef[b]); });
+	double *tail = model->ee_tail;
+	tail[2*l] = tail[2*l+1] = 0;
+	for(int k=l-1;k>=0;k--)
+	{
+		double c = coef[model->ee_order[k]];
+		tail[2*k] = tail[2*k+2] + max(c,0.0);
+		tail[2*k+1] = tail[2*k+3] + max(-c,0.0);
+	}
+}
+
+void svm_get_early_exit_stats(long int *num_predictions, long int *num_evaluated, long int *num_total)
+{
+	*num_predictions = ee_num_predictions;
+	*num_evaluated = ee_num_evaluated;
+	*num_total = ee_num_total;
+}
+
+void svm_reset_early_exit_stats(void)
+{
+	ee_num_predictions = 0;
+	ee_num_evaluated = 0;
+	ee_num_total = 0;
+}
+
+//
+// label of a binary RBF model with the SVs in the order of ee_order, each K is in (0,1], hence after k SVs
+// the decision value is in [sum - (negative tail), sum + (positive tail)], the margin tol absorbs the rounding
+// of the other summation order and a decision value within tol of zero is computed again in the exact order
+// both orders add the same l+1 rounded terms (same kernel values), each recursive sum is within
+// l*u*(sum|coef|+|rho|) of the exact one (u = DBL_EPSILON/2, |K| <= 1), hence they differ by at most
+// l*DBL_EPSILON*(sum|coef|+|rho|), tol doubles it for the rounding of the tails and of the comparisons
+//
+static double svm_predict_early_exit(const svm_model *model, const svm_node *x)
+{
+	int l = model->l;
+	const double *coef = model->sv_coef[0];
+	const double *tail = model->ee_tail;
+	const double rho = model->rho[0];
+	const double tol = 2 * l * DBL_EPSILON * (tail[0] + tail[1] + fabs(rho));
+	double sum = -rho;
+	int k = 0;
+	double label = 0;
+	bool decided = false;
+	while(k < l)
+	{
+		int i = model->ee_order[k];
+		sum += coef[i] * Kernel::k_function_rbf(x,model->SV[i],model->param);
+		++k;
+		if(sum - tail[2*k+1] > tol)
+		{
+			label = model->label[0];
+			decided = true;
+			break;
+		}
+		if(sum + tail[2*k] < -tol)
+		{
+			label = model->label[1];
+			decided = true;
+			break;
+		}
+	}
+	if(!decided)
+	{
+		if(fabs(sum) <= tol)
+		{
+			double dec_value;
+			label = svm_predict_values(model, x, &dec_value);
+		}
+		else
+			label = (sum > 0) ? model->label[0] : model->label[1];
+	}
+	++ee_num_predictions;
+	ee_num_evaluated += k;
+	ee_num_total += l;
+	return label;
+}
+
+// kernel values of the SVs for one point, reused by the predictions of a thread (the groups predict at the same time)
+static double *predict_kvalue_buffer(int l)
+{
+	static thread_local std::vector<double> v_kvalue;
+	if((int) v_kvalue.size() < l)
+		v_kvalue.resize(l);
+	return v_kvalue.data();
+}
+
 double svm_predict_values(const svm_model *model, const svm_node *x, double* dec_values)
 {
 	int i;
+	if(model->w != NULL)	// binary linear model, a sparse dot with w instead of the SVs
+	{
+		double sum = 0;
+		for(const svm_node *px = x; px->index != -1; ++px)
+			if(px->index > 0 && px->index <= model->w_dim)
+				sum += model->w[px->index] * px->value;
+		sum -= model->rho[0];
+		dec_values[0] = sum;
+		return (sum > 0) ? model->label[0] : model->label[1];
+	}
 	if(model->param.svm_type == ONE_CLASS ||
 	   model->param.svm_type == EPSILON_SVR ||
 	   model->param.svm_type == NU_SVR)
 	{
 		double *sv_coef = model->sv_coef[0];
+		double *kvalue = predict_kvalue_buffer(model->l);
+		Kernel::k_function_row(x,model->SV,model->l,model->param,kvalue);
 		double sum = 0;
 		for(i=0;i<model->l;i++)
-			sum += sv_coef[i] * Kernel::k_function(x,model->SV[i],model->param);
+			sum += sv_coef[i] * kvalue[i];
 		sum -= model->rho[0];
 		*dec_values = sum;
 
@@ -2627,9 +4111,8 @@ double svm_predict_values(const svm_model *model, const svm_node *x, double* dec
 		int nr_class = model->nr_class;
 		int l = model->l;
 		
-		double *kvalue = Malloc(double,l);
-		for(i=0;i<l;i++)
-			kvalue[i] = Kernel::k_function(x,model->SV[i],model->param);
+		double *kvalue = predict_kvalue_buffer(l);
+		Kernel::k_function_row(x,model->SV,l,model->param,kvalue);
 
 		int *start = Malloc(int,nr_class);
 		start[0] = 0;
@@ -2672,7 +4155,6 @@ double svm_predict_values(const svm_model *model, const svm_node *x, double* dec
 			if(vote[i] > vote[vote_max_idx])
 				vote_max_idx = i;
 
-		free(kvalue);
 		free(start);
 		free(vote);
 		return model->label[vote_max_idx];
@@ -2681,6 +4163,8 @@ double svm_predict_values(const svm_model *model, const svm_node *x, double* dec
 
 double svm_predict(const svm_model *model, const svm_node *x)
 {
+	if(model->ee_order != NULL)
+		return svm_predict_early_exit(model, x);
 	int nr_class = model->nr_class;
 	double *dec_values;
 	if(model->param.svm_type == ONE_CLASS ||
@@ -3003,6 +4487,10 @@ svm_model *svm_load_model(const char *model_file_name)
 	// read parameters
 
 	svm_model *model = Malloc(svm_model,1);
+	model->w = NULL;
+	model->w_dim = 0;
+	model->ee_order = NULL;
+	model->ee_tail = NULL;
 	model->rho = NULL;
 	model->probA = NULL;
 	model->probB = NULL;
@@ -3130,6 +4618,16 @@ void svm_free_model_content(svm_model* model_ptr)
 
 	free(model_ptr->nSV);
 	model_ptr->nSV = NULL;
+
+	free(model_ptr->w);
+	model_ptr->w = NULL;
+	model_ptr->w_dim = 0;
+
+	free(model_ptr->ee_order);
+	model_ptr->ee_order = NULL;
+
+	free(model_ptr->ee_tail);
+	model_ptr->ee_tail = NULL;
 }
 
 void svm_free_and_destroy_model(svm_model** model_ptr_ptr)
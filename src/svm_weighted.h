@@ -70,11 +70,96 @@ struct svm_model
 	/* XXX */
 	int free_sv;		/* 1 if svm_model is created by svm_load_model*/
 				/* 0 if svm_model is created by svm_train */
+
+	/* linear kernel, binary classification only */
+	double *w;		/* primal weights w[index] = sum(sv_coef * SV value), NULL if not built */
+	int w_dim;		/* w[1,...,w_dim] are valid */
+
+	/* RBF kernel, binary classification only */
+	int *ee_order;		/* SVs by decreasing |sv_coef| for the early exit of svm_predict, NULL if not built */
+	double *ee_tail;	/* ee_tail[2k], ee_tail[2k+1] = sum of the positive, -(negative) sv_coef of ee_order[k,...,l-1] */
+};
+
+//
+// svm_kernel_cache
+//
+// kernel rows shared between trainings on (subsets of) the same points,
+// rows are keyed by the kernel parameters (gamma) and the point id
+// the trainings which share a cache may run at the same time
+//
+struct svm_kernel_cache;
+
+struct svm_kernel_cache *svm_kernel_cache_create(int num_points, double size_mb);
+/* only the num_ids points in ids (of the id space 0..num_points-1) are cached, e.g. the points of the partition groups */
+struct svm_kernel_cache *svm_kernel_cache_create_ids(int num_points, const int *ids, int num_ids, double size_mb);
+void svm_kernel_cache_destroy(struct svm_kernel_cache **cache_ptr_ptr);
+
+//
+// svm_single_rows
+//
+// dense single precision copies of the rows of a problem for the mixed precision training kernels,
+// built once and shared read-only by the trainings of the problem (e.g. all the C, gamma candidates)
+//
+struct svm_single_rows;
+
+/* NULL for sparse data (the dense rows would be larger than the sparse ones), then the kernels stay in double */
+struct svm_single_rows *svm_single_rows_create(const struct svm_problem *prob);
+/* row i of the view is the row ids[i] of full, the float data stays in full (it should outlive the view) */
+struct svm_single_rows *svm_single_rows_select(const struct svm_single_rows *full, const int *ids, int l);
+void svm_single_rows_destroy(struct svm_single_rows **rows_ptr_ptr);
+
+//
+// one memory budget for the kernel caches of all the (concurrent) trainings
+// 0 (default) disables it, then each training uses param->cache_size
+//
+void svm_cache_arena_set_budget(double size_mb);
+
+struct svm_cache_stats
+{
+	long int hits;		/* requested columns which were in the cache */
+	long int misses;	/* requested columns which were (partially) computed */
+	long int evictions;	/* columns removed to make space */
+	long int bytes;		/* peak memory of the cached columns */
+	long int kernel_evals;	/* kernel values which were computed (not found in a cache) */
+};
+
+struct svm_solver_stats
+{
+	long int iterations;	/* SMO iterations */
+	long int shrink_rounds;	/* calls of the shrinking heuristic */
+	long int reconstructions;	/* gradient reconstructions of the shrunk variables */
+	int max_iter_reached;	/* binary problems which stopped at the iteration limit */
+};
+
+//
+// optional inputs/outputs of a training, the members can be NULL
+//
+struct svm_train_context
+{
+	const double *init_alpha;	/* init_alpha[i] (>= 0) is the starting multiplier of prob->x[i] (C_SVC only) */
+	struct svm_kernel_cache *kernel_cache;	/* shared kernel rows */
+	const int *point_ids;	/* id of prob->x[i] in the kernel_cache, NULL means i */
+	struct svm_cache_stats *cache_stats;	/* output: added up over the binary problems */
+	struct svm_solver_stats *solver_stats;	/* output: added up over the binary problems */
+	int single_precision;	/* 1: the training kernels in single precision from float rows (dense data only, C_SVC only) */
+	const struct svm_single_rows *single_rows;	/* float rows of prob->x, NULL: built by the training if single_precision */
 };
 
 struct svm_model *svm_train(const struct svm_problem *prob, const struct svm_parameter *param);
+/* init_alpha[i] (>= 0) is the starting multiplier of prob->x[i], NULL means a cold start (C_SVC only) */
+struct svm_model *svm_train_warm_start(const struct svm_problem *prob, const struct svm_parameter *param, const double *init_alpha);
+struct svm_model *svm_train_with_context(const struct svm_problem *prob, const struct svm_parameter *param,
+					 const struct svm_train_context *ctx);
 void svm_cross_validation(const struct svm_problem *prob, const struct svm_parameter *param, int nr_fold, double *target);
 
+/*
+ * the model as an array of doubles (e.g. to send it to the other MPI ranks), the SVs are kept as sv_indices,
+ * svm_model_from_values points the SVs to the rows of the same problem and parameters (NULL if they don't match)
+ */
+int svm_model_values_size(const struct svm_model *model);
+void svm_get_model_values(const struct svm_model *model, double *values);
+struct svm_model *svm_model_from_values(const struct svm_problem *prob, const struct svm_parameter *param,
+					const double *values, int num_values);
 int svm_save_model(const char *model_file_name, const struct svm_model *model);
 struct svm_model *svm_load_model(const char *model_file_name);
 
@@ -91,12 +176,29 @@ double svm_predict_probability(const struct svm_model *model, const struct svm_n
 
 void svm_free_model_content(struct svm_model *model_ptr);
 void svm_free_and_destroy_model(struct svm_model **model_ptr_ptr);
+/* collapse the SVs of a binary linear model into w, then the prediction doesn't depend on the number of SVs */
+void svm_build_linear_weights(struct svm_model *model);
+/*
+ * sort the SVs of a binary RBF model by |sv_coef|, then svm_predict stops as soon as the remaining SVs
+ * can't change the sign of the decision value (0 < K <= 1), the labels are the same as the exact prediction
+ * svm_predict_values still returns the exact decision values
+ */
+void svm_build_early_exit(struct svm_model *model);
+/* predictions through the early exit, their evaluated SVs and all their SVs since the last reset */
+void svm_get_early_exit_stats(long int *num_predictions, long int *num_evaluated, long int *num_total);
+void svm_reset_early_exit_stats(void);
 void svm_destroy_param(struct svm_parameter *param);
 
 const char *svm_check_parameter(const struct svm_problem *prob, const struct svm_parameter *param);
 int svm_check_probability_model(const struct svm_model *model);
 
 void svm_set_print_string_function(void (*print_func)(const char *));
+/* parallel SMO with num_threads threads for the problems with at least min_active_size active variables (1 is serial) */
+void svm_set_smo_parallel(int num_threads, int min_active_size);
+/* C-SVC problems with at most max_size points use the full kernel matrix instead of the LRU cache (0 disables) */
+void svm_set_full_kernel(int max_size);
+/* train num_threads folds of svm_cross_validation and of the probability estimates at the same time (1 is serial) */
+void svm_set_fold_parallel(int num_threads);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,96 @@
+#include "task_pool.h"
+#include "config_params.h"
+#include <cstdio>
+
+TaskPool* TaskPool::instance = NULL;
+
+TaskPool* TaskPool::getInstance(){
+    if(!instance) instance = new TaskPool(Config_params::getInstance()->get_ms_threads());
+    return instance;
+}
+
+
+std::mutex& TaskPool::petsc_mutex(){
+    static std::mutex mtx;
+    return mtx;
+}
+
+
+TaskPool::TaskPool(int width) : width_(width < 1 ? 1 : width){
+    // the workers live as long as the process (the singleton is never destroyed)
+    for(int i=1; i < width_; ++i)
+        v_workers_.push_back(std::thread(&TaskPool::worker, this));
+    if(width_ > 1)
+        printf("[TaskPool] %d threads for the model selection\n", width_);
+}
+
+
+void TaskPool::debug_only_set_width(int width){
+    std::lock_guard<std::mutex> lock(mtx_);
+    width_ = width < 1 ? 1 : width;
+    while((int) v_workers_.size() < width_ - 1)
+        v_workers_.push_back(std::thread(&TaskPool::worker, this));
+}
+
+
+int TaskPool::take_task(batch_t * batch){
+    if(batch->next == batch->num_tasks)
+        return -1;
+    int task_id = batch->next++;
+    if(batch->next == batch->num_tasks){        // all started, nothing left for the others
+        for(auto it = batches_.begin(); it != batches_.end(); ++it){
+            if(*it == batch){
+                batches_.erase(it);
+                break;
+            }
+        }
+    }
+    return task_id;
+}
+
+
+void TaskPool::finish_task(batch_t * batch){
+    if(++batch->num_done == batch->num_tasks)
+        cv_.notify_all();       // wake up the owner of the batch
+}
+
+
+void TaskPool::worker(){
+    std::unique_lock<std::mutex> lock(mtx_);
+    while(true){
+        cv_.wait(lock, [this]{ return !batches_.empty(); });
+        batch_t * batch = batches_.front();
+        int task_id = take_task(batch);
+        lock.unlock();
+        (*batch->task)(task_id);
+        lock.lock();
+        finish_task(batch);             // the batch may be gone after this
+    }
+}
+
+
+void TaskPool::run(int num_tasks, const std::function<void(int)>& task){
+    if(width_ == 1 || num_tasks <= 1){
+        for(int i=0; i < num_tasks; ++i)
+            task(i);
+        return;
+    }
+    batch_t batch;
+    batch.task = &task;
+    batch.num_tasks = num_tasks;
+    batch.next = 0;
+    batch.num_done = 0;
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    batches_.push_back(&batch);
+    cv_.notify_all();
+    // only help with this batch, the tasks of the other batches may wait for this one
+    int task_id;
+    while((task_id = take_task(&batch)) != -1){
+        lock.unlock();
+        task(task_id);
+        lock.lock();
+        finish_task(&batch);
+    }
+    cv_.wait(lock, [&batch]{ return batch.num_done == batch.num_tasks; });
+}
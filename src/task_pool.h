@@ -0,0 +1,52 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <vector>
+
+/*
+ * Pool of worker threads for the independent trainings of the model selection (e.g. the folds and the UD candidates)
+ * the width is ms_threads, 1 runs the tasks in order on the calling thread (no worker is created)
+ * run() returns when all the tasks of its batch are done, the calling thread runs the tasks of its batch too,
+ * hence a task may call run() again (nested batches share the same workers) without a deadlock
+ * PETSc is not thread safe, the tasks hold petsc_mutex() around the PETSc calls (e.g. MatGetRow)
+ */
+class TaskPool{
+public:
+    static TaskPool* getInstance();
+
+    int get_width() const { return width_; }
+    // the unit tests compare the width 1 with more threads, the workers are never stopped (a smaller width leaves some idle)
+    void debug_only_set_width(int width);
+
+    // task(i) for i in [0, num_tasks), the order of the calls is not defined for width > 1
+    void run(int num_tasks, const std::function<void(int)>& task);
+
+    static std::mutex& petsc_mutex();
+
+private:
+    struct batch_t{
+        const std::function<void(int)> * task;
+        int num_tasks;
+        int next;           // next task which is not started
+        int num_done;
+    };
+
+    TaskPool(int width);
+    static TaskPool* instance;
+    int width_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<batch_t *> batches_;     // batches with tasks that are not started
+    std::vector<std::thread> v_workers_;
+
+    void worker();
+    int take_task(batch_t * batch);     // the lock should be held, returns -1 if all the tasks are started
+    void finish_task(batch_t * batch);  // the lock should be held
+};
+
+#endif // TASK_POOL_H
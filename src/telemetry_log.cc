@@ -0,0 +1,70 @@
+#include "telemetry_log.h"
+#include "config_params.h"
+#include "dist_tasks.h"
+#include <cstdlib>
+
+TelemetryLog* TelemetryLog::instance = NULL;
+
+TelemetryLog* TelemetryLog::getInstance(){
+    if(!instance) instance = new TelemetryLog;
+    return instance;
+}
+
+
+bool TelemetryLog::enabled() const{
+    // the ranks have the same results (see DistTasks), only the first one writes them
+    return !Config_params::getInstance()->get_telemetry_file().empty() && DistTasks::is_root();
+}
+
+
+void TelemetryLog::write_row(const char * scope, int level, int group_id, const summary& in_summary){
+    if(file_ == NULL){
+        const std::string& f_name = Config_params::getInstance()->get_telemetry_file();
+        file_ = fopen(f_name.c_str(), "a");
+        if(file_ == NULL){
+            fprintf(stderr, "[TL] the telemetry file %s can't be opened, Exit!\n", f_name.c_str());
+            exit(1);
+        }
+        if(ftell(file_) == 0)       // new file
+            fprintf(file_, "exp_id,kf_id,level,group_id,scope,C,gamma,gmean,num_trainings,iterations,kernel_evals,"
+                           "cache_hits,cache_misses,cache_hit_rate,shrink_rounds,reconstructions,max_iter_reached,"
+                           "build_time,solve_time,predict_time\n");
+    }
+    const train_telemetry& tt = in_summary.telemetry;
+    long requests = tt.cache_hits + tt.cache_misses;
+    std::map<measures,double>::const_iterator it_gm = in_summary.perf.find(Gmean);
+    fprintf(file_, "%d,%d,%d,%d,%s,%g,%g,%g,%d,%ld,%ld,%ld,%ld,%g,%ld,%ld,%d,%g,%g,%g\n",
+            Config_params::getInstance()->get_main_current_exp_id(), Config_params::getInstance()->get_main_current_kf_id(),
+            level, group_id, scope, in_summary.C, in_summary.gamma,
+            (it_gm != in_summary.perf.end()) ? it_gm->second : 0.0,
+            tt.num_trainings, tt.iterations, tt.kernel_evals, tt.cache_hits, tt.cache_misses,
+            (requests > 0) ? (double) tt.cache_hits / requests : 0.0,
+            tt.shrink_rounds, tt.reconstructions, tt.max_iter_reached,
+            tt.build_time, tt.solve_time, tt.predict_time);
+    fflush(file_);          // keep the rows of a run which crashes later
+}
+
+
+void TelemetryLog::write_candidate(int level, int group_id, const summary& candidate_summary){
+    std::lock_guard<std::mutex> lock(mtx_);
+    if(enabled())
+        write_row("candidate", level, group_id, candidate_summary);
+}
+
+
+void TelemetryLog::write_group(int level, int group_id, summary& group_summary, const train_telemetry& group_telemetry){
+    group_summary.telemetry = group_telemetry;
+    std::lock_guard<std::mutex> lock(mtx_);
+    level_telemetry_.add(group_telemetry);
+    if(enabled())
+        write_row("group", level, group_id, group_summary);
+}
+
+
+void TelemetryLog::end_level(int level, summary& level_summary){
+    std::lock_guard<std::mutex> lock(mtx_);
+    level_summary.telemetry = level_telemetry_;
+    level_telemetry_ = train_telemetry();
+    if(enabled())
+        write_row("level", level, -2, level_summary);
+}
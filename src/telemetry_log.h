@@ -0,0 +1,42 @@
+#ifndef TELEMETRY_LOG_H
+#define TELEMETRY_LOG_H
+
+#include "ds_global.h"
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+/*
+ * CSV of the training statistics (telemetry_file parameter, empty disables)
+ * a row per candidate (one training), per partition group (sum of its candidates) and per level (sum of its groups)
+ * the rows of the same run are told apart by the experiment, fold, level and group ids
+ * (group -1 is a level which is trained as a single model, e.g. the coarsest level, -2 is a level row)
+ * the C, gamma and G-mean of a group or level row belong to its selected model
+ * the file is appended, hence the runs with the same file can be compared
+ * the partition groups of a level are trained at the same time, their rows may be in any order
+ */
+class TelemetryLog{
+public:
+    static TelemetryLog* getInstance();
+
+    bool enabled() const;
+
+    void write_candidate(int level, int group_id, const summary& candidate_summary);
+
+    // the telemetry of group_summary is replaced by group_telemetry, the group is added to the current level
+    void write_group(int level, int group_id, summary& group_summary, const train_telemetry& group_telemetry);
+
+    // the telemetry of level_summary is replaced by the sum of the groups since the last end_level
+    void end_level(int level, summary& level_summary);
+
+private:
+    TelemetryLog(){}
+    static TelemetryLog* instance;
+    FILE * file_ = NULL;
+    train_telemetry level_telemetry_;
+    std::mutex mtx_;                        // the file and level_telemetry_
+
+    void write_row(const char * scope, int level, int group_id, const summary& in_summary);
+};
+
+#endif // TELEMETRY_LOG_H
@@ -0,0 +1,39 @@
+#!/bin/bash
+# runs mlsvm_classifier on several MPI ranks and checks that all the ranks print the same final results
+# (the ranks select the same models, see dist_tasks.h), run it in the folder of mlsvm_classifier
+# usage: ./tools/check_dist_ranks.sh [number of ranks, default 4] [arguments of mlsvm_classifier]
+# e.g.   ./tools/check_dist_ranks.sh 4 -f twonorm -x 1 -k 2
+num_ranks=${1:-4}
+shift
+log_dir=$(mktemp -d ./dist_ranks_XXXX)
+
+# each rank writes its own log (Open MPI, MPICH and PMIx set one of these rank variables)
+mpirun -n $num_ranks bash -c 'rank=${OMPI_COMM_WORLD_RANK:-${PMI_RANK:-${PMIX_RANK:-0}}}
+                              exec ./mlsvm_classifier "$@" > '"$log_dir"'/rank_$rank.log 2>&1' mlsvm_classifier "$@"
+if [ $? != 0 ]; then
+    echo "mpirun failed, see the logs in $log_dir"
+    exit 1
+fi
+
+# the final results of each experiment and the averages
+for ((r=0; r < num_ranks; r++)); do
+    grep "\[CP\]\[PFR\]\|Acc:.*GM:" $log_dir/rank_$r.log > $log_dir/final_$r.txt
+done
+if [ ! -s $log_dir/final_0.txt ]; then
+    echo "rank 0 printed no final results, see $log_dir/rank_0.log"
+    exit 1
+fi
+num_different=0
+for ((r=1; r < num_ranks; r++)); do
+    if ! cmp -s $log_dir/final_0.txt $log_dir/final_$r.txt; then
+        echo "rank $r has different final results:"
+        diff $log_dir/final_0.txt $log_dir/final_$r.txt
+        num_different=$((num_different + 1))
+    fi
+done
+cat $log_dir/final_0.txt
+if [ $num_different != 0 ]; then
+    echo "FAILED: $num_different of $num_ranks ranks differ from rank 0, the logs are in $log_dir"
+    exit 1
+fi
+echo "passed: the $num_ranks ranks have the same final results (the logs are in $log_dir)"
@@ -3,7 +3,12 @@
 #include "../solver.h"
 #include "../OptionParser.h"
 #include "../loader.h"
+#include "../model_binary.h"
+#include "../rff_approx.h"
+#include "../prediction_set.h"
+#include "../partitioning.h"
 #include "fstream"
+#include <memory>
 
 Config_params* Config_params::instance = NULL;
 
@@ -142,37 +147,164 @@ int main(int argc, char **argv){
         std::string model_name = models_path + Config_params::getInstance()->get_ds_name() +
                 "_exp_" + std::to_string(Config_params::getInstance()->get_experiment_id()) +
                 "_kf_" + std::to_string(Config_params::getInstance()->get_kfold_id()) +
-                "_level_" +  std::to_string(level_id) + ".svmmodel";
-        svm_model * trained_model = svm_load_model(model_name.c_str());
+                "_level_" +  std::to_string(level_id);
+        // the binary model is mapped without parsing, the text model is the fallback for the older exports
+        ModelBinary mb;
+        svm_model * trained_model;
+        if(mb.load(model_name + ".svmbin")){
+            trained_model = mb.get_model();
+            model_name += ".svmbin";
+        }else{
+            model_name += ".svmmodel";
+            trained_model = svm_load_model(model_name.c_str());
+            if(trained_model == NULL){
+                std::cerr << "[Predict] can't load the model " << model_name << "\n Exit" << std::endl;
+                exit(1);
+            }
+            if(Config_params::getInstance()->get_svm_linear_weights())
+                svm_build_linear_weights(trained_model);
+        }
+        if(Config_params::getInstance()->get_svm_early_exit())
+            svm_build_early_exit(trained_model);        // freed with the model (or by the ModelBinary)
         std::cout << "model name:" << model_name << ", nSV:" << *(trained_model->nSV) <<"\n";
         summary final_summary;
         Solver sv;
         sv.set_local_model(trained_model);
+
+        // - - - - - compile the RBF model to random Fourier features for a fixed cost per point - - - - -
+        int rff_dim = Config_params::getInstance()->get_svm_rff_dim();
+        std::unique_ptr<RffApproximation> rff_approx;
+        if(rff_dim > 0 && trained_model->param.kernel_type == RBF){
+            PetscInt num_col;
+            MatGetSize(m_test_data, NULL, &num_col);
+            rff_approx.reset(new RffApproximation(rff_dim, num_col - 1));     // the 1st column is the label
+            int approx_id = rff_approx->add_model(trained_model);
+            std::cout << "[Predict] approximate RBF with " << rff_dim << " random features\n";
+            int rff_check = Config_params::getInstance()->get_svm_rff_check();
+            if(rff_check > 0){                  // the exact model predicts the sampled points only
+                PredictionSet td_set(m_test_data);
+                std::cout << "[Predict] agreement with the exact model on " << std::min(rff_check, td_set.size()) <<
+                             " test points:" << rff_approx->agreement(trained_model, approx_id, td_set, rff_check) << "\n";
+            }
+            sv.set_approximation(rff_approx.get(), approx_id);
+        }
+        svm_reset_early_exit_stats();
         sv.test_predict(m_test_data, final_summary );
         Config_params::getInstance()->print_summary(final_summary,"stand alone predict");
-
-    }else{      //multiple models
-        std::cout << "Start prediction for multiple models\n";
-        std::cout << "Not supported yet!\n Exit\n";
-        exit(1);
+        long num_predictions, num_evaluated, num_total;
+        svm_get_early_exit_stats(&num_predictions, &num_evaluated, &num_total);
+        if(num_predictions > 0)
+            std::cout << "[Predict] early exit evaluated " << (double) num_evaluated / num_total <<
+                         " of the SVs on average (" << num_predictions << " points)\n";
+
+    }else{      //multiple models (the partition groups of the selected level)
+        std::cout << "Start prediction for " << num_models << " models\n";
+        // the binary models are mapped without parsing (hundreds of groups), they keep the centers of their groups
+        std::vector<std::unique_ptr<ModelBinary>> v_mb(num_models);
+        std::vector<svm_model *> v_models(num_models, NULL);
+        std::vector<svm_model *> v_text_models;         // the older exports (no center), freed at the end
+        bool need_centers = Config_params::getInstance()->get_pr_maj_voting_id() != 1;  // 1: plain majority voting
+        long center_dim = 0;
         for(int i=0; i< num_models; i++){
             std::string model_name = models_path + Config_params::getInstance()->get_ds_name() +
                     "_exp_" + std::to_string(Config_params::getInstance()->get_experiment_id()) +
                     "_kf_" + std::to_string(Config_params::getInstance()->get_kfold_id()) +
                     "_level_" +  std::to_string(level_id) +
-                    "_gid_" +  std::to_string(i) + ".svmmodel";
-
-            // save the avg_calc during the training phase
-            // load the avg_calc here
-            // load a model and predict all the TD points (probably a matrix- each column/row for a model)
-            // calculate the the distance of each TD point to all the avg_calc or vise versa (another matrix)
-            // pass the predicted labels and distance matrices to majority voting function to calc the final label
-
-
+                    "_gid_" +  std::to_string(i);
+            v_mb[i].reset(new ModelBinary);
+            if(v_mb[i]->load(model_name + ".svmbin")){
+                v_models[i] = v_mb[i]->get_model();
+                center_dim = std::max(center_dim, v_mb[i]->get_center_dim());
+            }else{
+                v_mb[i].reset();
+                v_models[i] = svm_load_model((model_name + ".svmmodel").c_str());
+                if(v_models[i] == NULL){
+                    std::cerr << "[Predict] can't load the model " << model_name << "(.svmbin|.svmmodel)\n Exit" << std::endl;
+                    exit(1);
+                }
+                v_text_models.push_back(v_models[i]);
+                if(Config_params::getInstance()->get_svm_linear_weights())
+                    svm_build_linear_weights(v_models[i]);
+            }
+            if(need_centers && (!v_mb[i] || v_mb[i]->get_center() == NULL)){
+                std::cerr << "[Predict] the model " << model_name << " has no center of its group, it is needed by pr_maj_voting_id:" <<
+                             Config_params::getInstance()->get_pr_maj_voting_id() << " (export the binary models)\n Exit" << std::endl;
+                exit(1);
+            }
+            if(Config_params::getInstance()->get_svm_early_exit())
+                svm_build_early_exit(v_models[i]);
+        }
 
+        // - - - - - the predictions of each model in its row, the same as the refinement - - - - -
+        PetscInt num_points;
+        MatGetSize(m_test_data, &num_points, NULL);
+        std::vector<Mat> v_mat_predicted(1), v_mat_centers(1);
+        MatCreateSeqDense(PETSC_COMM_SELF, num_models, num_points, NULL, &v_mat_predicted[0]);
+        MatCreateSeqAIJ(PETSC_COMM_SELF, num_models, std::max(center_dim, 1L), std::max(center_dim, 1L), PETSC_NULL, &v_mat_centers[0]);
+        PredictionSet td_set(m_test_data);          // converted once for all the models
+        svm_reset_early_exit_stats();
+
+        // - - - - - the RBF groups share one random projection of each point, each model costs O(D) - - - - -
+        int rff_dim = Config_params::getInstance()->get_svm_rff_dim();
+        bool use_rff = rff_dim > 0;
+        for(int i=0; i< num_models; i++)
+            use_rff = use_rff && v_models[i]->param.kernel_type == RBF && v_models[i]->nr_class == 2;
+        if(use_rff){
+            PetscInt num_col;
+            MatGetSize(m_test_data, NULL, &num_col);
+            RffApproximation rff_approx(rff_dim, num_col - 1);      // the 1st column is the label
+            for(int i=0; i< num_models; i++)
+                rff_approx.add_model(v_models[i]);
+            std::cout << "[Predict] approximate " << num_models << " RBF models with " << rff_dim << " random features\n";
+            int rff_check = Config_params::getInstance()->get_svm_rff_check();
+            if(rff_check > 0){
+                double sum_agreement = 0;
+                for(int i=0; i< num_models; i++)
+                    sum_agreement += rff_approx.agreement(v_models[i], i, td_set, rff_check);
+                std::cout << "[Predict] mean agreement with the exact models on " << std::min(rff_check, td_set.size()) <<
+                             " test points:" << sum_agreement / num_models << "\n";
+            }
+            std::vector<PetscInt> v_rows(num_models);
+            for(int i=0; i< num_models; i++)
+                v_rows[i] = i;
+            std::vector<PetscScalar> v_labels(num_models);
+            for(PetscInt j=0; j < num_points; j++){
+                rff_approx.predict_all(td_set.row(j), v_labels.data());
+                MatSetValues(v_mat_predicted[0], num_models, v_rows.data(), 1, &j, v_labels.data(), INSERT_VALUES);
+            }
+        }
+        for(int i=0; i< num_models; i++){
+            if(!use_rff){
+                Solver sv;
+                sv.set_local_model(v_models[i]);
+                sv.predict_test_data_in_matrix_output(td_set, i, v_mat_predicted[0]);
+            }
+            if(v_mb[i] && v_mb[i]->get_center() != NULL){
+                const double * center = v_mb[i]->get_center();
+                for(long j=0; j < v_mb[i]->get_center_dim(); j++)
+                    if(center[j] != 0)
+                        MatSetValue(v_mat_centers[0], i, j, center[j], INSERT_VALUES);
+            }
         }
-        //print the results
-//        Config_params::getInstance()->print_summary(final_summary,"stand alone predict");
+        MatAssemblyBegin(v_mat_predicted[0], MAT_FINAL_ASSEMBLY);
+        MatAssemblyEnd(v_mat_predicted[0], MAT_FINAL_ASSEMBLY);
+        MatAssemblyBegin(v_mat_centers[0], MAT_FINAL_ASSEMBLY);
+        MatAssemblyEnd(v_mat_centers[0], MAT_FINAL_ASSEMBLY);
+
+        summary final_summary;
+        Partitioning pt;
+        pt.calc_performance_measure(m_test_data, v_mat_centers, v_mat_predicted, final_summary);
+        Config_params::getInstance()->print_summary(final_summary,"stand alone predict");
+        long num_predictions, num_evaluated, num_total;
+        svm_get_early_exit_stats(&num_predictions, &num_evaluated, &num_total);
+        if(num_predictions > 0)
+            std::cout << "[Predict] early exit evaluated " << (double) num_evaluated / num_total <<
+                         " of the SVs on average (" << num_predictions << " points)\n";
+
+        MatDestroy(&v_mat_predicted[0]);
+        MatDestroy(&v_mat_centers[0]);
+        for(svm_model * text_model : v_text_models)
+            svm_free_and_destroy_model(&text_model);
     }
 
     std::cout << "MLSVM predict finished successfully!\n";
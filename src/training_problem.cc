@@ -0,0 +1,213 @@
+#include "training_problem.h"
+#include "buffer_pool.h"
+#include "task_pool.h"
+#include "config_logs.h"
+#include <cmath>
+
+
+template<typename T> T * TrainingProblem::alloc_buffer(size_t num_elements){
+    if(buffer_pool_ != NULL)
+        return buffer_pool_->acquire_array<T>(num_elements);
+    return Malloc(T, num_elements);
+}
+
+void TrainingProblem::free_buffer(void * ptr){
+    if(buffer_pool_ != NULL)
+        buffer_pool_->release(ptr);
+    else
+        free(ptr);
+}
+
+
+//=========== read the training data using the vector of indices ============
+TrainingProblem::TrainingProblem(Mat& m_train_data_p, Vec& v_vol_p, Mat& m_train_data_n, Vec& v_vol_n,
+                                 const std::vector<PetscInt>& v_p_index, const std::vector<PetscInt>& v_n_index,
+                                 PetscInt iter_p_end, PetscInt iter_n_end, BufferPool * buffer_pool)
+    : buffer_pool_(buffer_pool), num_p_(iter_p_end), num_n_(iter_n_end){
+#if dbl_SV_RPIB >= 3
+    printf("[TP] DEBUG start TrainingProblem\n");
+#endif
+    std::lock_guard<std::mutex> petsc_lock(TaskPool::petsc_mutex());      // the candidates may build their own problems at the same time
+    PetscInt i=0, j=0, l=0, ncols;
+    const PetscInt    *cols;                        //if not NULL, the column numbers
+    const PetscScalar *vals;
+    PetscInt num_total_nodes=0, num_elements_=0;
+
+    PetscScalar sum_all_vol_p=0, sum_all_vol_n=0;       // The sum of indices which are sent are important not all the points in the vector
+    PetscScalar     *arr_vol_p, *arr_vol_n;
+    VecGetArray(v_vol_p,&arr_vol_p);                // the restore goes at the end of each class
+    VecGetArray(v_vol_n,&arr_vol_n);
+
+#if dbl_SV_RPIB >= 7
+    printf("[TP] m_train_data_p matrix:\n");                   //$$debug
+    MatView(m_train_data_p, PETSC_VIEWER_STDOUT_WORLD);
+    printf("[TP] m_train_data_n matrix:\n");                   //$$debug
+    MatView(m_train_data_n, PETSC_VIEWER_STDOUT_WORLD);
+#endif
+
+// - - - - - - find number of nodes and elements - - - - - - -
+    num_total_nodes = num_p_ + num_n_;
+#if dbl_SV_RPIB >= 1
+    printf("[TP] number of P_data: %d, N_data: %d, total_nodes :%d \n", num_p_, num_n_, num_total_nodes);     //$$debug
+#endif
+//---- Count number of non zero elements -----
+    // for positive class
+    for (i=0; i< num_p_;i++){
+        MatGetRow(m_train_data_p, v_p_index[i],&ncols, &cols, &vals);                 // data points
+        num_elements_ += ncols + 1;     // +1 : for the end of line index
+        MatRestoreRow(m_train_data_p, v_p_index[i],&ncols, &cols, &vals);
+        sum_all_vol_p += arr_vol_p[v_p_index[i]];                                  // sum up the selected volumes
+    }
+    // for negative class
+    for (i=0; i< num_n_;i++){
+        MatGetRow(m_train_data_n, v_n_index[i],&ncols, &cols, &vals);
+        num_elements_ += ncols + 1;     // +1 : for the end of line index
+        MatRestoreRow(m_train_data_n, v_n_index[i],&ncols, &cols, &vals);
+        sum_all_vol_n += arr_vol_n[v_n_index[i]];                                   // sum up the selected volumes
+    }
+    sum_vol_p_ = sum_all_vol_p;
+    sum_vol_n_ = sum_all_vol_n;
+#if dbl_SV_RPIB >= 3
+    printf("[TP] sum all vol p:%g \t sum all vol n:%g\n",sum_all_vol_p,sum_all_vol_n);                  //$$debug
+    #if dbl_SV_RPIB >= 5
+        printf("[TP] total number of elems for both classes (one column as terminator [-1,0]):%d\n",num_elements_);
+    #endif
+#endif
+
+#if weight_instance == 1
+    PetscScalar        min_vol=0, max_vol=0;
+    PetscScalar        sq_inv_sum_vol_p=pow(1.0/sum_all_vol_p, 2);
+    PetscScalar        sq_inv_sum_vol_n=pow(1.0/sum_all_vol_n, 2);
+#endif
+
+//---- read the data to prob for libsvm -----
+    prob_.y = alloc_buffer<double>(num_total_nodes);
+    #if weight_instance == 1
+        prob_.W = alloc_buffer<double>(num_total_nodes);
+    #endif
+    prob_.x = alloc_buffer<struct svm_node *>(num_total_nodes);
+    x_space_ = alloc_buffer<struct svm_node>(num_elements_);
+
+    // - - - - set the problem from the data and volume - - - -
+    prob_.l = num_total_nodes;
+    // - - - - - read positive data - - - - -
+    j=0;                //set the j as an index to go through the x_space_
+    for (i=0; i< num_p_;i++){
+        unsigned long ul_target_index = v_p_index[i];
+        prob_.y[i] = 1;
+
+        #if weight_instance == 1
+            prob_.W[i] = arr_vol_p[ul_target_index] * sq_inv_sum_vol_p;      ///* instance weight */
+            if(prob_.W[i] < min_vol)
+                min_vol = prob_.W[i];    //store the min
+            if(prob_.W[i] > max_vol)
+                max_vol = prob_.W[i];    //store the max
+        #endif
+
+        prob_.x[i] = &x_space_[j];
+        MatGetRow(m_train_data_p, ul_target_index,&ncols, &cols, &vals);
+#if dbl_SV_RPIB >= 3
+        if(ncols == 0){
+            printf("[TP]  *** Error *** Empty row at %d row in m_train_data_p! Exit\n",i);
+            exit(1);
+        }
+#endif
+        for (l=0; l< ncols; l++) {      // only the nonzeros, the sparse rows leave no gaps in x_space_
+            x_space_[j].index = cols[l]+1;   //the libsvm use 1 index instead of zero
+            x_space_[j].value = vals[l];
+            ++j;
+        }
+        //create the end element of each node (-1,0)
+        x_space_[j].index = -1;
+        x_space_[j].value = 0;
+        ++j;
+
+        MatRestoreRow(m_train_data_p, ul_target_index,&ncols, &cols, &vals);
+    }
+    VecRestoreArray(v_vol_p,&arr_vol_p);
+#if dbl_SV_RPIB >= 3
+    printf("[TP] end of positive class, i is :%d,num of elements(j) is :%d\n",i,j);
+#endif
+
+    // - - - - - read negative data - - - - -
+    for (i=0; i< num_n_;i++){
+        unsigned long ul_target_index = v_n_index[i];
+        prob_.y[i+num_p_] = -1;
+
+        #if weight_instance == 1
+            prob_.W[i+num_p_] = arr_vol_n[ul_target_index] * sq_inv_sum_vol_n;
+            if(prob_.W[i+num_p_] < min_vol)
+                min_vol = prob_.W[i+num_p_];    //store the min
+            if(prob_.W[i+num_p_] > max_vol)
+                max_vol = prob_.W[i+num_p_];    //store the max
+        #endif
+
+        prob_.x[i+num_p_] = &x_space_[j];
+        MatGetRow(m_train_data_n, ul_target_index,&ncols, &cols, &vals);
+
+        for (l=0; l< ncols; l++) {
+            x_space_[j].index = cols[l]+1;   //the libsvm use 1 index instead of zero
+            x_space_[j].value = vals[l];
+            ++j;
+        }
+        //create the end element of each node (-1,0)
+        x_space_[j].index = -1;
+        x_space_[j].value = 0;
+        ++j;
+
+        MatRestoreRow(m_train_data_n, ul_target_index,&ncols, &cols, &vals);
+    }
+    VecRestoreArray(v_vol_n,&arr_vol_n);
+#if dbl_SV_RPIB >= 3
+    printf("[TP] end of negative class, i is :%d,num of elements(j) is :%d\n",i,j);
+#endif
+
+#if weight_instance == 1
+    // - - - - normaliz instance weights between 0 and 1
+    PetscScalar vol_range = max_vol - min_vol;
+    for(PetscInt i = 0; i < num_total_nodes; i++){
+        prob_.W[i] = (prob_.W[i] - min_vol) / vol_range ;
+    }
+#endif
+    if(Config_params::getInstance()->get_svm_mixed_precision())
+        single_rows_ = svm_single_rows_create(&prob_);
+//    Don't Destroy input matrices at all    ( They are deleted after 2nd stage of model selection )
+}
+
+
+//=========== view of some rows of a problem (e.g. the subsamples of the successive halving) ============
+TrainingProblem::TrainingProblem(const TrainingProblem& full, const std::vector<int>& v_rows_p, const std::vector<int>& v_rows_n)
+    : num_p_(v_rows_p.size()), num_n_(v_rows_n.size()), sum_vol_p_(full.sum_vol_p_), sum_vol_n_(full.sum_vol_n_){
+    PetscInt num_total_nodes = num_p_ + num_n_;
+    prob_.l = num_total_nodes;
+    prob_.y = alloc_buffer<double>(num_total_nodes);
+#if weight_instance == 1
+    prob_.W = alloc_buffer<double>(num_total_nodes);
+#endif
+    prob_.x = alloc_buffer<struct svm_node *>(num_total_nodes);
+    for(PetscInt i=0; i < num_total_nodes; i++){
+        int row = (i < num_p_) ? v_rows_p[i] : full.num_p_ + v_rows_n[i - num_p_];
+        prob_.y[i] = full.prob_.y[row];
+#if weight_instance == 1
+        prob_.W[i] = full.prob_.W[row];
+#endif
+        prob_.x[i] = full.prob_.x[row];
+    }
+    if(full.single_rows_ != NULL){
+        std::vector<int> v_rows(num_total_nodes);
+        for(PetscInt i=0; i < num_total_nodes; i++)
+            v_rows[i] = (i < num_p_) ? v_rows_p[i] : full.num_p_ + v_rows_n[i - num_p_];
+        single_rows_ = svm_single_rows_select(full.single_rows_, v_rows.data(), num_total_nodes);
+    }
+}
+
+
+TrainingProblem::~TrainingProblem(){
+    free_buffer(prob_.y);
+#if weight_instance == 1
+    free_buffer(prob_.W);
+#endif
+    free_buffer(prob_.x);
+    free_buffer(x_space_);
+    svm_single_rows_destroy(&single_rows_);
+}
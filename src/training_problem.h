@@ -0,0 +1,50 @@
+#ifndef TRAINING_PROBLEM_H
+#define TRAINING_PROBLEM_H
+
+#include "solver.h"
+#include <vector>
+
+/*
+ * libsvm problem of a partition group (positive points first, then negative points) with the instance weights
+ * it is built once from the selected rows and shared read-only by the Solvers of all the (C, gamma) candidates
+ * the sum of the volumes of each class is kept for the class weights (weighted SVM without instance weights)
+ * the arrays come from the pool if it is set, the pool should be alive as long as this object
+ * the models of the Solvers point to the rows of this problem, hence it should outlive them (Solver keeps a reference)
+ * with svm_mixed_precision the float rows of the training kernels are built once here as well (dense data only)
+ */
+class TrainingProblem{
+public:
+    TrainingProblem(Mat& m_data_p, Vec& v_vol_p, Mat& m_data_n, Vec& v_vol_n,
+                    const std::vector<PetscInt>& v_p_index, const std::vector<PetscInt>& v_n_index,
+                    PetscInt iter_p_end, PetscInt iter_n_end, BufferPool * buffer_pool = NULL);
+
+    /*
+     * view of some rows of full, v_rows_p and v_rows_n are the positive and negative rows of full (0 is its 1st negative row)
+     * the nodes are not copied and the instance weights are the ones of full, hence full should outlive the view
+     * the volume sums are the ones of full (they are used only without the instance weights)
+     */
+    TrainingProblem(const TrainingProblem& full, const std::vector<int>& v_rows_p, const std::vector<int>& v_rows_n);
+    ~TrainingProblem();
+    TrainingProblem(const TrainingProblem&) = delete;
+    TrainingProblem& operator=(const TrainingProblem&) = delete;
+
+    const svm_problem& get_problem() const { return prob_; }
+    PetscInt get_num_p() const { return num_p_; }
+    PetscInt get_num_n() const { return num_n_; }
+    double get_sum_vol_p() const { return sum_vol_p_; }
+    double get_sum_vol_n() const { return sum_vol_n_; }
+    const svm_single_rows * get_single_rows() const { return single_rows_; }     // NULL: double kernels
+
+private:
+    svm_problem prob_;
+    svm_node * x_space_ = NULL;
+    svm_single_rows * single_rows_ = NULL;
+    BufferPool * buffer_pool_ = NULL;
+    PetscInt num_p_ = 0, num_n_ = 0;
+    double sum_vol_p_ = 0, sum_vol_n_ = 0;
+
+    template<typename T> T * alloc_buffer(size_t num_elements);
+    void free_buffer(void * ptr);
+};
+
+#endif // TRAINING_PROBLEM_H
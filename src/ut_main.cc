@@ -7,7 +7,8 @@
 #include "ut_cf.h"
 #include "ut_cs.h"
 #include "ut_ld.h"
-#include "ut_clustering_rf.h"
+#include "ut_svm.h"
+//#include "ut_clustering_rf.h"       // not in the tree
 
 Config_params* Config_params::instance = NULL;
 
@@ -67,12 +68,33 @@ int main(int argc, char **argv)
 //    UT_CS utcs;
 //    utcs.test_calc_p();
 
-    ut_Clustering_rf utrf;
-    utrf.test_calc_new_center();
+//    ut_Clustering_rf utrf;
+//    utrf.test_calc_new_center();
+
+    /* early exit of the RBF predictions gives the same labels as the full sum */
+    UT_SVM utsvm;
+    int num_failed = utsvm.test_early_exit();
+    /* the binary models are read back (and the corrupted ones are rejected) */
+    num_failed += utsvm.test_model_binary();
+    /* the stacked linear models give the labels of the linear models */
+    num_failed += utsvm.test_stacked_linear();
+    /* the partition groups trained by the threads give the results of a single thread */
+    num_failed += utsvm.test_threaded_groups();
+
+    /* the rungs of the successive halving and the rows of the training problems */
+    UT_MS utms;
+    num_failed += utms.test_successive_halving();
+    num_failed += utms.test_training_problem();
+    num_failed += utms.test_bayes_opt();
+    num_failed += utms.test_result_cache();
+
+    /* the cost model of the adaptive partition sizes */
+    UT_Partitioning ut_pr;
+    num_failed += ut_pr.test_partition_sizing();
 
 
     
     PetscFinalize();
-    return 0;
+    return (num_failed == 0) ? 0 : 1;
 }
 
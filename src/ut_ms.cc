@@ -1,6 +1,8 @@
 #include "ut_ms.h"
 
 #include "math.h"
+#include <cstdio>
+#include <string>
 
 void UT_MS::test_params(){
 //    ms_range c_range, gamma_range;
@@ -37,3 +39,252 @@ void UT_MS::test_params(){
 
 
 
+
+
+int UT_MS::test_successive_halving(){
+    int num_failed = 0;
+    // - - - - - 27 candidates, eta 3 - - - - -
+    std::vector<sh_rung> v_rungs = sh_schedule(27, 3);
+    const int arr_candidates[] = {27, 9};
+    const int arr_promoted[] = {9, 3};
+    const double arr_fraction[] = {1.0 / 9, 1.0 / 3};
+    if(v_rungs.size() != 2){
+        printf("[UT_MS][SH] 27 candidates, eta 3: %zu rungs instead of 2\n", v_rungs.size());
+        ++num_failed;
+    }else{
+        for(int r=0; r < 2; r++){
+            printf("[UT_MS][SH] rung:%d, candidates:%d, promoted:%d, fraction:%g\n",
+                   r, v_rungs[r].num_candidates, v_rungs[r].num_promoted, v_rungs[r].fraction);
+            if(v_rungs[r].num_candidates != arr_candidates[r] || v_rungs[r].num_promoted != arr_promoted[r] ||
+                    fabs(v_rungs[r].fraction - arr_fraction[r]) > 1e-12)
+                ++num_failed;
+        }
+    }
+    // - - - - - the promotions are rounded up and each rung takes eta times more points - - - - -
+    v_rungs = sh_schedule(10, 2);           // 10 -> 5 -> 3 -> 2 survivors
+    if(v_rungs.size() != 3 || v_rungs[0].num_promoted != 5 || v_rungs[1].num_promoted != 3 ||
+            v_rungs[2].num_promoted != 2 || fabs(v_rungs[0].fraction - 1.0 / 8) > 1e-12){
+        printf("[UT_MS][SH] 10 candidates, eta 2: wrong rungs\n");
+        ++num_failed;
+    }
+    if(!sh_schedule(3, 3).empty()){         // the candidates are trained on all the points
+        printf("[UT_MS][SH] 3 candidates, eta 3: the rungs are not empty\n");
+        ++num_failed;
+    }
+    // - - - - - subsample sizes - - - - -
+    if(sh_subsample_size(900, 1.0 / 9) != 100 || sh_subsample_size(900, 1.0 / 3) != 300 ||
+            sh_subsample_size(100, 1.0 / 9) != 20 || sh_subsample_size(10, 1.0 / 9) != 10 ||
+            sh_subsample_size(1000, 1.0 / 3) != 334){
+        printf("[UT_MS][SH] wrong subsample sizes\n");
+        ++num_failed;
+    }
+    printf("[UT_MS][SH] %s\n", (num_failed == 0) ? "passed" : "FAILED");
+    return num_failed;
+}
+
+
+int UT_MS::test_training_problem(){
+    // rows with different numbers of nonzeros (the 2nd positive row is empty in the unused columns only)
+    const PetscInt num_col = 6;
+    const double arr_p[4][num_col] = {{1, 0, 0, 2, 0, 0},
+                                      {0, 0, 3, 0, 0, 0},
+                                      {4, 5, 6, 7, 8, 9},
+                                      {0, 0, 0, 0, 0, 1}};
+    const double arr_n[3][num_col] = {{0, 2, 0, 0, 0, 0},
+                                      {1, 0, 1, 0, 1, 0},
+                                      {0, 0, 0, 0, 4, 0}};
+    const double arr_vol_p[4] = {1, 2, 3, 4};
+    const double arr_vol_n[3] = {5, 6, 7};
+    Mat m_p, m_n;
+    Vec v_vol_p, v_vol_n;
+    MatCreateSeqAIJ(PETSC_COMM_SELF, 4, num_col, num_col, PETSC_NULL, &m_p);
+    MatCreateSeqAIJ(PETSC_COMM_SELF, 3, num_col, num_col, PETSC_NULL, &m_n);
+    VecCreateSeq(PETSC_COMM_SELF, 4, &v_vol_p);
+    VecCreateSeq(PETSC_COMM_SELF, 3, &v_vol_n);
+    for(PetscInt i=0; i < 4; i++){
+        for(PetscInt j=0; j < num_col; j++)
+            if(arr_p[i][j] != 0)
+                MatSetValue(m_p, i, j, arr_p[i][j], INSERT_VALUES);
+        VecSetValue(v_vol_p, i, arr_vol_p[i], INSERT_VALUES);
+    }
+    for(PetscInt i=0; i < 3; i++){
+        for(PetscInt j=0; j < num_col; j++)
+            if(arr_n[i][j] != 0)
+                MatSetValue(m_n, i, j, arr_n[i][j], INSERT_VALUES);
+        VecSetValue(v_vol_n, i, arr_vol_n[i], INSERT_VALUES);
+    }
+    MatAssemblyBegin(m_p, MAT_FINAL_ASSEMBLY);
+    MatAssemblyEnd(m_p, MAT_FINAL_ASSEMBLY);
+    MatAssemblyBegin(m_n, MAT_FINAL_ASSEMBLY);
+    MatAssemblyEnd(m_n, MAT_FINAL_ASSEMBLY);
+    VecAssemblyBegin(v_vol_p);
+    VecAssemblyEnd(v_vol_p);
+    VecAssemblyBegin(v_vol_n);
+    VecAssemblyEnd(v_vol_n);
+
+    // the selected rows are out of order and the last index of each class is beyond iter_end (not used)
+    std::vector<PetscInt> v_p_index = {2, 0, 3, 1};
+    std::vector<PetscInt> v_n_index = {1, 2, 0};
+    int num_failed = 0;
+    {
+        TrainingProblem full(m_p, v_vol_p, m_n, v_vol_n, v_p_index, v_n_index, 3, 2);
+        const svm_problem& prob = full.get_problem();
+        if(prob.l != 5 || full.get_num_p() != 3 || full.get_num_n() != 2 ||
+                full.get_sum_vol_p() != 3 + 1 + 4 || full.get_sum_vol_n() != 6 + 7){
+            printf("[UT_MS][TP] l:%d, P:%d, N:%d, sum vol P:%g, N:%g\n", prob.l, full.get_num_p(), full.get_num_n(),
+                   full.get_sum_vol_p(), full.get_sum_vol_n());
+            ++num_failed;
+        }
+        int num_wrong_rows = 0;
+        const svm_node * next_row = prob.x[0];
+        for(int i=0; i < prob.l; i++){
+            bool is_p = i < 3;
+            const double * arr_row = is_p ? arr_p[v_p_index[i]] : arr_n[v_n_index[i - 3]];
+            const svm_node * px = prob.x[i];
+            bool same = (px == next_row) && prob.y[i] == (is_p ? 1 : -1);       // no gap after the previous row
+            for(PetscInt j=0; j < num_col; j++){
+                if(arr_row[j] == 0)
+                    continue;
+                same = same && px->index == j + 1 && px->value == arr_row[j];
+                ++px;
+            }
+            same = same && px->index == -1;
+            next_row = px + 1;
+            if(!same){
+                printf("[UT_MS][TP] row %d is not the nonzeros of its data row\n", i);
+                ++num_wrong_rows;
+            }
+        }
+        num_failed += num_wrong_rows;
+
+        // - - - - - the view of the 2nd positive and both negative rows - - - - -
+        std::vector<int> v_rows_p = {1};
+        std::vector<int> v_rows_n = {1, 0};
+        TrainingProblem view(full, v_rows_p, v_rows_n);
+        const svm_problem& view_prob = view.get_problem();
+        const int arr_full_row[] = {1, 3 + 1, 3 + 0};
+        bool same_view = view_prob.l == 3 && view.get_num_p() == 1 && view.get_num_n() == 2 &&
+                view.get_sum_vol_p() == full.get_sum_vol_p() && view.get_sum_vol_n() == full.get_sum_vol_n();
+        for(int i=0; same_view && i < 3; i++){
+            same_view = view_prob.x[i] == prob.x[arr_full_row[i]] && view_prob.y[i] == prob.y[arr_full_row[i]];
+#if weight_instance == 1
+            same_view = same_view && view_prob.W[i] == prob.W[arr_full_row[i]];
+#endif
+        }
+        if(!same_view){
+            printf("[UT_MS][TP] the view doesn't share the rows of the full problem\n");
+            ++num_failed;
+        }
+    }
+    MatDestroy(&m_p);
+    MatDestroy(&m_n);
+    VecDestroy(&v_vol_p);
+    VecDestroy(&v_vol_n);
+    printf("[UT_MS][TP] %s\n", (num_failed == 0) ? "passed" : "FAILED");
+    return num_failed;
+}
+
+
+int UT_MS::test_bayes_opt(){
+    int num_failed = 0;
+    // - - - - - a quadratic surface with the maximum off the grid of the expected improvement - - - - -
+    const double opt_c = 4.3, opt_g = -6.2;
+    auto gmean = [&](double log_c, double log_g){
+        return 0.9 - ((log_c - opt_c) * (log_c - opt_c) + (log_g - opt_g) * (log_g - opt_g)) / 400;
+    };
+    BayesOpt bo(-5, 15, -15, 5);
+    const double arr_init[5][2] = {{-5, -15}, {15, 5}, {-5, 5}, {15, -15}, {5, -5}};    // the corners and the center
+    double best_c = 0, best_g = 0, best_gmean = -1;
+    for(int i=0; i < 5; i++){
+        bo.add({arr_init[i][0], arr_init[i][1], gmean(arr_init[i][0], arr_init[i][1])});
+        if(gmean(arr_init[i][0], arr_init[i][1]) > best_gmean){
+            best_gmean = gmean(arr_init[i][0], arr_init[i][1]);
+            best_c = arr_init[i][0];
+            best_g = arr_init[i][1];
+        }
+    }
+    double ei = 0;
+    for(int it=0; it < 10; it++){
+        double log_c, log_g;
+        ei = bo.next(log_c, log_g);
+        bo.add({log_c, log_g, gmean(log_c, log_g)});
+        if(gmean(log_c, log_g) > best_gmean){
+            best_gmean = gmean(log_c, log_g);
+            best_c = log_c;
+            best_g = log_g;
+        }
+    }
+    double dist = sqrt((best_c - opt_c) * (best_c - opt_c) + (best_g - opt_g) * (best_g - opt_g));
+    printf("[UT_MS][BO] best log C:%g, log gamma:%g, distance to the maximum:%g, last expected improvement:%g\n",
+           best_c, best_g, dist, ei);
+    if(dist > 1 || ei > 0.01)           // the grid step is 0.5
+        ++num_failed;
+
+    // - - - - - the history keeps the last ms_bo_priors observations - - - - -
+    unsigned int max_num = Config_params::getInstance()->get_ms_bo_priors();
+    for(unsigned int i=0; i < max_num + 10; i++)
+        BayesOpt::record({(double) i, 0, 0.5});
+    BayesOpt::begin_batch();
+    BayesOpt::record({-1, 1, 0.5}, 1);
+    BayesOpt::record({-1, 0, 0.5}, 0);
+    BayesOpt::end_batch();
+    std::vector<bo_observation> v_hist = BayesOpt::history(max_num + 100);
+    bool trimmed = v_hist.size() == max_num && (max_num < 2 ||
+            (v_hist[max_num - 2].log_g == 0 && v_hist[max_num - 1].log_g == 1));    // the groups in their order
+    printf("[UT_MS][BO] history of %zu observations (ms_bo_priors:%u)\n", v_hist.size(), max_num);
+    if(!trimmed)
+        ++num_failed;
+    printf("[UT_MS][BO] %s\n", (num_failed == 0) ? "passed" : "FAILED");
+    return num_failed;
+}
+
+
+int UT_MS::test_result_cache(){
+    const std::string old_f_name = Config_params::getInstance()->get_ms_cache_file();
+    const std::string f_name = "./ut_ms_result_cache.txt";
+    remove(f_name.c_str());
+    Config_params::getInstance()->debug_only_set_ms_cache_file(f_name);
+    ResultCache * rc = ResultCache::getInstance();
+    rc->init();
+
+    const uint64_t data_fp = 0x0123456789abcdefULL;
+    summary added;
+    added.iter = 3;
+    added.C = 1.0 / 3;                  // not exact in the text, the file keeps 17 digits
+    added.gamma = 0.0078125;
+    added.num_SV_p = 12;
+    added.num_SV_n = 34;
+    added.perf[Acc] = 0.875;
+    added.perf[Gmean] = 0.8123456789012345;
+    added.perf[F1] = 0.5;
+    rc->add(data_fp, added);
+
+    int num_failed = 0;
+    rc->init();                         // a new run reads the file
+    summary found;
+    if(!rc->find(data_fp, added.C, added.gamma, found)){
+        printf("[UT_MS][RC] the added result is not found after the file is loaded again\n");
+        ++num_failed;
+    }else if(found.C != added.C || found.gamma != added.gamma || found.num_SV_p != added.num_SV_p ||
+             found.num_SV_n != added.num_SV_n || found.perf != added.perf || found.telemetry.num_trainings != 0){
+        printf("[UT_MS][RC] the loaded result is different, C:%.17g, gamma:%.17g, nSV:%d/%d, G-mean:%.17g\n",
+               found.C, found.gamma, found.num_SV_p, found.num_SV_n, found.perf[Gmean]);
+        ++num_failed;
+    }
+    summary missed;
+    const bool arr_missed[] = {rc->find(data_fp, added.C * 2, added.gamma, missed),
+                               rc->find(data_fp, added.C, added.gamma * 2, missed),
+                               rc->find(data_fp + 1, added.C, added.gamma, missed)};
+    for(int i=0; i < 3; i++){
+        if(arr_missed[i]){
+            printf("[UT_MS][RC] a %s is found\n", (i == 0) ? "different C" : (i == 1) ? "different gamma" : "different fingerprint");
+            ++num_failed;
+        }
+    }
+
+    Config_params::getInstance()->debug_only_set_ms_cache_file(old_f_name);
+    rc->init();
+    remove(f_name.c_str());
+    printf("[UT_MS][RC] %s\n", (num_failed == 0) ? "passed" : "FAILED");
+    return num_failed;
+}
@@ -1,11 +1,33 @@
 #ifndef UT_MS_H
 #define UT_MS_H
 #include "model_selection.h"
+#include "bayes_opt.h"
+#include "result_cache.h"
 
 class UT_MS:ModelSelection
 {
 public:
     void test_params();
+    /*
+     * the rungs of the successive halving (27 candidates and eta 3: 27 on 1/9, 9 on 1/3, 3 survivors)
+     * and the subsample sizes of the classes, it returns the number of failed checks
+     */
+    int test_successive_halving();
+    /*
+     * TrainingProblem keeps only the nonzeros of the selected rows (the rows are contiguous in x_space)
+     * and the view of some rows shares the nodes of the full problem, it returns the number of failed checks
+     */
+    int test_training_problem();
+    /*
+     * the expected improvement of the Gaussian process finds the maximum of a quadratic G-mean surface
+     * and the history keeps the last ms_bo_priors observations, it returns the number of failed checks
+     */
+    int test_bayes_opt();
+    /*
+     * a result added to the cache file is found after the file is loaded again (same fingerprint, C and gamma),
+     * another C, gamma or fingerprint is a miss, it returns the number of failed checks
+     */
+    int test_result_cache();
 
 //    void test_UD();
 };
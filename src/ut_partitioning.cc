@@ -1,6 +1,8 @@
 #include "ut_partitioning.h"
 #include "vector"
 #include "partitioning.h"
+#include <algorithm>
+#include <cmath>
 
 
 void UT_Partitioning::test_find_groups(){
@@ -32,3 +34,65 @@ void UT_Partitioning::test_get_parts(){
     pr.get_parts(m_WA, v_vol, num_partitions_p, 1, vv_parts_p, m_parts );
 
 }
+
+int UT_Partitioning::test_partition_sizing(){
+    int num_failed = 0;
+    const double nnz = 20;
+    const double v_sizes[4] = {500, 1000, 2000, 4000};
+    // the probes of t(n) = c0 + c1 n d + c2 n^2 d
+    auto fit_timings = [&](double c0, double c1, double c2){
+        v_probes_.clear();
+        for(double size : v_sizes)
+            v_probes_.push_back({size, nnz, c0 + c1 * size * nnz + c2 * size * size * nnz});
+        std::fill(coef_, coef_ + 3, 0);
+        avg_nnz_ = nnz;
+        fitted_ = false;
+        fit();
+    };
+
+    // exact timings give back their coefficients
+    const double v_exact[3] = {0.05, 2e-7, 3e-9};
+    fit_timings(v_exact[0], v_exact[1], v_exact[2]);
+    for(int j=0; j < 3; j++){
+        if(!fitted_ || fabs(coef_[j] - v_exact[j]) > 1e-6 * v_exact[j]){
+            printf("[UT_PR][PS] coefficient %d: %g, expected %g\n", j, coef_[j], v_exact[j]);
+            num_failed++;
+        }
+    }
+
+    // the least squares of these timings has a negative linear coefficient, the fitted ones are nonnegative
+    fit_timings(0.1, -1e-6, 1e-8);
+    if(!fitted_ || *std::min_element(coef_, coef_ + 3) < 0){
+        printf("[UT_PR][PS] negative coefficients: %g, %g, %g\n", coef_[0], coef_[1], coef_[2]);
+        num_failed++;
+    }
+
+    // SMO dominates: the groups are smaller than the static size, the overhead dominates: they are larger
+    PetscInt num_p = 200000, num_n = 200000;
+    int static_size = 1000;
+    fit_timings(0, 0, 1e-9);
+    int size_smo = best_partition_max_size(num_p, num_n, static_size, 0);
+    if(size_smo >= static_size){
+        printf("[UT_PR][PS] the SMO dominated partition max size %d is not smaller than %d\n", size_smo, static_size);
+        num_failed++;
+    }
+    fit_timings(1, 0, 1e-15);
+    int size_overhead = best_partition_max_size(num_p, num_n, static_size, 0);
+    if(size_overhead <= static_size || size_overhead > 4 * static_size){
+        printf("[UT_PR][PS] the overhead dominated partition max size %d is not in (%d, %d]\n",
+               size_overhead, static_size, 4 * static_size);
+        num_failed++;
+    }
+
+    // without probes the static size is kept
+    v_probes_.clear();
+    fitted_ = false;
+    fit();
+    if(best_partition_max_size(num_p, num_n, static_size, 0) != static_size){
+        printf("[UT_PR][PS] the static size is not kept without a cost model\n");
+        num_failed++;
+    }
+
+    printf("[UT_PR][PS] %s\n", (num_failed == 0) ? "passed" : "FAILED");
+    return num_failed;
+}
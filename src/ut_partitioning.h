@@ -2,12 +2,19 @@
 #define UT_PARTITIONING_H
 
 #include "ut_common.h"
+#include "partition_sizing.h"
 
-class UT_Partitioning{
+class UT_Partitioning:PartitionSizing{
 public:
     void test_find_groups();
 
     void test_get_parts();
+    /*
+     * the cost model of PartitionSizing fits synthetic timings (all the coefficients are nonnegative)
+     * and selects smaller partitions if SMO dominates and larger ones if the overhead of a training dominates,
+     * it returns the number of failed checks
+     */
+    int test_partition_sizing();
 };
 
 #endif // UT_PARTITIONING_H
@@ -0,0 +1,475 @@
+#include "ut_svm.h"
+#include "svm_weighted.h"
+#include "model_binary.h"
+#include "stacked_linear.h"
+#include "refinement.h"
+#include "k_fold.h"
+#include "task_pool.h"
+#include "result_cache.h"
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+// the rows of a libsvm text file, each row ends with index -1
+bool read_libsvm_file(const std::string& f_name, std::vector<std::vector<svm_node>>& v_rows, std::vector<double>& v_y){
+    FILE * fp = fopen(f_name.c_str(), "r");
+    if(fp == NULL)
+        return false;
+    char line[1 << 16];
+    while(fgets(line, sizeof(line), fp) != NULL){
+        char * p = line;
+        double label = strtod(p, &p);
+        if(p == line)
+            continue;       // empty line
+        std::vector<svm_node> row;
+        while(true){
+            char * q;
+            long index = strtol(p, &q, 10);
+            if(q == p || *q != ':')
+                break;
+            p = q + 1;
+            row.push_back({(int) index, strtod(p, &p)});
+        }
+        row.push_back({-1, 0});
+        v_rows.push_back(row);
+        v_y.push_back(label);
+    }
+    fclose(fp);
+    return true;
+}
+
+// the rows of a libsvm file as a problem (unit weights), the problem points to the vectors
+struct libsvm_data{
+    std::vector<std::vector<svm_node>> v_rows;
+    std::vector<double> v_y;
+    std::vector<svm_node *> v_x;
+    std::vector<double> v_w;
+    svm_problem prob;
+
+    bool read(const std::string& f_name){
+        if(!read_libsvm_file(f_name, v_rows, v_y) || v_rows.empty()){
+            printf("[UT_SVM] can't read %s\n", f_name.c_str());
+            return false;
+        }
+        v_x.resize(v_rows.size());
+        for(size_t i=0; i < v_rows.size(); i++)
+            v_x[i] = v_rows[i].data();
+        v_w.assign(v_rows.size(), 1);
+        prob.l = v_rows.size();
+        prob.y = v_y.data();
+        prob.x = v_x.data();
+        prob.W = v_w.data();
+        return true;
+    }
+};
+
+svm_parameter rbf_param(double C, double gamma){
+    svm_parameter param = {};
+    param.svm_type = C_SVC;
+    param.kernel_type = RBF;
+    param.gamma = gamma;
+    param.C = C;
+    param.cache_size = 100;
+    param.eps = 1e-3;
+    param.shrinking = 1;
+    return param;
+}
+
+// the point (1-t) a + t b as a row
+std::vector<svm_node> interpolate(const svm_node * a, const svm_node * b, double t){
+    std::vector<svm_node> row;
+    while(a->index != -1 || b->index != -1){
+        if(b->index == -1 || (a->index != -1 && a->index < b->index)){
+            row.push_back({a->index, (1 - t) * a->value});
+            ++a;
+        }else if(a->index == -1 || b->index < a->index){
+            row.push_back({b->index, t * b->value});
+            ++b;
+        }else{
+            row.push_back({a->index, (1 - t) * a->value + t * b->value});
+            ++a;
+            ++b;
+        }
+    }
+    row.push_back({-1, 0});
+    return row;
+}
+}
+
+
+int UT_SVM::test_early_exit(const std::string& f_name){
+    libsvm_data data;
+    if(!data.read(f_name))
+        return 1;
+    int l = data.prob.l;
+    std::vector<std::vector<svm_node>>& v_rows = data.v_rows;
+    std::vector<svm_node *>& v_x = data.v_x;
+    svm_problem& prob = data.prob;
+
+    // small C and wide kernels leave most of the points as SVs
+    const double arr_C[] = {0.1, 1, 10};
+    const double arr_gamma[] = {0.01, 0.1, 1};
+    int num_mismatch = 0;
+    for(double C : arr_C){
+        for(double gamma : arr_gamma){
+            svm_parameter param = rbf_param(C, gamma);
+            svm_model * model = svm_train(&prob, &param);
+
+            // the test points: the training points and the points on the segments between the classes where
+            // the exact decision value changes its sign (found by bisection), and their neighbors
+            std::vector<std::vector<svm_node>> v_test(v_rows);
+            for(int i=0; i + 1 < l; i++){
+                double dec_a, dec_b, dec_t;
+                svm_predict_values(model, v_x[i], &dec_a);
+                svm_predict_values(model, v_x[i + 1], &dec_b);
+                if((dec_a > 0) == (dec_b > 0))
+                    continue;
+                double lo = 0, hi = 1;
+                for(int it=0; it < 60; it++){
+                    double mid = (lo + hi) / 2;
+                    std::vector<svm_node> row = interpolate(v_x[i], v_x[i + 1], mid);
+                    svm_predict_values(model, row.data(), &dec_t);
+                    if((dec_t > 0) == (dec_a > 0))
+                        lo = mid;
+                    else
+                        hi = mid;
+                }
+                v_test.push_back(interpolate(v_x[i], v_x[i + 1], lo));
+                v_test.push_back(interpolate(v_x[i], v_x[i + 1], hi));
+                v_test.push_back(interpolate(v_x[i], v_x[i + 1], (lo + hi) / 2));
+            }
+
+            std::vector<double> v_exact(v_test.size());
+            for(size_t j=0; j < v_test.size(); j++)
+                v_exact[j] = svm_predict(model, v_test[j].data());
+            svm_build_early_exit(model);
+            int curr_mismatch = 0;
+            for(size_t j=0; j < v_test.size(); j++)
+                if(svm_predict(model, v_test[j].data()) != v_exact[j])
+                    ++curr_mismatch;
+            printf("[UT_SVM][EE] C:%g, gamma:%g, nSV:%d, points:%zu, mismatches:%d\n",
+                   C, gamma, model->l, v_test.size(), curr_mismatch);
+            num_mismatch += curr_mismatch;
+            svm_free_and_destroy_model(&model);
+        }
+    }
+    printf("[UT_SVM][EE] %s\n", (num_mismatch == 0) ? "passed" : "FAILED");
+    return num_mismatch;
+}
+
+
+int UT_SVM::test_model_binary(const std::string& f_name){
+    libsvm_data data;
+    if(!data.read(f_name))
+        return 1;
+    svm_parameter param = rbf_param(1, 0.1);
+    svm_model * model = svm_train(&data.prob, &param);
+    std::vector<double> v_center = {0.5, -1, 0, 2};
+    const std::string model_fname = "./ut_svm_model.svmbin";
+    int num_failed = 0;
+    if(!ModelBinary::save(model_fname, model, v_center)){
+        printf("[UT_SVM][MB] can't write %s\n", model_fname.c_str());
+        svm_free_and_destroy_model(&model);
+        return 1;
+    }
+
+    // - - - - - round trip - - - - -
+    {
+        ModelBinary mb;
+        if(!mb.load(model_fname)){
+            printf("[UT_SVM][MB] the saved model can't be loaded\n");
+            ++num_failed;
+        }else{
+            svm_model * loaded = mb.get_model();
+            int num_mismatch = 0;
+            for(int i=0; i < data.prob.l; i++){
+                double dec_saved, dec_loaded;
+                double label_saved = svm_predict_values(model, data.v_x[i], &dec_saved);
+                double label_loaded = svm_predict_values(loaded, data.v_x[i], &dec_loaded);
+                if(label_saved != label_loaded || dec_saved != dec_loaded)
+                    ++num_mismatch;
+            }
+            bool same_center = mb.get_center_dim() == (long) v_center.size() &&
+                    memcmp(mb.get_center(), v_center.data(), v_center.size() * sizeof(double)) == 0;
+            printf("[UT_SVM][MB] round trip nSV:%d/%d, prediction mismatches:%d, center:%s\n",
+                   loaded->l, model->l, num_mismatch, same_center ? "same" : "different");
+            if(loaded->l != model->l || num_mismatch != 0 || !same_center)
+                ++num_failed;
+        }
+    }
+
+    // - - - - - corrupted copies - - - - -
+    std::vector<char> v_file;
+    {
+        FILE * fp = fopen(model_fname.c_str(), "rb");
+        char buffer[1 << 16];
+        size_t num_read;
+        while(fp != NULL && (num_read = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+            v_file.insert(v_file.end(), buffer, buffer + num_read);
+        if(fp != NULL)
+            fclose(fp);
+    }
+    const std::string bad_fname = "./ut_svm_model_bad.svmbin";
+    auto rejected = [&](const std::vector<char>& v_bad, const char * desc){
+        FILE * fp = fopen(bad_fname.c_str(), "wb");
+        fwrite(v_bad.data(), 1, v_bad.size(), fp);
+        fclose(fp);
+        ModelBinary mb;
+        bool loaded = mb.load(bad_fname);
+        printf("[UT_SVM][MB] %s: %s\n", desc, loaded ? "LOADED" : "rejected");
+        if(loaded)
+            ++num_failed;
+    };
+    model_binary_header header;
+    memcpy(&header, v_file.data(), sizeof(header));
+    auto with_header = [&](const model_binary_header& bad_header){
+        std::vector<char> v_bad(v_file);
+        memcpy(v_bad.data(), &bad_header, sizeof(bad_header));
+        return v_bad;
+    };
+    rejected(std::vector<char>(v_file.begin(), v_file.begin() + sizeof(header) - 1), "shorter than the header");
+    rejected(std::vector<char>(v_file.begin(), v_file.begin() + v_file.size() / 2), "truncated to half");
+    model_binary_header bad_header = header;
+    bad_header.file_size = v_file.size() / 2;
+    std::vector<char> v_half = with_header(bad_header);
+    v_half.resize(v_file.size() / 2);
+    rejected(v_half, "truncated to half with a matching file size");
+    bad_header = header;
+    bad_header.off_sv_coef = v_file.size();
+    rejected(with_header(bad_header), "coefficients after the end");
+    bad_header = header;
+    bad_header.off_nodes += 4;
+    rejected(with_header(bad_header), "misaligned nodes");
+    bad_header = header;
+    bad_header.num_nodes *= 1000;
+    rejected(with_header(bad_header), "too many nodes");
+    bad_header = header;
+    bad_header.l = -1;
+    rejected(with_header(bad_header), "negative number of SVs");
+    {
+        std::vector<char> v_bad(v_file);
+        svm_node * nodes = (svm_node *) (v_bad.data() + header.off_nodes);
+        nodes[header.num_nodes - 1].index = 7;
+        rejected(v_bad, "no terminator after the last SV");
+    }
+    {
+        std::vector<char> v_bad(v_file);
+        long * sv_start = (long *) (v_bad.data() + header.off_sv_start);
+        sv_start[header.l - 1] = header.num_nodes + 5;
+        rejected(v_bad, "an SV starts after the nodes");
+    }
+    remove(model_fname.c_str());
+    remove(bad_fname.c_str());
+    svm_free_and_destroy_model(&model);
+    printf("[UT_SVM][MB] %s\n", (num_failed == 0) ? "passed" : "FAILED");
+    return num_failed;
+}
+
+
+int UT_SVM::test_stacked_linear(const std::string& f_name){
+    libsvm_data data;
+    if(!data.read(f_name))
+        return 1;
+    int l = data.prob.l;
+
+    // the models are trained on different halves and C, the row ids are not in the order of add
+    const double arr_C[] = {0.01, 0.1, 1, 10};
+    const int arr_row_id[] = {2, 0, 3, 1};
+    const int num_models = 4;
+    std::vector<svm_model *> v_models(num_models);
+    std::vector<std::vector<double>> vv_exact(num_models, std::vector<double>(l));
+    std::vector<std::vector<bool>> vv_tie(num_models, std::vector<bool>(l));
+    StackedLinearModels slm;
+    for(int k=0; k < num_models; k++){
+        svm_problem sub = data.prob;
+        sub.l = (k % 2 == 0) ? l / 2 : l - l / 2;
+        if(k % 2 == 1){
+            sub.x += l / 2;
+            sub.y += l / 2;
+            sub.W += l / 2;
+        }
+        svm_parameter param = rbf_param(arr_C[k], 0);
+        param.kernel_type = LINEAR;
+        v_models[k] = svm_train(&sub, &param);
+        for(int i=0; i < l; i++){               // the exact labels, before the weights are built
+            double dec;
+            vv_exact[k][i] = svm_predict_values(v_models[k], data.v_x[i], &dec);
+            vv_tie[k][i] = fabs(dec) < 1e-10;
+        }
+        svm_build_linear_weights(v_models[k]);
+        slm.add(arr_row_id[k], v_models[k]);
+    }
+
+    // - - - - - the data matrix, the label in column 0 and the feature j in column j - - - - -
+    PetscInt num_col = 1;
+    std::vector<PetscInt> v_nnz(l);
+    for(int i=0; i < l; i++){
+        v_nnz[i] = 1;
+        for(const svm_node * px = data.v_x[i]; px->index != -1; ++px){
+            num_col = std::max(num_col, (PetscInt) px->index + 1);
+            ++v_nnz[i];
+        }
+    }
+    Mat m_data, m_predicted_label;
+    MatCreateSeqAIJ(PETSC_COMM_SELF, l, num_col, 0, v_nnz.data(), &m_data);
+    for(PetscInt i=0; i < l; i++){
+        MatSetValue(m_data, i, 0, data.v_y[i], INSERT_VALUES);
+        for(const svm_node * px = data.v_x[i]; px->index != -1; ++px)
+            MatSetValue(m_data, i, px->index, px->value, INSERT_VALUES);
+    }
+    MatAssemblyBegin(m_data, MAT_FINAL_ASSEMBLY);
+    MatAssemblyEnd(m_data, MAT_FINAL_ASSEMBLY);
+    MatCreateSeqDense(PETSC_COMM_SELF, num_models, l, NULL, &m_predicted_label);
+
+    slm.predict(m_data, m_predicted_label);
+    MatAssemblyBegin(m_predicted_label, MAT_FINAL_ASSEMBLY);
+    MatAssemblyEnd(m_predicted_label, MAT_FINAL_ASSEMBLY);
+
+    int num_mismatch = 0;
+    for(int k=0; k < num_models; k++){
+        int curr_mismatch = 0, num_tie = 0;
+        PetscInt row = arr_row_id[k];
+        for(PetscInt i=0; i < l; i++){
+            if(vv_tie[k][i]){
+                ++num_tie;
+                continue;
+            }
+            PetscScalar label;
+            MatGetValues(m_predicted_label, 1, &row, 1, &i, &label);
+            if(label != vv_exact[k][i])
+                ++curr_mismatch;
+        }
+        printf("[UT_SVM][SLM] model:%d, row:%d, C:%g, nSV:%d, points:%d, skipped:%d, mismatches:%d\n",
+               k, arr_row_id[k], arr_C[k], v_models[k]->l, l, num_tie, curr_mismatch);
+        num_mismatch += curr_mismatch;
+        svm_free_and_destroy_model(&v_models[k]);
+    }
+    MatDestroy(&m_data);
+    MatDestroy(&m_predicted_label);
+    printf("[UT_SVM][SLM] %s\n", (num_mismatch == 0) ? "passed" : "FAILED");
+    return num_mismatch;
+}
+
+
+int UT_SVM::test_threaded_groups(const std::string& f_name, int num_threads){
+    libsvm_data data;
+    if(!data.read(f_name))
+        return 1;
+    int num_col = 0;
+    for(const std::vector<svm_node>& row : data.v_rows)
+        for(const svm_node& node : row)
+            num_col = std::max(num_col, node.index);
+
+    // - - - - - the even rows train and the odd rows validate, the features start at column 0 - - - - -
+    std::vector<std::vector<int>> vv_rows(4);           // training P, training N, validation P, validation N
+    for(int i=0; i < data.prob.l; i++)
+        vv_rows[(i % 2) * 2 + ((data.v_y[i] > 0) ? 0 : 1)].push_back(i);
+    Mat arr_data[4];
+    for(int k=0; k < 4; k++){
+        MatCreateSeqAIJ(PETSC_COMM_SELF, vv_rows[k].size(), num_col, num_col, NULL, &arr_data[k]);
+        for(unsigned int r=0; r < vv_rows[k].size(); r++)
+            for(const svm_node * px = data.v_x[vv_rows[k][r]]; px->index != -1; ++px)
+                MatSetValue(arr_data[k], r, px->index - 1, px->value, INSERT_VALUES);
+        MatAssemblyBegin(arr_data[k], MAT_FINAL_ASSEMBLY);
+        MatAssemblyEnd(arr_data[k], MAT_FINAL_ASSEMBLY);
+    }
+    Vec v_vol_p, v_vol_n;
+    VecCreateSeq(PETSC_COMM_SELF, vv_rows[0].size(), &v_vol_p);
+    VecCreateSeq(PETSC_COMM_SELF, vv_rows[1].size(), &v_vol_n);
+    VecSet(v_vol_p, 1);
+    VecSet(v_vol_n, 1);
+    Mat m_VD_both;                  // the label in column 0, it is the test data too
+    k_fold kf;
+    kf.combine_two_classes_in_one(m_VD_both, arr_data[2], arr_data[3], false);
+    int num_VD = vv_rows[2].size() + vv_rows[3].size();
+
+    // - - - - - a group for each pair of the halves of the classes, a point is in 2 groups - - - - -
+    const int num_groups = 4;
+    std::vector<std::vector<PetscInt>> vv_p_index(num_groups), vv_n_index(num_groups);
+    PetscInt half_p = vv_rows[0].size() / 2, half_n = vv_rows[1].size() / 2;
+    for(int g=0; g < num_groups; g++){
+        for(PetscInt i = (g / 2) * half_p; i < ((g / 2) ? (PetscInt) vv_rows[0].size() : half_p); i++)
+            vv_p_index[g].push_back(i);
+        for(PetscInt i = (g % 2) * half_n; i < ((g % 2) ? (PetscInt) vv_rows[1].size() : half_n); i++)
+            vv_n_index[g].push_back(i);
+    }
+
+    struct groups_result{
+        std::unordered_map<PetscInt,double> umap_SV_alpha_p, umap_SV_alpha_n;
+        std::vector<PetscScalar> v_predict_VD;          // row major, a row per group
+        std::vector<summary> v_group_summary;
+    };
+    // the result cache would give the second run the results of the first one
+    const std::string old_cache_f_name = Config_params::getInstance()->get_ms_cache_file();
+    Config_params::getInstance()->debug_only_set_ms_cache_file("");
+    ResultCache::getInstance()->init();
+    const int old_width = TaskPool::getInstance()->get_width();
+    std::vector<PetscInt> v_VD_cols(num_VD);
+    for(int j=0; j < num_VD; j++)
+        v_VD_cols[j] = j;
+    const std::vector<double> v_cold_start;
+    auto train_groups = [&](int width, groups_result& result){
+        TaskPool::getInstance()->debug_only_set_width(width);
+        Mat m_predict_VD, m_predict_TD, m_avg_centers;
+        MatCreateSeqDense(PETSC_COMM_SELF, num_groups, num_VD, NULL, &m_predict_VD);
+        MatCreateSeqDense(PETSC_COMM_SELF, num_groups, num_VD, NULL, &m_predict_TD);
+        MatCreateSeqDense(PETSC_COMM_SELF, num_groups, num_col, NULL, &m_avg_centers);     // only saved with the models
+        MatAssemblyBegin(m_avg_centers, MAT_FINAL_ASSEMBLY);
+        MatAssemblyEnd(m_avg_centers, MAT_FINAL_ASSEMBLY);
+        std::vector<std::vector<PetscInt>> vv_p_group(vv_p_index), vv_n_group(vv_n_index);
+        BufferPool buffer_pool;
+        Refinement rf;
+        rf.train_groups(arr_data[0], v_vol_p, arr_data[1], v_vol_n, 1, 0.1, 2, vv_p_group, vv_n_group, m_avg_centers, buffer_pool,
+                        arr_data[2], arr_data[3], m_VD_both, m_predict_VD, m_VD_both, m_predict_TD, v_cold_start, v_cold_start,
+                        result.umap_SV_alpha_p, result.umap_SV_alpha_n, result.v_group_summary);
+        MatAssemblyBegin(m_predict_VD, MAT_FINAL_ASSEMBLY);
+        MatAssemblyEnd(m_predict_VD, MAT_FINAL_ASSEMBLY);
+        result.v_predict_VD.resize(num_groups * num_VD);
+        for(PetscInt g=0; g < num_groups; g++)
+            MatGetValues(m_predict_VD, 1, &g, num_VD, v_VD_cols.data(), &result.v_predict_VD[g * num_VD]);
+        MatDestroy(&m_predict_VD);
+        MatDestroy(&m_predict_TD);
+        MatDestroy(&m_avg_centers);
+    };
+    groups_result serial, threaded;
+    train_groups(1, serial);
+    train_groups(num_threads, threaded);
+
+    int num_failed = 0;
+    if(serial.umap_SV_alpha_p != threaded.umap_SV_alpha_p || serial.umap_SV_alpha_n != threaded.umap_SV_alpha_n){
+        printf("[UT_SVM][TG] the merged SVs are different, P:%zu/%zu, N:%zu/%zu\n",
+               serial.umap_SV_alpha_p.size(), threaded.umap_SV_alpha_p.size(),
+               serial.umap_SV_alpha_n.size(), threaded.umap_SV_alpha_n.size());
+        ++num_failed;
+    }
+    for(int g=0; g < num_groups; g++){
+        const summary& s_serial = serial.v_group_summary[g];
+        const summary& s_threaded = threaded.v_group_summary[g];
+        int num_mismatch = 0;
+        for(int j=0; j < num_VD; j++)
+            if(serial.v_predict_VD[g * num_VD + j] != threaded.v_predict_VD[g * num_VD + j])
+                ++num_mismatch;
+        if(s_serial.C != s_threaded.C || s_serial.gamma != s_threaded.gamma || num_mismatch > 0){
+            printf("[UT_SVM][TG] group:%d, C:%g/%g, gamma:%g/%g, validation prediction mismatches:%d\n",
+                   g, s_serial.C, s_threaded.C, s_serial.gamma, s_threaded.gamma, num_mismatch);
+            ++num_failed;
+        }
+    }
+
+    TaskPool::getInstance()->debug_only_set_width(old_width);
+    Config_params::getInstance()->debug_only_set_ms_cache_file(old_cache_f_name);
+    ResultCache::getInstance()->init();
+    for(int k=0; k < 4; k++)
+        MatDestroy(&arr_data[k]);
+    MatDestroy(&m_VD_both);
+    VecDestroy(&v_vol_p);
+    VecDestroy(&v_vol_n);
+    printf("[UT_SVM][TG] %d threads, SVs P:%zu N:%zu, %s\n", num_threads, threaded.umap_SV_alpha_p.size(),
+           threaded.umap_SV_alpha_n.size(), (num_failed == 0) ? "passed" : "FAILED");
+    return num_failed;
+}
@@ -0,0 +1,32 @@
+#ifndef UT_SVM_H
+#define UT_SVM_H
+
+#include <string>
+
+class UT_SVM
+{
+public:
+    /*
+     * the labels of svm_predict with and without the early exit order (svm_build_early_exit) are the same
+     * for the training points and for the points near the decision boundary, f_name is a libsvm text file
+     * it returns the number of mismatches
+     */
+    int test_early_exit(const std::string& f_name = "./data_libsvm/heart_scale");
+    /*
+     * a model saved by ModelBinary and loaded back predicts the same values and keeps the center,
+     * the truncated files and the files with a section out of the file are rejected by load
+     */
+    int test_model_binary(const std::string& f_name = "./data_libsvm/heart_scale");
+    /*
+     * the labels of StackedLinearModels::predict are the labels of svm_predict of each linear model
+     * (the points with a decision value at the rounding level are skipped)
+     */
+    int test_stacked_linear(const std::string& f_name = "./data_libsvm/heart_scale");
+    /*
+     * Refinement::train_groups with num_threads workers gives the same merged SVs (and alphas), validation predictions
+     * and selected C and gamma of each group as with a single thread (2 partitions of each class, 4 groups)
+     */
+    int test_threaded_groups(const std::string& f_name = "./data_libsvm/heart_scale", int num_threads = 4);
+};
+
+#endif // UT_SVM_H